@@ -0,0 +1,140 @@
+#ifndef AVL_COMPACT_TREE_HPP
+#define AVL_COMPACT_TREE_HPP
+
+#include "include/data_structures/avl_tree.hpp"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//! Null node index of the compact AVL Tree
+#define AVL_COMPACT_NIL UINT32_MAX
+
+//! Bits of the compact node key word holding the ID
+#define AVL_COMPACT_ID_BITS 30
+#define AVL_COMPACT_ID_MASK ((1u << AVL_COMPACT_ID_BITS) - 1)
+
+static_assert(MAX_ID <= AVL_COMPACT_ID_MASK, "IDs must fit in the compact key word");
+
+//! Largest size of the name arena, so name offsets fit in 32 bits
+#define AVL_COMPACT_MAX_ARENA UINT32_MAX
+
+/**
+ *  Compact AVL Tree node (16 bytes, four nodes per cache line).
+ *  The balance factor is packed in the spare high bits of the ID word and
+ *  links are 32-bit indices into the node pool of the tree.
+ **/
+struct AVLCompactNode {
+  //! ID of the person (low 30 bits) and balance factor + 1 (high 2 bits)
+  uint32_t key;
+  //! Index of the parent node
+  uint32_t parent;
+  //! Index of the left child node
+  uint32_t lchild;
+  //! Index of the right child node
+  uint32_t rchild;
+};
+
+static_assert(sizeof(AVLCompactNode) == 16, "Compact node must be 16 bytes");
+
+//! Location of a name inside the name arena of a compact AVL Tree
+struct AVLCompactName {
+  //! Offset of the first character in the arena
+  uint32_t offset;
+  //! Length of the name
+  uint32_t length;
+};
+
+/**
+ *  Compact AVL Tree, split in a hot part (the node pool walked by searches)
+ *  and a cold part (names stored in an append-only arena of at most
+ *  AVL_COMPACT_MAX_ARENA bytes).
+ **/
+struct AVLCompactTree {
+  //! Node pool, indexed by node index
+  std::vector<AVLCompactNode> nodes;
+  //! Name location of each node, parallel to the node pool
+  std::vector<AVLCompactName> names;
+  //! Append-only arena holding the characters of all names
+  std::vector<char> name_arena;
+  //! Index of the root node
+  uint32_t root = AVL_COMPACT_NIL;
+  //! Released nodes available for reuse (linked through lchild)
+  uint32_t freelist = AVL_COMPACT_NIL;
+  //! Number of nodes in the tree
+  uint32_t size = 0;
+};
+
+/**
+ *  @brief Creates an empty compact AVL Tree.
+ *  @param[out] tree Compact AVL Tree to create.
+ *  @return return code.
+ **/
+int avl_compact_tree_create(AVLCompactTree** tree);
+
+/**
+ *  @brief Destroys the compact AVL Tree, releasing its node pool.
+ *  @param[in,out] tree Compact AVL Tree to destroy.
+ *  @return return code.
+ **/
+int avl_compact_tree_destroy(AVLCompactTree** tree);
+
+/**
+ *  @brief Insert a new node into the compact AVL Tree.
+ *  @param[in] tree Compact AVL Tree to insert the new node.
+ *  @param[in] id ID of the person for the new node.
+ *  @param[in] name Name of the person for the new node.
+ *  @return return code (OUT_OF_MEMORY if the name arena is full).
+ **/
+int avl_compact_tree_insert(AVLCompactTree* tree, uint32_t id, std::string name);
+
+/**
+ *  @brief Removes a node from the compact AVL Tree.
+ *  @param[in] tree Compact AVL Tree to remove the node from.
+ *  @param[in] id ID of the person of the node to remove (key).
+ *  @return return code.
+ **/
+int avl_compact_tree_remove(AVLCompactTree* tree, uint32_t id);
+
+/**
+ *  @brief Search for a node in the compact AVL Tree.
+ *  @param[in] tree Compact AVL Tree.
+ *  @param[in] id ID of the person to search for the node (key).
+ *  @param[out] node Index of the last node after tree search traversal.
+ *  @param[out] found Boolean that indicates if the node was found,
+ *               in which case the node parameter is the found node index.
+ *  @return return code.
+ **/
+int avl_compact_tree_search(AVLCompactTree* tree, uint32_t id, uint32_t* node,
+                            bool* found);
+
+/**
+ *  @brief Get the name of the person of a compact AVL Tree node.
+ *  @param[in] tree Compact AVL Tree.
+ *  @param[in] node Index of the node.
+ *  @param[out] name Name of the person.
+ *  @return return code.
+ **/
+int avl_compact_tree_get_name(AVLCompactTree* tree, uint32_t node,
+                              std::string* name);
+
+/**
+ *  @brief Get the name of a compact AVL Tree node without copying it.
+ *  The returned pointer is valid until the next insertion in the tree.
+ *  @param[in] tree Compact AVL Tree.
+ *  @param[in] node Index of the node.
+ *  @param[out] name First character of the name inside the name arena.
+ *  @param[out] length Length of the name.
+ *  @return return code.
+ **/
+int avl_compact_tree_get_name_ref(AVLCompactTree* tree, uint32_t node,
+                                  const char** name, uint32_t* length);
+
+/**
+ *  @brief Get the size (number of elements) in the compact AVL Tree.
+ *  @param[in] tree Compact AVL Tree.
+ *  @param[out] size Size of the compact AVL Tree.
+ *  @return return code.
+ **/
+int avl_compact_tree_get_size(AVLCompactTree* tree, int* size);
+
+#endif // AVL_COMPACT_TREE_HPP
@@ -0,0 +1,131 @@
+#ifndef AVL_CONCURRENT_TREE_HPP
+#define AVL_CONCURRENT_TREE_HPP
+
+#include "include/data_structures/avl_tree.hpp"
+#include "include/data_structures/avl_epoch.hpp"
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+/**
+ *  Node of a concurrent AVL Tree. Nodes are immutable once published:
+ *  writers copy the nodes they change instead of updating them in place.
+ **/
+struct AVLConcurrentNode {
+  //! Pointer to the left child node
+  AVLConcurrentNode* lchild = NULL;
+  //! Pointer to the right child node
+  AVLConcurrentNode* rchild = NULL;
+  //! ID of the person
+  uint32_t id = 0;
+  //! Height of the subtree rooted at this node
+  int height = 1;
+  //! Writer update that created the node (nodes of the running update are mutable)
+  uint64_t version = 0;
+  //! Name of the person
+  std::string name;
+};
+
+/**
+ *  AVL Tree with lock-free readers and a single writer at a time.
+ *  The writer copies the root-to-leaf path it modifies, including the
+ *  nodes moved by the RR/LL/RL/LR rotations, and publishes the new version
+ *  with one atomic store of the root, so readers always traverse a
+ *  consistent tree. Replaced nodes are retired with the current epoch and
+ *  freed once every reader that could still see them has left.
+ **/
+struct AVLConcurrentTree {
+  //! Root node of the published version
+  std::atomic<AVLConcurrentNode*> root{NULL};
+  //! Number of nodes of the published version
+  std::atomic<int> size{0};
+  //! Serializes the writers
+  std::mutex writer;
+  //! Number of writer updates
+  uint64_t version = 0;
+  //! Epochs of the readers inside the tree
+  AVLEpochDomain epochs;
+  //! Nodes replaced by the running update
+  std::vector<AVLConcurrentNode*> retiring;
+  //! Replaced nodes waiting for the readers, with their retirement epoch
+  std::vector<std::pair<uint64_t, std::vector<AVLConcurrentNode*>>> retired;
+};
+
+/**
+ *  Callback called by avl_concurrent_tree_range_scan for each node in
+ *  range, in key order. Returning false stops the scan. The node is only
+ *  valid during the call.
+ **/
+typedef bool (*avl_concurrent_scan_fn)(const AVLConcurrentNode* node, void* arg);
+
+/**
+ *  @brief Creates an empty concurrent AVL Tree.
+ *  @param[out] tree Concurrent tree to create.
+ *  @return return code.
+ **/
+int avl_concurrent_tree_create(AVLConcurrentTree** tree);
+
+/**
+ *  @brief Destroys the concurrent AVL Tree and all its nodes.
+ *  No reader or writer may be using the tree.
+ *  @param[in,out] tree Concurrent tree to destroy.
+ *  @return return code.
+ **/
+int avl_concurrent_tree_destroy(AVLConcurrentTree** tree);
+
+/**
+ *  @brief Insert a new node, publishing a new version of the tree.
+ *  Writers are serialized, readers are never blocked.
+ *  @param[in] tree Concurrent tree.
+ *  @param[in] id ID of the person for the new node.
+ *  @param[in] name Name of the person for the new node.
+ *  @return return code.
+ **/
+int avl_concurrent_tree_insert(AVLConcurrentTree* tree, uint32_t id,
+                               std::string name);
+
+/**
+ *  @brief Remove a node, publishing a new version of the tree.
+ *  Writers are serialized, readers are never blocked.
+ *  @param[in] tree Concurrent tree.
+ *  @param[in] id ID of the node to remove.
+ *  @return return code.
+ **/
+int avl_concurrent_tree_remove(AVLConcurrentTree* tree, uint32_t id);
+
+/**
+ *  @brief Search for a key without locking.
+ *  @param[in] tree Concurrent tree.
+ *  @param[in] id ID of the person to search for (key).
+ *  @param[out] name Name of the person, if found (may be NULL).
+ *  @param[out] found Boolean that indicates if the key was found.
+ *  @return return code.
+ **/
+int avl_concurrent_tree_search(AVLConcurrentTree* tree, uint32_t id,
+                               std::string* name, bool* found);
+
+/**
+ *  @brief Visit the nodes with keys in [lo, hi] in key order, without locking.
+ *  The whole scan sees the single version published when it started.
+ *  @param[in] tree Concurrent tree.
+ *  @param[in] lo Lowest key of the range.
+ *  @param[in] hi Highest key of the range.
+ *  @param[in] callback Function called for each node in range.
+ *  @param[in] arg Argument passed to the callback.
+ *  @return return code.
+ **/
+int avl_concurrent_tree_range_scan(AVLConcurrentTree* tree, uint32_t lo,
+                                   uint32_t hi, avl_concurrent_scan_fn callback,
+                                   void* arg);
+
+/**
+ *  @brief Get the number of nodes of the published version.
+ *  @param[in] tree Concurrent tree.
+ *  @param[out] size Number of nodes.
+ *  @return return code.
+ **/
+int avl_concurrent_tree_get_size(AVLConcurrentTree* tree, int* size);
+
+#endif // AVL_CONCURRENT_TREE_HPP
@@ -0,0 +1,76 @@
+#ifndef AVL_DB_PARSER_HPP
+#define AVL_DB_PARSER_HPP
+
+#include "include/data_structures/avl_tree.hpp"
+#include <string>
+#include <cstdint>
+#include <vector>
+
+/**
+ *  Read-only memory mapping of an input file. Inputs that can't be mapped
+ *  (pipes, FIFOs, /dev/stdin, procfs files...) are read into a heap buffer.
+ **/
+struct AVLDbFile {
+  //! First byte of the file (NULL for an empty file)
+  const char* data = NULL;
+  //! File size in bytes
+  size_t size = 0;
+  //! Whether data is a memory mapping (or a heap buffer)
+  bool mapped = false;
+};
+
+/**
+ *  Callback receiving each parsed DB entry. The name is a slice of the
+ *  parsed buffer, valid only while the buffer is.
+ **/
+typedef void (*avl_db_entry_fn)(uint32_t id, const char* name, size_t length,
+                                void* arg);
+
+/**
+ *  @brief Maps an input file in memory, or reads it whole when it is not
+ *  a regular file with a known size.
+ *  @param[in] infile Input file name.
+ *  @param[out] file Mapping of the file.
+ *  @return return code (INVALID_FILE if the file can't be opened or read).
+ **/
+int avl_db_file_map(const std::string& infile, AVLDbFile* file);
+
+/**
+ *  @brief Releases the mapping of an input file.
+ *  @param[in,out] file Mapping of the file.
+ **/
+void avl_db_file_unmap(AVLDbFile* file);
+
+/**
+ *  @brief Parses the "name, id" lines of a buffer in place.
+ *  Comma and newline positions are found a 64-byte block at a time with
+ *  SIMD compares (AVX-512 or AVX2 when the CPU supports them), and 9-digit
+ *  IDs are converted with a SWAR 8+1 digit routine.
+ *  @param[in] begin First byte of the buffer.
+ *  @param[in] end End of the buffer.
+ *  @param[in] infile Input file name, for error messages.
+ *  @param[in] lnum Line number of the first line of the buffer.
+ *  @param[out] error Error message of the first malformed line.
+ *  @param[in] add Callback called for each entry, in buffer order.
+ *  @param[in] arg Argument passed to the callback.
+ *  @return return code (INVALID_FILE or INVALID_KEY on a malformed line).
+ **/
+int avl_db_parse(const char* begin, const char* end, const std::string& infile,
+                 int lnum, std::string* error, avl_db_entry_fn add, void* arg);
+
+/**
+ *  @brief Reads an input file into a list of DB entries.
+ *  A file that can't be opened yields an empty list.
+ *  @param[in] infile Input file name.
+ *  @param[out] db_list Parsed DB entries, in file order.
+ *  @return return code.
+ **/
+int avl_db_parse_file(std::string infile, std::vector<db_entry>* db_list);
+
+/**
+ *  @brief Get the name of the block scan kernel selected for this CPU.
+ *  @return "avx512", "avx2" or "scalar".
+ **/
+const char* avl_db_parse_kernel();
+
+#endif // AVL_DB_PARSER_HPP
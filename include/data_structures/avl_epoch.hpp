@@ -0,0 +1,60 @@
+#ifndef AVL_EPOCH_HPP
+#define AVL_EPOCH_HPP
+
+#include <cstdint>
+#include <atomic>
+
+//! Maximum number of threads inside an epoch domain at the same time
+#define AVL_EPOCH_SLOTS 64
+
+/**
+ *  Thread registration slot, the epoch observed by a thread while inside
+ *  the domain (0 when free). Padded to a cache line, to avoid false sharing.
+ **/
+struct AVLEpochSlot {
+  std::atomic<uint64_t> epoch{0};
+  char padding[64 - sizeof(std::atomic<uint64_t>)];
+};
+
+/**
+ *  Epoch-based reclamation domain shared by the concurrent trees.
+ *  Threads register the global epoch while they traverse nodes; a node
+ *  unlinked at epoch E can be freed once every registered epoch is above E.
+ **/
+struct AVLEpochDomain {
+  //! Global reclamation epoch
+  std::atomic<uint64_t> epoch{1};
+  //! Epochs of the threads inside the domain
+  AVLEpochSlot slots[AVL_EPOCH_SLOTS];
+};
+
+/**
+ *  @brief Registers the calling thread in a free slot with the current
+ *  epoch, waiting for a slot if all of them are taken.
+ *  @param[in] domain Epoch domain.
+ *  @return slot to release with avl_epoch_exit.
+ **/
+AVLEpochSlot* avl_epoch_enter(AVLEpochDomain* domain);
+
+/**
+ *  @brief Releases a slot taken with avl_epoch_enter.
+ *  @param[in] slot Slot of the calling thread.
+ **/
+void avl_epoch_exit(AVLEpochSlot* slot);
+
+/**
+ *  @brief Moves the domain to the next epoch.
+ *  @param[in] domain Epoch domain.
+ *  @return epoch before the increment.
+ **/
+uint64_t avl_epoch_advance(AVLEpochDomain* domain);
+
+/**
+ *  @brief Get the oldest epoch registered by a thread inside the domain.
+ *  Nodes retired before that epoch are no longer reachable by any thread.
+ *  @param[in] domain Epoch domain.
+ *  @return oldest registered epoch (UINT64_MAX if no thread is inside).
+ **/
+uint64_t avl_epoch_oldest(AVLEpochDomain* domain);
+
+#endif // AVL_EPOCH_HPP
@@ -0,0 +1,63 @@
+#ifndef AVL_FROZEN_TREE_HPP
+#define AVL_FROZEN_TREE_HPP
+
+#include "include/data_structures/avl_tree.hpp"
+#include <string>
+#include <cstdint>
+
+/**
+ *  Immutable snapshot of an AVL Tree, with the keys stored in Eytzinger
+ *  (BFS) order in a cache-aligned array: the two children of slot k are
+ *  slots 2k and 2k+1, so a search touches a predictable, prefetchable
+ *  sequence of cache lines instead of chasing heap pointers.
+ **/
+struct AVLFrozenTree {
+  //! Number of keys in the snapshot
+  uint32_t size = 0;
+  //! Keys in Eytzinger order, 1-based (slot 0 is unused), cache-line aligned
+  uint32_t* keys = NULL;
+  //! Offsets of the names, parallel to the keys (size + 2 entries)
+  uint64_t* name_offsets = NULL;
+  //! Names of the persons, laid out in Eytzinger order
+  char* names = NULL;
+};
+
+/**
+ *  @brief Freezes an AVL Tree into an immutable Eytzinger-ordered snapshot.
+ *  The source tree is left untouched.
+ *  @param[in] root Root node of the AVL Tree to freeze.
+ *  @param[out] frozen Frozen tree to create.
+ *  @return return code.
+ **/
+int avl_tree_freeze(AVLNode* root, AVLFrozenTree** frozen);
+
+/**
+ *  @brief Destroys the frozen tree, releasing its arrays.
+ *  @param[in,out] frozen Frozen tree to destroy.
+ *  @return return code.
+ **/
+int avl_frozen_tree_destroy(AVLFrozenTree** frozen);
+
+/**
+ *  @brief Branchless, prefetching search for a key in the frozen tree.
+ *  @param[in] frozen Frozen tree.
+ *  @param[in] id ID of the person to search for (key).
+ *  @param[out] slot Slot of the lowest key not lower than id (0 if none).
+ *  @param[out] found Boolean that indicates if the key was found,
+ *               in which case the slot parameter holds the key.
+ *  @return return code.
+ **/
+int avl_frozen_tree_search(AVLFrozenTree* frozen, uint32_t id, uint32_t* slot,
+                           bool* found);
+
+/**
+ *  @brief Get the name of the person stored in a frozen tree slot.
+ *  @param[in] frozen Frozen tree.
+ *  @param[in] slot Slot returned by avl_frozen_tree_search.
+ *  @param[out] name Name of the person.
+ *  @return return code.
+ **/
+int avl_frozen_tree_get_name(AVLFrozenTree* frozen, uint32_t slot,
+                             std::string* name);
+
+#endif // AVL_FROZEN_TREE_HPP
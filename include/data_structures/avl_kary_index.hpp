@@ -0,0 +1,77 @@
+#ifndef AVL_KARY_INDEX_HPP
+#define AVL_KARY_INDEX_HPP
+
+#include "include/data_structures/avl_tree.hpp"
+#include <string>
+#include <cstdint>
+
+//! Keys per k-ary index block (one 64-byte cache line of 32-bit keys)
+#define AVL_KARY_BLOCK 16
+
+/**
+ *  Static, read-optimized k-ary search index built from an AVL Tree.
+ *  Keys are laid out as an implicit B-tree of 16-key blocks (the children
+ *  of block b are blocks b * 17 + 1 .. b * 17 + 17), so each level of a
+ *  search is resolved by comparing the key against a whole block at once.
+ **/
+struct AVLKaryIndex {
+  //! Number of keys in the index
+  uint32_t size = 0;
+  //! Number of blocks in the index
+  uint32_t num_blocks = 0;
+  //! Keys in block order, padded with UINT32_MAX, cache-line aligned
+  uint32_t* keys = NULL;
+  //! Sorted position of each key, parallel to the keys
+  uint32_t* ranks = NULL;
+  //! Offsets of the names in sorted order (size + 1 entries)
+  uint64_t* name_offsets = NULL;
+  //! Names of the persons, in sorted order
+  char* names = NULL;
+};
+
+/**
+ *  @brief Builds a k-ary search index from an AVL Tree.
+ *  @param[in] root Root node of the AVL Tree to index.
+ *  @param[out] index K-ary index to create.
+ *  @return return code.
+ **/
+int avl_kary_index_create(AVLNode* root, AVLKaryIndex** index);
+
+/**
+ *  @brief Destroys the k-ary index, releasing its arrays.
+ *  @param[in,out] index K-ary index to destroy.
+ *  @return return code.
+ **/
+int avl_kary_index_destroy(AVLKaryIndex** index);
+
+/**
+ *  @brief Search for a key in the k-ary index.
+ *  Uses AVX-512 or AVX2 block compares when the CPU supports them,
+ *  falling back to a scalar block scan otherwise.
+ *  @param[in] index K-ary index.
+ *  @param[in] id ID of the person to search for (key).
+ *  @param[out] rank Sorted position of the lowest key not lower than id
+ *               (the index size if none).
+ *  @param[out] found Boolean that indicates if the key was found.
+ *  @return return code.
+ **/
+int avl_kary_index_search(AVLKaryIndex* index, uint32_t id, uint32_t* rank,
+                          bool* found);
+
+/**
+ *  @brief Get the name of the person stored at a sorted position.
+ *  @param[in] index K-ary index.
+ *  @param[in] rank Sorted position returned by avl_kary_index_search.
+ *  @param[out] name Name of the person.
+ *  @return return code.
+ **/
+int avl_kary_index_get_name(AVLKaryIndex* index, uint32_t rank,
+                            std::string* name);
+
+/**
+ *  @brief Get the name of the block compare kernel selected for this CPU.
+ *  @return "avx512", "avx2" or "scalar".
+ **/
+const char* avl_kary_index_kernel();
+
+#endif // AVL_KARY_INDEX_HPP
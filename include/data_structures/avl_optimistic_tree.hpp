@@ -0,0 +1,125 @@
+#ifndef AVL_OPTIMISTIC_TREE_HPP
+#define AVL_OPTIMISTIC_TREE_HPP
+
+#include "include/data_structures/avl_tree.hpp"
+#include "include/data_structures/avl_epoch.hpp"
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+//! Number of retired nodes between two reclamation passes
+#define AVL_OPTIMISTIC_RECLAIM_BATCH 256
+
+/**
+ *  Node of an optimistic concurrent AVL Tree. Links, height, version and
+ *  name are read without locking; they are only written with the node
+ *  lock held. A node without name is a routing node: its key was removed
+ *  while it had two children, and it is unlinked once it has fewer.
+ **/
+struct AVLOptimisticNode {
+  //! Pointer to the parent node
+  std::atomic<AVLOptimisticNode*> parent{NULL};
+  //! Pointer to the left child node
+  std::atomic<AVLOptimisticNode*> lchild{NULL};
+  //! Pointer to the right child node
+  std::atomic<AVLOptimisticNode*> rchild{NULL};
+  //! ID of the person
+  uint32_t id = 0;
+  //! Height of the subtree rooted at this node (may be stale while updates run)
+  std::atomic<int> height{1};
+  //! Changes when a rotation moves keys out of the subtree, or on unlink
+  std::atomic<uint64_t> version{0};
+  //! Name of the person (NULL for a routing node)
+  std::atomic<const std::string*> name{NULL};
+  //! Held by writers changing the node
+  std::mutex lock;
+};
+
+//! Node or name waiting for the threads that may still read it
+struct AVLOptimisticRetired {
+  //! Epoch when the node or name was retired
+  uint64_t epoch;
+  AVLOptimisticNode* node;
+  const std::string* name;
+};
+
+/**
+ *  AVL Tree with optimistic concurrency control for many writers
+ *  (Bronson et al., "A Practical Concurrent Binary Search Tree").
+ *  Searches and updates walk down hand-over-hand, validating the version
+ *  of each node instead of locking it, and retry from the parent when a
+ *  rotation invalidated the path. Writers only lock the node they change,
+ *  plus its parent and children around a rotation or an unlink. Balance is
+ *  relaxed: heights are repaired after each update, walking back up, and
+ *  the tree is a strict AVL Tree once updates stop.
+ **/
+struct AVLOptimisticTree {
+  //! Sentinel node, the root is its right child
+  AVLOptimisticNode root_holder;
+  //! Number of keys in the tree
+  std::atomic<int> size{0};
+  //! Epochs of the threads inside the tree
+  AVLEpochDomain epochs;
+  //! Protects the retired list
+  std::mutex reclaim;
+  //! Unlinked nodes and replaced names
+  std::vector<AVLOptimisticRetired> retired;
+  //! Size of the retired list that triggers the next reclamation pass
+  size_t reclaim_threshold = AVL_OPTIMISTIC_RECLAIM_BATCH;
+};
+
+/**
+ *  @brief Creates an empty optimistic concurrent AVL Tree.
+ *  @param[out] tree Optimistic tree to create.
+ *  @return return code.
+ **/
+int avl_optimistic_tree_create(AVLOptimisticTree** tree);
+
+/**
+ *  @brief Destroys the optimistic AVL Tree and all its nodes.
+ *  No other thread may be using the tree.
+ *  @param[in,out] tree Optimistic tree to destroy.
+ *  @return return code.
+ **/
+int avl_optimistic_tree_destroy(AVLOptimisticTree** tree);
+
+/**
+ *  @brief Insert a new node. Safe to call from any number of threads.
+ *  @param[in] tree Optimistic tree.
+ *  @param[in] id ID of the person for the new node.
+ *  @param[in] name Name of the person for the new node.
+ *  @return return code.
+ **/
+int avl_optimistic_tree_insert(AVLOptimisticTree* tree, uint32_t id,
+                               std::string name);
+
+/**
+ *  @brief Remove a node. Safe to call from any number of threads.
+ *  @param[in] tree Optimistic tree.
+ *  @param[in] id ID of the node to remove.
+ *  @return return code.
+ **/
+int avl_optimistic_tree_remove(AVLOptimisticTree* tree, uint32_t id);
+
+/**
+ *  @brief Search for a key without locking.
+ *  @param[in] tree Optimistic tree.
+ *  @param[in] id ID of the person to search for (key).
+ *  @param[out] name Name of the person, if found (may be NULL).
+ *  @param[out] found Boolean that indicates if the key was found.
+ *  @return return code.
+ **/
+int avl_optimistic_tree_search(AVLOptimisticTree* tree, uint32_t id,
+                               std::string* name, bool* found);
+
+/**
+ *  @brief Get the number of keys in the tree.
+ *  @param[in] tree Optimistic tree.
+ *  @param[out] size Number of keys.
+ *  @return return code.
+ **/
+int avl_optimistic_tree_get_size(AVLOptimisticTree* tree, int* size);
+
+#endif // AVL_OPTIMISTIC_TREE_HPP
@@ -0,0 +1,140 @@
+#ifndef AVL_PERSISTENT_TREE_HPP
+#define AVL_PERSISTENT_TREE_HPP
+
+#include "include/data_structures/avl_tree.hpp"
+#include <string>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+
+/**
+ *  Node of a persistent AVL Tree. Nodes are shared between versions, so
+ *  they have no parent pointer and are never modified once part of a
+ *  version: updates copy the nodes on the modified path instead.
+ *  A version is the root node of a tree (NULL for an empty one), holding
+ *  one reference on it.
+ **/
+struct AVLPersistentNode {
+  //! Pointer to the left child node
+  AVLPersistentNode* lchild = NULL;
+  //! Pointer to the right child node
+  AVLPersistentNode* rchild = NULL;
+  //! ID of the person
+  uint32_t id = 0;
+  //! Height of the subtree rooted at this node
+  int height = 1;
+  //! Number of nodes in the subtree rooted at this node
+  int size = 1;
+  //! Number of parent nodes and versions referencing the node
+  std::atomic<int> refs{1};
+  //! Name of the person
+  std::string name;
+};
+
+/**
+ *  Persistent AVL Tree receiving live updates. Each update publishes a new
+ *  version sharing every unchanged subtree with the previous one, and a
+ *  snapshot of the current version costs one reference count increment.
+ **/
+struct AVLPersistentTree {
+  //! Current version
+  AVLPersistentNode* root = NULL;
+  //! Serializes the updates and snapshots
+  std::mutex lock;
+};
+
+/**
+ *  @brief Creates an empty persistent AVL Tree.
+ *  @param[out] tree Persistent tree to create.
+ *  @return return code.
+ **/
+int avl_persistent_tree_create(AVLPersistentTree** tree);
+
+/**
+ *  @brief Destroys the persistent AVL Tree, releasing its current version.
+ *  Snapshots taken from the tree remain valid until released.
+ *  @param[in,out] tree Persistent tree to destroy.
+ *  @return return code.
+ **/
+int avl_persistent_tree_destroy(AVLPersistentTree** tree);
+
+/**
+ *  @brief Insert a new node, publishing a new current version.
+ *  @param[in] tree Persistent tree.
+ *  @param[in] id ID of the person for the new node.
+ *  @param[in] name Name of the person for the new node.
+ *  @return return code.
+ **/
+int avl_persistent_tree_insert(AVLPersistentTree* tree, uint32_t id,
+                               std::string name);
+
+/**
+ *  @brief Remove a node, publishing a new current version.
+ *  @param[in] tree Persistent tree.
+ *  @param[in] id ID of the node to remove.
+ *  @return return code.
+ **/
+int avl_persistent_tree_remove(AVLPersistentTree* tree, uint32_t id);
+
+/**
+ *  @brief Takes a point-in-time snapshot of the tree in O(1).
+ *  The snapshot is unaffected by later updates and may be read from any
+ *  thread, until released with avl_persistent_version_release.
+ *  @param[in] tree Persistent tree.
+ *  @param[out] version Current version of the tree.
+ *  @return return code.
+ **/
+int avl_persistent_tree_snapshot(AVLPersistentTree* tree,
+                                 AVLPersistentNode** version);
+
+/**
+ *  @brief Creates a new version with one more node, copying only the
+ *  O(log n) nodes on the insertion path.
+ *  @param[in] version Version to update (kept unchanged, may be NULL).
+ *  @param[in] id ID of the person for the new node.
+ *  @param[in] name Name of the person for the new node.
+ *  @param[out] new_version New version, to release by the caller.
+ *  @return return code.
+ **/
+int avl_persistent_version_insert(AVLPersistentNode* version, uint32_t id,
+                                  std::string name,
+                                  AVLPersistentNode** new_version);
+
+/**
+ *  @brief Creates a new version without a node, copying only the
+ *  O(log n) nodes on the removal path.
+ *  @param[in] version Version to update (kept unchanged).
+ *  @param[in] id ID of the node to remove.
+ *  @param[out] new_version New version, to release by the caller.
+ *  @return return code.
+ **/
+int avl_persistent_version_remove(AVLPersistentNode* version, uint32_t id,
+                                  AVLPersistentNode** new_version);
+
+/**
+ *  @brief Search for a node in a version.
+ *  @param[in] version Version to search (may be NULL).
+ *  @param[in] id ID of the person to search for (key).
+ *  @param[out] node Found node, valid while the version is held.
+ *  @param[out] found Boolean that indicates if the key was found.
+ *  @return return code.
+ **/
+int avl_persistent_version_search(AVLPersistentNode* version, uint32_t id,
+                                  AVLPersistentNode** node, bool* found);
+
+/**
+ *  @brief Get the number of nodes of a version.
+ *  @param[in] version Version (may be NULL).
+ *  @param[out] size Number of nodes.
+ *  @return return code.
+ **/
+int avl_persistent_version_get_size(AVLPersistentNode* version, int* size);
+
+/**
+ *  @brief Releases a version, freeing the nodes no other version shares.
+ *  @param[in,out] version Version to release, set to NULL.
+ *  @return return code.
+ **/
+int avl_persistent_version_release(AVLPersistentNode** version);
+
+#endif // AVL_PERSISTENT_TREE_HPP
@@ -0,0 +1,125 @@
+#ifndef AVL_SHARDED_TREE_HPP
+#define AVL_SHARDED_TREE_HPP
+
+#include "include/data_structures/avl_tree.hpp"
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+//! Default number of shards of a sharded tree
+#define AVL_SHARDED_TREE_SHARDS 16
+
+/**
+ *  Shard of a sharded tree: an independent AVL Tree holding the keys in
+ *  [lo, next shard lo - 1], with its own lock and node pool. Padded to a
+ *  cache line, so that the locks of neighbour shards don't share one.
+ **/
+struct AVLShard {
+  //! Lowest key of the shard (read without the lock to route a key)
+  std::atomic<uint32_t> lo{MIN_ID};
+  //! Protects the tree and the pool of the shard
+  std::mutex lock;
+  //! Root node of the shard tree
+  AVLNode* root = NULL;
+  //! Node pool of the shard tree
+  AVLNodePool* pool = NULL;
+  char padding[64];
+};
+
+/**
+ *  AVL Tree sharded by key range. The MIN_ID..MAX_ID key space is split
+ *  into contiguous ranges, each one an independent AVL Tree, so writers of
+ *  different ranges don't serialize on one root. Shard boundaries start
+ *  evenly spaced and are moved to the key quantiles by
+ *  avl_sharded_tree_rebalance, to spread skewed IDs evenly.
+ **/
+struct AVLShardedTree {
+  //! Shards in key order
+  std::vector<AVLShard> shards;
+
+  explicit AVLShardedTree(size_t num_shards) : shards(num_shards) {}
+};
+
+/**
+ *  @brief Creates an empty sharded AVL Tree, with the key space split
+ *  evenly among the shards.
+ *  @param[out] tree Sharded tree to create.
+ *  @param[in] num_shards Number of shards.
+ *  @return return code.
+ **/
+int avl_sharded_tree_create(AVLShardedTree** tree,
+                            size_t num_shards = AVL_SHARDED_TREE_SHARDS);
+
+/**
+ *  @brief Destroys the sharded AVL Tree and all its shards.
+ *  No other thread may be using the tree.
+ *  @param[in,out] tree Sharded tree to destroy.
+ *  @return return code.
+ **/
+int avl_sharded_tree_destroy(AVLShardedTree** tree);
+
+/**
+ *  @brief Insert a new node, locking only the shard of its key.
+ *  @param[in] tree Sharded tree.
+ *  @param[in] id ID of the person for the new node.
+ *  @param[in] name Name of the person for the new node.
+ *  @return return code.
+ **/
+int avl_sharded_tree_insert(AVLShardedTree* tree, uint32_t id,
+                            std::string name);
+
+/**
+ *  @brief Remove a node, locking only the shard of its key.
+ *  @param[in] tree Sharded tree.
+ *  @param[in] id ID of the node to remove.
+ *  @return return code.
+ **/
+int avl_sharded_tree_remove(AVLShardedTree* tree, uint32_t id);
+
+/**
+ *  @brief Search for a key, locking only its shard.
+ *  @param[in] tree Sharded tree.
+ *  @param[in] id ID of the person to search for (key).
+ *  @param[out] name Name of the person, if found (may be NULL).
+ *  @param[out] found Boolean that indicates if the key was found.
+ *  @return return code.
+ **/
+int avl_sharded_tree_search(AVLShardedTree* tree, uint32_t id,
+                            std::string* name, bool* found);
+
+/**
+ *  @brief Calls a function for each node with a key in [lo, hi], in order,
+ *  across shards. Each shard is locked while its part of the range is
+ *  scanned, so the scan is consistent per shard only.
+ *  @param[in] tree Sharded tree.
+ *  @param[in] lo Lower bound of the range (inclusive).
+ *  @param[in] hi Upper bound of the range (inclusive).
+ *  @param[in] callback Function called for each node in the range.
+ *  @param[in] arg User argument passed to the callback.
+ *  @return return code.
+ **/
+int avl_sharded_tree_range_scan(AVLShardedTree* tree, uint32_t lo, uint32_t hi,
+                                avl_tree_scan_fn callback, void* arg);
+
+/**
+ *  @brief Get the number of keys in the tree, locking every shard to
+ *  count a consistent total.
+ *  @param[in] tree Sharded tree.
+ *  @param[out] size Number of keys.
+ *  @return return code.
+ **/
+int avl_sharded_tree_get_size(AVLShardedTree* tree, int* size);
+
+/**
+ *  @brief Moves the shard boundaries to the quantiles of the keys, so that
+ *  every shard holds the same number of keys, and rebuilds the shards.
+ *  Blocks every other operation while it runs. Trees with fewer keys than
+ *  shards are left as they are.
+ *  @param[in] tree Sharded tree.
+ *  @return return code.
+ **/
+int avl_sharded_tree_rebalance(AVLShardedTree* tree);
+
+#endif // AVL_SHARDED_TREE_HPP
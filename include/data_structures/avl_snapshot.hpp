@@ -0,0 +1,132 @@
+#ifndef AVL_SNAPSHOT_HPP
+#define AVL_SNAPSHOT_HPP
+
+#include "include/data_structures/avl_tree.hpp"
+#include <string>
+#include <cstdint>
+
+//! Magic bytes at the start of every snapshot file
+#define AVL_SNAPSHOT_MAGIC "AVLSNAP"
+//! Current snapshot format version
+#define AVL_SNAPSHOT_VERSION 1
+//! Flag of the snapshots holding the precomputed Eytzinger search layout
+#define AVL_SNAPSHOT_LAYOUT 0x1
+
+/**
+ *  Header of a snapshot file (64 bytes, native little-endian integers).
+ *  It is followed by 8-byte aligned sections, each zero padded to a
+ *  multiple of 8 bytes:
+ *    ids            uint32_t[size], sorted
+ *    name_offsets   uint64_t[size + 1], into the names blob
+ *    names          char[names_size]
+ *    layout_keys    uint32_t[size + 1], Eytzinger order (if flagged)
+ *    layout_ranks   uint32_t[size + 1], sorted position of each slot
+ *  The checksum covers every byte after the header.
+ **/
+struct AVLSnapshotHeader {
+  //! AVL_SNAPSHOT_MAGIC, zero padded
+  char magic[8];
+  //! Format version (AVL_SNAPSHOT_VERSION)
+  uint32_t version;
+  //! AVL_SNAPSHOT_* flags
+  uint32_t flags;
+  //! Number of entries
+  uint64_t size;
+  //! Bytes of the names blob
+  uint64_t names_size;
+  //! Checksum of the sections
+  uint64_t checksum;
+  //! Reserved for future versions, zero
+  uint64_t reserved[3];
+};
+
+/**
+ *  Read-only AVL Tree snapshot, queried in place from a mapped file.
+ *  Opening a snapshot costs no per-entry work (beyond the optional
+ *  checksum verification), pages are loaded on demand by searches.
+ **/
+struct AVLSnapshot {
+  //! Mapped snapshot file
+  const char* data = NULL;
+  //! Size of the mapped file in bytes
+  size_t file_size = 0;
+  //! Number of entries
+  uint64_t size = 0;
+  //! Sorted IDs
+  const uint32_t* ids = NULL;
+  //! Offsets of the names, parallel to the IDs (size + 1 entries)
+  const uint64_t* name_offsets = NULL;
+  //! Names of the persons, in sorted order
+  const char* names = NULL;
+  //! Keys in Eytzinger order, 1-based (NULL without layout)
+  const uint32_t* layout_keys = NULL;
+  //! Sorted position of each Eytzinger slot (NULL without layout)
+  const uint32_t* layout_ranks = NULL;
+};
+
+/**
+ *  @brief Saves an AVL Tree as a binary snapshot file.
+ *  The file is written to a unique temporary file next to the destination,
+ *  flushed to disk, renamed into place and the directory flushed, so an
+ *  existing snapshot is never replaced by a half written one, even on a
+ *  crash or a concurrent save.
+ *  @param[in] root Root node of the AVL Tree to save.
+ *  @param[in] path Snapshot file name.
+ *  @param[in] layout Whether to store the precomputed Eytzinger layout.
+ *  @return return code.
+ **/
+int avl_tree_save(AVLNode* root, std::string path, bool layout = true);
+
+/**
+ *  @brief Opens a snapshot file by mapping it in memory.
+ *  @param[in] path Snapshot file name.
+ *  @param[out] snapshot Snapshot to open.
+ *  @param[in] verify Whether to verify the checksum (reads the whole file).
+ *               The name offsets are always checked.
+ *  @return return code (INVALID_FILE on a missing, truncated, corrupt or
+ *          unsupported file).
+ **/
+int avl_tree_open_snapshot(std::string path, AVLSnapshot** snapshot,
+                           bool verify = true);
+
+/**
+ *  @brief Closes the snapshot, unmapping its file.
+ *  @param[in,out] snapshot Snapshot to close.
+ *  @return return code.
+ **/
+int avl_snapshot_close(AVLSnapshot** snapshot);
+
+/**
+ *  @brief Search for a key in the snapshot.
+ *  Uses the Eytzinger layout when present, a binary search otherwise.
+ *  @param[in] snapshot Snapshot.
+ *  @param[in] id ID of the person to search for (key).
+ *  @param[out] rank Sorted position of the lowest key not lower than id
+ *               (the snapshot size if none).
+ *  @param[out] found Boolean that indicates if the key was found.
+ *  @return return code.
+ **/
+int avl_snapshot_search(AVLSnapshot* snapshot, uint32_t id, uint32_t* rank,
+                        bool* found);
+
+/**
+ *  @brief Get the name of the person stored at a sorted position.
+ *  @param[in] snapshot Snapshot.
+ *  @param[in] rank Sorted position returned by avl_snapshot_search.
+ *  @param[out] name Name of the person.
+ *  @return return code.
+ **/
+int avl_snapshot_get_name(AVLSnapshot* snapshot, uint32_t rank,
+                          std::string* name);
+
+/**
+ *  @brief Builds a mutable AVL Tree from the snapshot, using the bulk-load path.
+ *  @param[in] snapshot Snapshot.
+ *  @param[out] root Root node of the AVL Tree to create.
+ *  @param[in] pool Node pool of the tree (NULL to use the heap).
+ *  @return return code.
+ **/
+int avl_snapshot_to_tree(AVLSnapshot* snapshot, AVLNode** root,
+                         AVLNodePool* pool = NULL);
+
+#endif // AVL_SNAPSHOT_HPP
@@ -1,10 +1,33 @@
+#ifndef AVL_TREE_HPP
+#define AVL_TREE_HPP
+
 #include <iostream>
 #include <string>
 #include <cstdint>
+#include <vector>
 
 #define MAX_ID 999999999
 #define MIN_ID 100000000
 
+//! Number of IDs covered by the existence bitmap (MIN_ID..MAX_ID)
+#define AVL_ID_BITMAP_BITS ((uint64_t) MAX_ID - MIN_ID + 1)
+
+//! Default number of lookups kept in flight by avl_tree_search_batch
+#define AVL_SEARCH_BATCH_INFLIGHT 16
+//! Maximum number of lookups kept in flight by avl_tree_search_batch
+#define AVL_SEARCH_BATCH_MAX_INFLIGHT 64
+
+//! Default number of nodes carved from each AVL node pool chunk
+#define AVL_NODE_POOL_CHUNK_SIZE 4096
+
+//! Default memory budget (bytes) of the streaming loaders
+#define AVL_STREAM_MEMORY_BUDGET (64 << 20)
+//! Largest read buffer (bytes) of the streaming loaders
+#define AVL_STREAM_BUFFER_SIZE (1 << 20)
+
+//! Smallest pair of subtrees (total nodes) a set operation forks a thread for
+#define AVL_SET_OP_GRAIN 4096
+
 //! Return codes of the avl_tree functions
 enum {
   //! Function returns without error
@@ -18,18 +41,21 @@ enum {
   //! The given key (id) was not found
   KEY_NOT_FOUND = -5,
   //! The given key (id) already exists
-  KEY_EXISTS = -6
+  KEY_EXISTS = -6,
+  //! The given position (index) is out of range
+  INVALID_INDEX = -7,
+  //! Memory could not be allocated
+  OUT_OF_MEMORY = -8
 };
 
 using db_entry = std::pair<uint32_t, std::string>;
 
-//! AVL Tree node structure
+/**
+ *  AVL Tree node structure.
+ *  Fields read while searching come first, the name (only read once the
+ *  node is found) is kept at the end, off the search path.
+ **/
 struct AVLNode {
-  //! Name of the person
-  std::string name;
-  //! ID of the person
-  uint32_t id;
-
   //! Pointer to the parent node
   AVLNode* parent = NULL;
   //! Pointer to the left child node
@@ -37,36 +63,362 @@ struct AVLNode {
   //! Pointer to the right child node
   AVLNode* rchild = NULL;
 
+  //! ID of the person
+  uint32_t id;
+
   //! Max height of the left subtree
   int lheight = 0;
   //! Max height of the right subtree
   int rheight = 0;
+
+  //! Number of nodes in the subtree rooted at this node
+  int size = 1;
+
+  //! Name of the person
+  std::string name;
+};
+
+/**
+ *  Slab allocator for the nodes of a single AVL Tree.
+ *  Nodes are carved from large contiguous chunks and released nodes are
+ *  kept in a freelist for reuse. The whole pool is released by a linear
+ *  scan of the carved slots, O(nodes) like a tree walk but sequential and
+ *  without chasing pointers, and O(chunks) deallocations.
+ **/
+struct AVLNodePool {
+  //! Contiguous chunks of node storage
+  std::vector<AVLNode*> chunks;
+  //! Number of nodes per chunk
+  size_t chunk_size = AVL_NODE_POOL_CHUNK_SIZE;
+  //! Number of nodes already carved from the last chunk (full when there
+  //! is no chunk, so that the first allocation carves one)
+  size_t chunk_used = AVL_NODE_POOL_CHUNK_SIZE;
+  //! Released nodes available for reuse (linked through lchild)
+  AVLNode* freelist = NULL;
+};
+
+/**
+ *  @brief Creates an empty AVL node pool.
+ *  @param[out] pool Node pool to create.
+ *  @param[in] chunk_size Number of nodes allocated on each chunk.
+ *  @return return code.
+ **/
+int avl_node_pool_create(AVLNodePool** pool,
+                         size_t chunk_size = AVL_NODE_POOL_CHUNK_SIZE);
+
+/**
+ *  @brief Destroys the AVL node pool, releasing all its chunks.
+ *  @param[in,out] pool Node pool to destroy.
+ *  @return return code.
+ **/
+int avl_node_pool_destroy(AVLNodePool** pool);
+
+/**
+ *  @brief Releases every node of the pool at once, keeping the pool usable.
+ *  @param[in] pool Node pool to reset.
+ *  @return return code.
+ **/
+int avl_node_pool_reset(AVLNodePool* pool);
+
+/**
+ *  @brief Allocates a new node, from the pool if given or from the heap.
+ *  @param[in] pool Node pool to allocate from (may be NULL).
+ *  @param[out] node Allocated node.
+ *  @return return code.
+ **/
+int avl_node_alloc(AVLNodePool* pool, AVLNode** node);
+
+/**
+ *  @brief Releases a node, to the pool if given or to the heap.
+ *  @param[in] pool Node pool the node was allocated from (may be NULL).
+ *  @param[in] node Node to release.
+ *  @return return code.
+ **/
+int avl_node_free(AVLNodePool* pool, AVLNode* node);
+
+/**
+ *  Existence bitmap over the whole MIN_ID..MAX_ID domain (about 112 MB,
+ *  zero pages are only committed once touched). It answers misses and
+ *  duplicate insertions without touching the tree, so it must match the
+ *  tree exactly. Kept in sync by avl_tree_create, avl_tree_insert,
+ *  avl_tree_insert_batch, avl_tree_remove and avl_tree_destroy when given
+ *  the bitmap. Every other way of building or changing a tree (bulk and
+ *  parallel loaders, streaming loaders, snapshots, join, split and set
+ *  operations, a pool reset) leaves it stale: clear it and build it again
+ *  from the resulting tree.
+ **/
+struct AVLIdBitmap {
+  //! One bit per ID, bit (id - MIN_ID) is set when the ID is in the tree
+  uint64_t* words = NULL;
 };
 
+/**
+ *  @brief Creates an empty existence bitmap.
+ *  @param[out] bitmap Existence bitmap to create.
+ *  @return return code (OUT_OF_MEMORY if the bitmap can't be allocated).
+ **/
+int avl_id_bitmap_create(AVLIdBitmap** bitmap);
+
+/**
+ *  @brief Destroys the existence bitmap.
+ *  @param[in,out] bitmap Existence bitmap to destroy.
+ *  @return return code.
+ **/
+int avl_id_bitmap_destroy(AVLIdBitmap** bitmap);
+
+/**
+ *  @brief Clears every key of the existence bitmap, releasing its pages.
+ *  @param[in] bitmap Existence bitmap to clear.
+ *  @return return code (OUT_OF_MEMORY if the bitmap can't be allocated).
+ **/
+int avl_id_bitmap_clear(AVLIdBitmap* bitmap);
+
+/**
+ *  @brief Sets the bits of every key of an existing AVL Tree.
+ *  @param[in] bitmap Existence bitmap to fill.
+ *  @param[in] root Root node of the AVL Tree.
+ *  @return return code.
+ **/
+int avl_id_bitmap_build(AVLIdBitmap* bitmap, AVLNode* root);
+
+/**
+ *  @brief Checks whether a key is set in the existence bitmap.
+ *  @param[in] bitmap Existence bitmap.
+ *  @param[in] id ID of the person (key).
+ *  @param[out] found Boolean that indicates if the key is set.
+ *  @return return code.
+ **/
+int avl_id_bitmap_test(AVLIdBitmap* bitmap, uint32_t id, bool* found);
+
+/**
+ *  @brief Sets or clears a key in the existence bitmap.
+ *  @param[in] bitmap Existence bitmap.
+ *  @param[in] id ID of the person (key).
+ *  @param[in] value Whether the key is present.
+ *  @return return code.
+ **/
+int avl_id_bitmap_set(AVLIdBitmap* bitmap, uint32_t id, bool value);
+
+/*
+ * Trees built with a node pool must always be given the same pool on
+ * insert, remove and destroy; the pool belongs to that single tree.
+ * The same applies to the existence bitmap, which must be given to every
+ * insert, remove and destroy once attached to a tree.
+ */
+
 /**
  *  @brief Creates an AVL Tree from an input file.
  *  @param[in] infile Input file name.
  *  @param[out] root Root node of the AVL Tree to create.
+ *  @param[in] pool Node pool of the tree (NULL to use the heap).
+ *  @param[in] bitmap Existence bitmap of the tree (may be NULL).
+ *  @return return code.
+ **/
+int avl_tree_create(std::string infile, AVLNode** root,
+                    AVLNodePool* pool = NULL, AVLIdBitmap* bitmap = NULL);
+
+/**
+ *  @brief Creates an AVL Tree from an input file using the bulk-load path.
+ *  Produces the same tree contents as avl_tree_create, in linear time
+ *  after parsing.
+ *  @param[in] infile Input file name.
+ *  @param[out] root Root node of the AVL Tree to create.
+ *  @param[in] pool Node pool of the tree (NULL to use the heap).
+ *  @return return code.
+ **/
+int avl_tree_create_bulk(std::string infile, AVLNode** root,
+                         AVLNodePool* pool = NULL);
+
+/**
+ *  @brief Creates an AVL Tree from an input file using several threads.
+ *  The file is split on line boundaries, each chunk is parsed and sorted
+ *  by its own thread, the chunks are merged by ID range and the top levels
+ *  of the tree are built in parallel. Produces the same tree contents as
+ *  avl_tree_create.
+ *  @param[in] infile Input file name.
+ *  @param[out] root Root node of the AVL Tree to create.
+ *  @param[in] num_threads Number of worker threads (0 for one per core).
+ *  @param[in] pool Node pool of the tree (NULL to use the heap).
+ *  @return return code.
+ **/
+int avl_tree_create_parallel(std::string infile, AVLNode** root,
+                             unsigned int num_threads = 0,
+                             AVLNodePool* pool = NULL);
+
+/**
+ *  @brief Creates an AVL Tree from an input stream, with bounded memory.
+ *  The stream is read in fixed-size buffers and the parsed entries are
+ *  staged and inserted with avl_tree_insert_batch whenever they fill the
+ *  memory budget, so the whole input is never held in memory. Produces the
+ *  same tree contents as avl_tree_create; on a parse error the partially
+ *  loaded tree is destroyed.
+ *  @param[in,out] in Input stream (a file, a pipe, std::cin...).
+ *  @param[out] root Root node of the AVL Tree to create.
+ *  @param[in] memory_budget Bytes used for the read buffer and staged entries.
+ *  @param[in] pool Node pool of the tree (NULL to use the heap).
+ *  @return return code.
+ **/
+int avl_tree_create_stream(std::istream* in, AVLNode** root,
+                           size_t memory_budget = AVL_STREAM_MEMORY_BUDGET,
+                           AVLNodePool* pool = NULL);
+
+/**
+ *  @brief Creates an AVL Tree from a file descriptor, with bounded memory.
+ *  Same as avl_tree_create_stream, reading with read(2) (STDIN_FILENO
+ *  to load from the standard input).
+ *  @param[in] fd Input file descriptor, not closed.
+ *  @param[out] root Root node of the AVL Tree to create.
+ *  @param[in] memory_budget Bytes used for the read buffer and staged entries.
+ *  @param[in] pool Node pool of the tree (NULL to use the heap).
+ *  @return return code.
+ **/
+int avl_tree_create_fd(int fd, AVLNode** root,
+                       size_t memory_budget = AVL_STREAM_MEMORY_BUDGET,
+                       AVLNodePool* pool = NULL);
+
+/**
+ *  @brief Builds a perfectly balanced AVL Tree from a list of DB entries.
+ *  Entries are radix sorted by ID, out of range IDs and duplicates are
+ *  dropped (the first occurrence wins, as with repeated insertions).
+ *  @param[in,out] db_list DB entries to load, names are moved into the tree.
+ *  @param[out] root Root node of the AVL Tree to create.
+ *  @param[in] pool Node pool of the tree (NULL to use the heap).
  *  @return return code.
  **/
-int avl_tree_create(std::string infile, AVLNode** root);
+int avl_tree_bulk_load(std::vector<db_entry>* db_list, AVLNode** root,
+                       AVLNodePool* pool = NULL);
 
 /**
  *  @brief Destroys the AVL Tree, releasing all nodes memory.
+ *  When a pool is given, the pool is reset instead of walking the tree.
  *  @param[in,out] root Root node of the AVL Tree to destroy.
+ *  @param[in] pool Node pool of the tree (NULL to use the heap).
+ *  @param[in] bitmap Existence bitmap of the tree, cleared (may be NULL).
  *  @return return code.
  **/
-int avl_tree_destroy(AVLNode** root);
+int avl_tree_destroy(AVLNode** root, AVLNodePool* pool = NULL,
+                     AVLIdBitmap* bitmap = NULL);
 
 /**
  *  @brief Insert a new node into the AVL Tree.
  *  @param[in,out] root Root node of the AVL Tree to insert the new node.
  *  @param[in] id ID of the person for the new node.
  *  @param[in] id Name of the person for the new node.
+ *  @param[in] pool Node pool of the tree (NULL to use the heap).
+ *  @param[in] bitmap Existence bitmap of the tree (may be NULL).
  *  @return return code.
  **/
-int avl_tree_insert(AVLNode** root, uint32_t id, std::string name);
-int avl_tree_remove(AVLNode** root, uint32_t id);
+int avl_tree_insert(AVLNode** root, uint32_t id, std::string name,
+                    AVLNodePool* pool = NULL, AVLIdBitmap* bitmap = NULL);
+
+/**
+ *  @brief Insert a batch of new nodes into the AVL Tree.
+ *  The batch is sorted, split recursively around the nodes it descends
+ *  through (one descent per shared path) and each affected subtree is
+ *  rebalanced once, by joining its updated children back together.
+ *  @param[in,out] root Root node of the AVL Tree to insert the new nodes.
+ *  @param[in,out] db_list DB entries to insert, names are moved into the tree.
+ *  @param[out] results Return code of each entry, the same that repeated
+ *               avl_tree_insert calls in list order would give.
+ *  @param[in] pool Node pool of the tree (NULL to use the heap).
+ *  @param[in] bitmap Existence bitmap of the tree (may be NULL).
+ *  @return return code.
+ **/
+int avl_tree_insert_batch(AVLNode** root, std::vector<db_entry>* db_list,
+                          std::vector<int>* results, AVLNodePool* pool = NULL,
+                          AVLIdBitmap* bitmap = NULL);
+
+/**
+ *  @brief Removes a node from the AVL Tree.
+ *  @param[in,out] root Root node of the AVL Tree to remove the node from.
+ *  @param[in] id ID of the person of the node to remove (key).
+ *  @param[in] pool Node pool of the tree (NULL to use the heap).
+ *  @param[in] bitmap Existence bitmap of the tree (may be NULL).
+ *  @return return code.
+ **/
+int avl_tree_remove(AVLNode** root, uint32_t id, AVLNodePool* pool = NULL,
+                    AVLIdBitmap* bitmap = NULL);
+
+/**
+ *  @brief Joins two AVL Trees and a middle node into one AVL Tree, in
+ *  O(|h(left) - h(right)|) after checking the key order.
+ *  @param[in,out] left AVL Tree with every key lower than the node key
+ *               (may be empty), consumed (set to NULL).
+ *  @param[in] node Detached node (no children) to join between both trees.
+ *  @param[in,out] right AVL Tree with every key greater than the node key
+ *               (may be empty), consumed (set to NULL).
+ *  @param[out] root Root node of the joined AVL Tree.
+ *  @return return code (INVALID_KEY if the keys are out of order).
+ **/
+int avl_tree_join(AVLNode** left, AVLNode* node, AVLNode** right, AVLNode** root);
+
+/**
+ *  @brief Joins two AVL Trees into one AVL Tree, in O(log n).
+ *  @param[in,out] left AVL Tree with every key lower than the keys of
+ *               right (may be empty), consumed (set to NULL).
+ *  @param[in,out] right AVL Tree (may be empty), consumed (set to NULL).
+ *  @param[out] root Root node of the joined AVL Tree.
+ *  @return return code (INVALID_KEY if the keys are out of order).
+ **/
+int avl_tree_join2(AVLNode** left, AVLNode** right, AVLNode** root);
+
+/**
+ *  @brief Splits an AVL Tree around a key, in O(log n).
+ *  @param[in,out] root AVL Tree to split (may be empty), consumed (set to NULL).
+ *  @param[in] id ID of the person to split by (key).
+ *  @param[out] left AVL Tree of the keys lower than id.
+ *  @param[out] node Detached node of the key (NULL if not in the tree).
+ *  @param[out] right AVL Tree of the keys greater than id.
+ *  @return return code.
+ **/
+int avl_tree_split(AVLNode** root, uint32_t id, AVLNode** left,
+                   AVLNode** node, AVLNode** right);
+
+/*
+ * Set operations combine two AVL Trees (either may be empty) into a new
+ * one, consuming both: nodes are relinked instead of copied and dropped
+ * nodes are released. They run in O(m log(n/m + 1)) work for trees of
+ * sizes m <= n, recursing on both halves in parallel (polylog span).
+ * Both trees must come from the given node pool, which the result keeps.
+ * When both trees hold a key, the entry of the first one is kept.
+ */
+
+/**
+ *  @brief Union of two AVL Trees, the keys in either tree.
+ *  @param[in,out] first First AVL Tree, consumed (set to NULL).
+ *  @param[in,out] second Second AVL Tree, consumed (set to NULL).
+ *  @param[out] root Root node of the resulting AVL Tree.
+ *  @param[in] pool Node pool of both trees (NULL to use the heap).
+ *  @param[in] num_threads Maximum number of threads (0 for one per core).
+ *  @return return code.
+ **/
+int avl_tree_union(AVLNode** first, AVLNode** second, AVLNode** root,
+                   AVLNodePool* pool = NULL, unsigned int num_threads = 0);
+
+/**
+ *  @brief Intersection of two AVL Trees, the keys in both trees.
+ *  @param[in,out] first First AVL Tree, consumed (set to NULL).
+ *  @param[in,out] second Second AVL Tree, consumed (set to NULL).
+ *  @param[out] root Root node of the resulting AVL Tree.
+ *  @param[in] pool Node pool of both trees (NULL to use the heap).
+ *  @param[in] num_threads Maximum number of threads (0 for one per core).
+ *  @return return code.
+ **/
+int avl_tree_intersection(AVLNode** first, AVLNode** second, AVLNode** root,
+                          AVLNodePool* pool = NULL, unsigned int num_threads = 0);
+
+/**
+ *  @brief Difference of two AVL Trees, the keys of the first tree that
+ *  are not in the second one.
+ *  @param[in,out] first First AVL Tree, consumed (set to NULL).
+ *  @param[in,out] second Second AVL Tree, consumed (set to NULL).
+ *  @param[out] root Root node of the resulting AVL Tree.
+ *  @param[in] pool Node pool of both trees (NULL to use the heap).
+ *  @param[in] num_threads Maximum number of threads (0 for one per core).
+ *  @return return code.
+ **/
+int avl_tree_difference(AVLNode** first, AVLNode** second, AVLNode** root,
+                        AVLNodePool* pool = NULL, unsigned int num_threads = 0);
 
 /**
  *  @brief Search for a node in the AVL Tree.
@@ -75,9 +427,142 @@ int avl_tree_remove(AVLNode** root, uint32_t id);
  *  @param[out] node Last node after tree search traversal.
  *  @param[out] found Boolean that indicates if the node was found,
  *               in which case the node parameter points to the found node.
+ *  @param[in] bitmap Existence bitmap of the tree (may be NULL). When it
+ *               reports the key as absent the tree is not traversed and
+ *               node is set to NULL.
+ *  @return return code.
+ **/
+int avl_tree_search(AVLNode* root, uint32_t id, AVLNode** node, bool* found,
+                    AVLIdBitmap* bitmap = NULL);
+
+/**
+ *  @brief Search for a batch of keys in the AVL Tree.
+ *  Lookups are interleaved: each one advances a level at a time while the
+ *  next node it needs is prefetched, so the cache misses of the lookups in
+ *  flight overlap instead of being paid one after the other.
+ *  @param[in] root Root node of the AVL Tree.
+ *  @param[in] ids IDs of the persons to search for (keys).
+ *  @param[in] n Number of keys.
+ *  @param[out] results Found node for each key (NULL if not found).
+ *  @param[in] inflight Number of lookups walked at once (prefetch distance),
+ *               up to AVL_SEARCH_BATCH_MAX_INFLIGHT.
+ *  @return return code.
+ **/
+int avl_tree_search_batch(AVLNode* root, const uint32_t* ids, size_t n,
+                          AVLNode** results,
+                          size_t inflight = AVL_SEARCH_BATCH_INFLIGHT);
+
+/**
+ *  @brief Get the rank (in-order position) of a key in the AVL Tree.
+ *  @param[in] root Root node of the AVL Tree.
+ *  @param[in] id ID of the person (key).
+ *  @param[out] rank Number of keys lower than the given key, which is the
+ *               0-based position of the key when found.
+ *  @return return code (KEY_NOT_FOUND if the key is not in the tree).
+ **/
+int avl_tree_get_rank(AVLNode* root, uint32_t id, int* rank);
+
+/**
+ *  @brief Select the k-th smallest key node of the AVL Tree.
+ *  @param[in] root Root node of the AVL Tree.
+ *  @param[in] k 0-based in-order position of the node.
+ *  @param[out] node Node found at the given position.
+ *  @return return code.
+ **/
+int avl_tree_select(AVLNode* root, int k, AVLNode** node);
+
+/**
+ *  @brief Count the keys of the AVL Tree within a range.
+ *  @param[in] root Root node of the AVL Tree.
+ *  @param[in] lo Lower bound of the range (inclusive).
+ *  @param[in] hi Upper bound of the range (inclusive).
+ *  @param[out] count Number of keys in [lo, hi].
  *  @return return code.
  **/
-int avl_tree_search(AVLNode* root, uint32_t id, AVLNode** node, bool* found);
+int avl_tree_count_range(AVLNode* root, uint32_t lo, uint32_t hi, int* count);
+
+/**
+ *  @brief Get a page of nodes in key order (offset/limit pagination).
+ *  @param[in] root Root node of the AVL Tree.
+ *  @param[in] offset 0-based in-order position of the first node.
+ *  @param[in] limit Maximum number of nodes in the page.
+ *  @param[out] page Nodes of the page, in key order.
+ *  @return return code.
+ **/
+int avl_tree_get_page(AVLNode* root, int offset, int limit,
+                      std::vector<AVLNode*>* page);
+
+/**
+ *  In-order cursor over an AVL Tree. Steps follow the parent pointers of
+ *  the nodes (amortized O(1), no allocation nor auxiliary stack), so the
+ *  tree must not be modified while a cursor is in use.
+ **/
+struct AVLCursor {
+  //! Node the cursor points to (NULL once moved past either end)
+  AVLNode* node = NULL;
+};
+
+/**
+ *  @brief Callback invoked for each node of a range scan.
+ *  @param[in] node Node in the range, in key order.
+ *  @param[in] arg User argument given to avl_tree_range_scan.
+ *  @return true to continue the scan, false to stop it.
+ **/
+typedef bool (*avl_tree_scan_fn)(AVLNode* node, void* arg);
+
+/**
+ *  @brief Places the cursor on the node of the given key.
+ *  @param[in] root Root node of the AVL Tree.
+ *  @param[in] id ID of the person (key).
+ *  @param[out] cursor Cursor on the found node (NULL node if not found).
+ *  @return return code (KEY_NOT_FOUND if the key is not in the tree).
+ **/
+int avl_tree_cursor_seek(AVLNode* root, uint32_t id, AVLCursor* cursor);
+
+/**
+ *  @brief Places the cursor on the first node with a key not lower than id.
+ *  @param[in] root Root node of the AVL Tree.
+ *  @param[in] id ID of the person (key).
+ *  @param[out] cursor Cursor on the found node (NULL node if none).
+ *  @return return code (KEY_NOT_FOUND if there is no such node).
+ **/
+int avl_tree_cursor_lower_bound(AVLNode* root, uint32_t id, AVLCursor* cursor);
+
+/**
+ *  @brief Places the cursor on the first node with a key greater than id.
+ *  @param[in] root Root node of the AVL Tree.
+ *  @param[in] id ID of the person (key).
+ *  @param[out] cursor Cursor on the found node (NULL node if none).
+ *  @return return code (KEY_NOT_FOUND if there is no such node).
+ **/
+int avl_tree_cursor_upper_bound(AVLNode* root, uint32_t id, AVLCursor* cursor);
+
+/**
+ *  @brief Moves the cursor to the next node in key order.
+ *  @param[in,out] cursor Cursor to move.
+ *  @return return code (KEY_NOT_FOUND when moving past the last node).
+ **/
+int avl_tree_cursor_next(AVLCursor* cursor);
+
+/**
+ *  @brief Moves the cursor to the previous node in key order.
+ *  @param[in,out] cursor Cursor to move.
+ *  @return return code (KEY_NOT_FOUND when moving past the first node).
+ **/
+int avl_tree_cursor_prev(AVLCursor* cursor);
+
+/**
+ *  @brief Calls a function for each node with a key in [lo, hi], in order.
+ *  The successor of each node is prefetched before its callback runs.
+ *  @param[in] root Root node of the AVL Tree.
+ *  @param[in] lo Lower bound of the range (inclusive).
+ *  @param[in] hi Upper bound of the range (inclusive).
+ *  @param[in] callback Function called for each node in the range.
+ *  @param[in] arg User argument passed to the callback.
+ *  @return return code.
+ **/
+int avl_tree_range_scan(AVLNode* root, uint32_t lo, uint32_t hi,
+                        avl_tree_scan_fn callback, void* arg);
 
 /**
  *  @brief Get the size (number of elements) in the AVL Tree.
@@ -121,9 +606,53 @@ int avl_tree_get_max_node(AVLNode* root, AVLNode** node);
  **/
 int avl_tree_get_min_node(AVLNode* root, AVLNode** node);
 
+/**
+ *  Operation counters of the AVL Tree, summed over every thread (see
+ *  avl_tree_get_stats). Only counted when built with AVL_TREE_STATS.
+ **/
+struct AVLTreeStats {
+  //! Tree traversals of avl_tree_search (insert searches included)
+  uint64_t searches = 0;
+  //! Key comparisons (nodes visited) of those traversals
+  uint64_t comparisons = 0;
+  //! Rebalance walks after an insertion or removal
+  uint64_t rebalances = 0;
+  //! Nodes visited by those walks
+  uint64_t rebalance_nodes = 0;
+  //! RR rotations (single left rotations)
+  uint64_t rotations_rr = 0;
+  //! LL rotations (single right rotations)
+  uint64_t rotations_ll = 0;
+  //! RL rotations (double rotations)
+  uint64_t rotations_rl = 0;
+  //! LR rotations (double rotations)
+  uint64_t rotations_lr = 0;
+  //! Nodes allocated, from a pool or the heap
+  uint64_t allocs = 0;
+  //! Nodes released, to a pool or the heap (a pool reset included)
+  uint64_t frees = 0;
+};
+
+/**
+ *  @brief Get the operation counters, summed over the running threads and
+ *  the exited ones. Every counter is 0 when built without AVL_TREE_STATS.
+ *  @param[out] stats Operation counters.
+ *  @return return code.
+ **/
+int avl_tree_get_stats(AVLTreeStats* stats);
+
+/**
+ *  @brief Resets the operation counters of every thread. Updates made by
+ *  other threads while resetting may be lost.
+ *  @return return code.
+ **/
+int avl_tree_reset_stats();
+
 /**
  *  @brief Prints the given AVL Tree, level by level using BFS traversal.
  *  @param[in] root Root node of the AVL Tree.
  *  @return return code.
  **/
 int avl_tree_print(AVLNode* root);
+
+#endif // AVL_TREE_HPP
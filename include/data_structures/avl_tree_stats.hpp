@@ -0,0 +1,59 @@
+#ifndef AVL_TREE_STATS_HPP
+#define AVL_TREE_STATS_HPP
+
+#include <cstdint>
+#include <atomic>
+
+/*
+ * Operation counters of the AVL Tree, only compiled in when AVL_TREE_STATS
+ * is defined (make AVL_TREE_STATS=1). Otherwise AVL_TREE_STATS_ADD expands
+ * to nothing and the counted code is the same as without statistics.
+ */
+
+//! Counters kept by each thread, in the order of the AVLTreeStats fields
+enum AVLTreeStatsCounter {
+  AVL_STATS_SEARCHES,
+  AVL_STATS_COMPARISONS,
+  AVL_STATS_REBALANCES,
+  AVL_STATS_REBALANCE_NODES,
+  AVL_STATS_ROTATIONS_RR,
+  AVL_STATS_ROTATIONS_LL,
+  AVL_STATS_ROTATIONS_RL,
+  AVL_STATS_ROTATIONS_LR,
+  AVL_STATS_ALLOCS,
+  AVL_STATS_FREES,
+  AVL_STATS_COUNTERS
+};
+
+#ifdef AVL_TREE_STATS
+
+/**
+ *  Counters of a single thread. Only the owner thread updates them (plain
+ *  relaxed load and store, no atomic read-modify-write); avl_tree_get_stats
+ *  reads them from any thread. Registered on the first update of a thread,
+ *  and folded into the totals of exited threads when the thread ends.
+ **/
+struct AVLTreeStatsThread {
+  std::atomic<uint64_t> counters[AVL_STATS_COUNTERS];
+
+  AVLTreeStatsThread();
+  ~AVLTreeStatsThread();
+};
+
+extern thread_local AVLTreeStatsThread avl_tree_stats_thread;
+
+static inline void avl_tree_stats_add(AVLTreeStatsCounter counter, uint64_t n)
+{
+  std::atomic<uint64_t>& value = avl_tree_stats_thread.counters[counter];
+  value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+#define AVL_TREE_STATS_ADD(counter, n) avl_tree_stats_add(counter, n)
+
+#else
+
+#define AVL_TREE_STATS_ADD(counter, n) ((void) 0)
+
+#endif // AVL_TREE_STATS
+
+#endif // AVL_TREE_STATS_HPP
@@ -0,0 +1,123 @@
+#ifndef AVL_WAL_HPP
+#define AVL_WAL_HPP
+
+#include "include/data_structures/avl_tree.hpp"
+#include <string>
+#include <cstdint>
+#include <vector>
+
+//! Magic bytes at the start of every write-ahead log file
+#define AVL_WAL_MAGIC "AVLWAL1"
+//! Default number of records buffered before they are written (group commit)
+#define AVL_WAL_GROUP_SIZE 64
+//! Default number of group writes between two fsync calls
+#define AVL_WAL_SYNC_INTERVAL 1
+
+//! Operations recorded in the write-ahead log
+enum {
+  AVL_WAL_INSERT = 1,
+  AVL_WAL_REMOVE = 2
+};
+
+/**
+ *  Append-only write-ahead log of the mutations of an AVL Tree.
+ *  Each record is [crc32c][op][id][name length][name] (native
+ *  little-endian integers, the CRC covers the rest of the record).
+ *  Records are buffered and written as a group, and the file is fsynced
+ *  every sync_interval group writes, trading the durability window of the
+ *  last records for fewer syscalls.
+ **/
+struct AVLWal {
+  //! Log file descriptor
+  int fd = -1;
+  //! Records waiting for the next group write
+  std::vector<char> buffer;
+  //! Number of records in the buffer
+  size_t buffered = 0;
+  //! Number of records buffered before a group write
+  size_t group_size = AVL_WAL_GROUP_SIZE;
+  //! Number of group writes between fsyncs (0 to only sync explicitly)
+  size_t sync_interval = AVL_WAL_SYNC_INTERVAL;
+  //! Group writes since the last fsync
+  size_t unsynced = 0;
+};
+
+/**
+ *  @brief Opens a write-ahead log for appending, creating it if needed.
+ *  A torn record left at the end of the log by a crash is truncated away.
+ *  @param[in] path Log file name.
+ *  @param[out] wal Write-ahead log to open.
+ *  @param[in] group_size Number of records buffered before a group write.
+ *  @param[in] sync_interval Number of group writes between fsyncs
+ *             (0 to only sync on avl_wal_sync and avl_wal_close).
+ *  @return return code.
+ **/
+int avl_wal_open(std::string path, AVLWal** wal,
+                 size_t group_size = AVL_WAL_GROUP_SIZE,
+                 size_t sync_interval = AVL_WAL_SYNC_INTERVAL);
+
+/**
+ *  @brief Writes the buffered records, fsyncs the log and closes it.
+ *  @param[in,out] wal Write-ahead log to close.
+ *  @return return code.
+ **/
+int avl_wal_close(AVLWal** wal);
+
+/**
+ *  @brief Writes the buffered records and fsyncs the log.
+ *  Every mutation logged before this call survives a crash.
+ *  @param[in] wal Write-ahead log.
+ *  @return return code.
+ **/
+int avl_wal_sync(AVLWal* wal);
+
+/**
+ *  @brief Empties the log, once its mutations are saved elsewhere
+ *  (for instance with avl_tree_save).
+ *  @param[in] wal Write-ahead log.
+ *  @return return code.
+ **/
+int avl_wal_truncate(AVLWal* wal);
+
+/**
+ *  @brief Logs an insertion, then applies it with avl_tree_insert.
+ *  @param[in] wal Write-ahead log.
+ *  @param[in,out] root Root node of the AVL Tree.
+ *  @param[in] id ID of the person for the new node.
+ *  @param[in] name Name of the person for the new node.
+ *  @param[in] pool Node pool of the tree (NULL to use the heap).
+ *  @param[in] bitmap Existence bitmap of the tree (may be NULL).
+ *  @return return code (of the log write, or of avl_tree_insert).
+ **/
+int avl_wal_insert(AVLWal* wal, AVLNode** root, uint32_t id, std::string name,
+                   AVLNodePool* pool = NULL, AVLIdBitmap* bitmap = NULL);
+
+/**
+ *  @brief Logs a removal, then applies it with avl_tree_remove.
+ *  @param[in] wal Write-ahead log.
+ *  @param[in,out] root Root node of the AVL Tree.
+ *  @param[in] id ID of the node to remove.
+ *  @param[in] pool Node pool of the tree (NULL to use the heap).
+ *  @param[in] bitmap Existence bitmap of the tree (may be NULL).
+ *  @return return code (of the log write, or of avl_tree_remove).
+ **/
+int avl_wal_remove(AVLWal* wal, AVLNode** root, uint32_t id,
+                   AVLNodePool* pool = NULL, AVLIdBitmap* bitmap = NULL);
+
+/**
+ *  @brief Replays a write-ahead log onto a base tree.
+ *  The log is reduced to the final state of each ID it touches, then the
+ *  removals are applied and the insertions loaded with
+ *  avl_tree_insert_batch. The result is the same as re-applying every
+ *  record in order. Replay stops at the first torn or corrupt record.
+ *  @param[in] path Log file name.
+ *  @param[in,out] root Root node of the base AVL Tree (may be NULL, or a
+ *                  tree rebuilt from a snapshot).
+ *  @param[in] pool Node pool of the tree (NULL to use the heap).
+ *  @param[out] records Number of records replayed (may be NULL).
+ *  @return return code.
+ **/
+int avl_wal_replay(std::string path, AVLNode** root, AVLNodePool* pool = NULL,
+                   size_t* records = NULL);
+
+#endif // AVL_WAL_HPP
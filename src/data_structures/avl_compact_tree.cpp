@@ -0,0 +1,442 @@
+#include "include/data_structures/avl_compact_tree.hpp"
+#include <string>
+#include <vector>
+#include <utility>
+
+// ID stored in the key word of a compact node
+static inline uint32_t avl_compact_node_id(const AVLCompactNode& node)
+{
+  return node.key & AVL_COMPACT_ID_MASK;
+}
+
+// Balance factor (rheight - lheight) stored in the key word of a compact node
+static inline int avl_compact_node_bf(const AVLCompactNode& node)
+{
+  return (int) (node.key >> AVL_COMPACT_ID_BITS) - 1;
+}
+
+static inline void avl_compact_node_set_bf(AVLCompactNode& node, int bf)
+{
+  node.key = (node.key & AVL_COMPACT_ID_MASK)
+           | ((uint32_t) (bf + 1) << AVL_COMPACT_ID_BITS);
+}
+
+// Replaces the link from parent (or the root) to old_child by new_child
+static void avl_compact_tree_relink(AVLCompactTree* tree, uint32_t parent,
+                                    uint32_t old_child, uint32_t new_child)
+{
+  std::vector<AVLCompactNode>& nodes = tree->nodes;
+
+  if (parent == AVL_COMPACT_NIL) {
+    tree->root = new_child;
+  } else if (nodes[parent].lchild == old_child) {
+    nodes[parent].lchild = new_child;
+  } else {
+    nodes[parent].rchild = new_child;
+  }
+
+  if (new_child != AVL_COMPACT_NIL) nodes[new_child].parent = parent;
+}
+
+// Perform compact AVL Tree RR rotation (x right heavy, z its right child)
+static uint32_t avl_compact_tree_rotate_rr(AVLCompactTree* tree, uint32_t x, uint32_t z)
+{
+  std::vector<AVLCompactNode>& nodes = tree->nodes;
+  uint32_t parent = nodes[x].parent;
+  uint32_t t = nodes[z].lchild;
+
+  nodes[x].rchild = t;
+  if (t != AVL_COMPACT_NIL) nodes[t].parent = x;
+
+  nodes[z].lchild = x;
+  nodes[x].parent = z;
+  avl_compact_tree_relink(tree, parent, x, z);
+
+  // A balanced z only happens on removals, the subtree keeps its height
+  if (avl_compact_node_bf(nodes[z]) == 0) {
+    avl_compact_node_set_bf(nodes[x], 1);
+    avl_compact_node_set_bf(nodes[z], -1);
+  } else {
+    avl_compact_node_set_bf(nodes[x], 0);
+    avl_compact_node_set_bf(nodes[z], 0);
+  }
+
+  return z;
+}
+
+// Perform compact AVL Tree LL rotation (x left heavy, z its left child)
+static uint32_t avl_compact_tree_rotate_ll(AVLCompactTree* tree, uint32_t x, uint32_t z)
+{
+  std::vector<AVLCompactNode>& nodes = tree->nodes;
+  uint32_t parent = nodes[x].parent;
+  uint32_t t = nodes[z].rchild;
+
+  nodes[x].lchild = t;
+  if (t != AVL_COMPACT_NIL) nodes[t].parent = x;
+
+  nodes[z].rchild = x;
+  nodes[x].parent = z;
+  avl_compact_tree_relink(tree, parent, x, z);
+
+  if (avl_compact_node_bf(nodes[z]) == 0) {
+    avl_compact_node_set_bf(nodes[x], -1);
+    avl_compact_node_set_bf(nodes[z], 1);
+  } else {
+    avl_compact_node_set_bf(nodes[x], 0);
+    avl_compact_node_set_bf(nodes[z], 0);
+  }
+
+  return z;
+}
+
+// Perform compact AVL Tree RL rotation (x right heavy, z its left leaning right child)
+static uint32_t avl_compact_tree_rotate_rl(AVLCompactTree* tree, uint32_t x, uint32_t z)
+{
+  std::vector<AVLCompactNode>& nodes = tree->nodes;
+  uint32_t parent = nodes[x].parent;
+  uint32_t y = nodes[z].lchild;
+  uint32_t t2 = nodes[y].lchild;
+  uint32_t t3 = nodes[y].rchild;
+  int y_bf = avl_compact_node_bf(nodes[y]);
+
+  nodes[z].lchild = t3;
+  if (t3 != AVL_COMPACT_NIL) nodes[t3].parent = z;
+  nodes[y].rchild = z;
+  nodes[z].parent = y;
+
+  nodes[x].rchild = t2;
+  if (t2 != AVL_COMPACT_NIL) nodes[t2].parent = x;
+  nodes[y].lchild = x;
+  nodes[x].parent = y;
+
+  avl_compact_tree_relink(tree, parent, x, y);
+
+  avl_compact_node_set_bf(nodes[x], (y_bf > 0) ? -1 : 0);
+  avl_compact_node_set_bf(nodes[z], (y_bf < 0) ? 1 : 0);
+  avl_compact_node_set_bf(nodes[y], 0);
+
+  return y;
+}
+
+// Perform compact AVL Tree LR rotation (x left heavy, z its right leaning left child)
+static uint32_t avl_compact_tree_rotate_lr(AVLCompactTree* tree, uint32_t x, uint32_t z)
+{
+  std::vector<AVLCompactNode>& nodes = tree->nodes;
+  uint32_t parent = nodes[x].parent;
+  uint32_t y = nodes[z].rchild;
+  uint32_t t2 = nodes[y].lchild;
+  uint32_t t3 = nodes[y].rchild;
+  int y_bf = avl_compact_node_bf(nodes[y]);
+
+  nodes[z].rchild = t2;
+  if (t2 != AVL_COMPACT_NIL) nodes[t2].parent = z;
+  nodes[y].lchild = z;
+  nodes[z].parent = y;
+
+  nodes[x].lchild = t3;
+  if (t3 != AVL_COMPACT_NIL) nodes[t3].parent = x;
+  nodes[y].rchild = x;
+  nodes[x].parent = y;
+
+  avl_compact_tree_relink(tree, parent, x, y);
+
+  avl_compact_node_set_bf(nodes[x], (y_bf < 0) ? 1 : 0);
+  avl_compact_node_set_bf(nodes[z], (y_bf > 0) ? -1 : 0);
+  avl_compact_node_set_bf(nodes[y], 0);
+
+  return y;
+}
+
+int avl_compact_tree_create(AVLCompactTree** tree)
+{
+  if (*tree != NULL) {
+    std::cerr << "Invalid tree: Given compact AVL tree pointer is not NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  *tree = new AVLCompactTree;
+  return RET_OK;
+}
+
+int avl_compact_tree_destroy(AVLCompactTree** tree)
+{
+  if (*tree == NULL) {
+    std::cerr << "Invalid tree: Given compact AVL tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  delete *tree;
+  *tree = NULL;
+
+  return RET_OK;
+}
+
+int avl_compact_tree_search(AVLCompactTree* tree, uint32_t id, uint32_t* node,
+                            bool* found)
+{
+  uint32_t next = AVL_COMPACT_NIL;
+  uint32_t node_id = 0;
+
+  *found = false;
+  *node = AVL_COMPACT_NIL;
+
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given compact AVL tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  // BST traversal over node indices
+  next = tree->root;
+  while (next != AVL_COMPACT_NIL && !*found) {
+    *node = next;
+    node_id = avl_compact_node_id(tree->nodes[next]);
+    next = (id > node_id) ? tree->nodes[next].rchild : tree->nodes[next].lchild;
+    *found = (node_id == id);
+  }
+
+  return RET_OK;
+}
+
+int avl_compact_tree_insert(AVLCompactTree* tree, uint32_t id, std::string name)
+{
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given compact AVL tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  std::vector<AVLCompactNode>& nodes = tree->nodes;
+  uint32_t current = AVL_COMPACT_NIL;
+  uint32_t node = AVL_COMPACT_NIL;
+  uint32_t child = AVL_COMPACT_NIL;
+  bool found = false;
+  int ret = RET_OK;
+
+  ret = avl_compact_tree_search(tree, id, &current, &found);
+  if (ret) return ret;
+
+  if (found) {
+    std::cerr << "Invalid insertion: Key already exists" << std::endl;
+    return KEY_EXISTS;
+  }
+
+  if ((id < MIN_ID) || (id > MAX_ID)) {
+    std::cerr << "Invalid key (" << id << "): Value out of range" << std::endl;
+    return INVALID_KEY;
+  }
+
+  // Arena space isn't reclaimed, so offsets could wrap past the last name
+  if (name.size() > AVL_COMPACT_MAX_ARENA - tree->name_arena.size()) {
+    std::cerr << "Out of memory: The compact AVL tree name arena is full" << std::endl;
+    return OUT_OF_MEMORY;
+  }
+
+  // Take a released node or grow the pool
+  if (tree->freelist != AVL_COMPACT_NIL) {
+    node = tree->freelist;
+    tree->freelist = nodes[node].lchild;
+  } else {
+    node = nodes.size();
+    nodes.push_back(AVLCompactNode());
+    tree->names.push_back(AVLCompactName());
+  }
+
+  // Append the name to the arena, away from the search path
+  tree->names[node].offset = tree->name_arena.size();
+  tree->names[node].length = name.size();
+  tree->name_arena.insert(tree->name_arena.end(), name.begin(), name.end());
+
+  nodes[node].key = id;
+  avl_compact_node_set_bf(nodes[node], 0);
+  nodes[node].parent = current;
+  nodes[node].lchild = AVL_COMPACT_NIL;
+  nodes[node].rchild = AVL_COMPACT_NIL;
+  tree->size++;
+
+  if (current == AVL_COMPACT_NIL) {
+    tree->root = node;
+    return RET_OK;
+  }
+
+  if (id > avl_compact_node_id(nodes[current])) {
+    nodes[current].rchild = node;
+  } else {
+    nodes[current].lchild = node;
+  }
+
+  // Retrace upwards until a subtree keeps its height or gets rotated
+  for (child = node; current != AVL_COMPACT_NIL;
+       child = current, current = nodes[current].parent) {
+    if (child == nodes[current].rchild) {
+      if (avl_compact_node_bf(nodes[current]) > 0) {
+        if (avl_compact_node_bf(nodes[child]) < 0) {
+          avl_compact_tree_rotate_rl(tree, current, child);
+        } else {
+          avl_compact_tree_rotate_rr(tree, current, child);
+        }
+        break;
+      }
+      if (avl_compact_node_bf(nodes[current]) < 0) {
+        avl_compact_node_set_bf(nodes[current], 0);
+        break;
+      }
+      avl_compact_node_set_bf(nodes[current], 1);
+    } else {
+      if (avl_compact_node_bf(nodes[current]) < 0) {
+        if (avl_compact_node_bf(nodes[child]) > 0) {
+          avl_compact_tree_rotate_lr(tree, current, child);
+        } else {
+          avl_compact_tree_rotate_ll(tree, current, child);
+        }
+        break;
+      }
+      if (avl_compact_node_bf(nodes[current]) > 0) {
+        avl_compact_node_set_bf(nodes[current], 0);
+        break;
+      }
+      avl_compact_node_set_bf(nodes[current], -1);
+    }
+  }
+
+  return RET_OK;
+}
+
+int avl_compact_tree_remove(AVLCompactTree* tree, uint32_t id)
+{
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given compact AVL tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  std::vector<AVLCompactNode>& nodes = tree->nodes;
+  uint32_t current = AVL_COMPACT_NIL;
+  uint32_t replace = AVL_COMPACT_NIL;
+  uint32_t child = AVL_COMPACT_NIL;
+  uint32_t parent = AVL_COMPACT_NIL;
+  uint32_t subtree = AVL_COMPACT_NIL;
+  uint32_t z = AVL_COMPACT_NIL;
+  bool is_left = false;
+  bool found = false;
+  int z_bf = 0;
+  int ret = RET_OK;
+
+  ret = avl_compact_tree_search(tree, id, &current, &found);
+  if (ret) return ret;
+
+  if (!found) {
+    std::cerr << "Invalid deletion: Key not found" << std::endl;
+    return KEY_NOT_FOUND;
+  }
+
+  // A node with two children takes over its successor, which is unlinked instead
+  if (nodes[current].lchild != AVL_COMPACT_NIL && nodes[current].rchild != AVL_COMPACT_NIL) {
+    replace = nodes[current].rchild;
+    while (nodes[replace].lchild != AVL_COMPACT_NIL) replace = nodes[replace].lchild;
+
+    nodes[current].key = (nodes[current].key & ~AVL_COMPACT_ID_MASK)
+                       | avl_compact_node_id(nodes[replace]);
+    tree->names[current] = tree->names[replace];
+    current = replace;
+  }
+
+  child = (nodes[current].lchild != AVL_COMPACT_NIL) ? nodes[current].lchild
+                                                     : nodes[current].rchild;
+  parent = nodes[current].parent;
+  is_left = (parent != AVL_COMPACT_NIL) && (nodes[parent].lchild == current);
+  avl_compact_tree_relink(tree, parent, current, child);
+
+  // Release the node to the freelist (its arena space is not reclaimed)
+  tree->names[current].length = 0;
+  nodes[current].lchild = tree->freelist;
+  tree->freelist = current;
+  tree->size--;
+
+  // Retrace upwards while the subtree height keeps decreasing
+  while (parent != AVL_COMPACT_NIL) {
+    z_bf = 1;
+
+    if (is_left) {
+      if (avl_compact_node_bf(nodes[parent]) == 0) {
+        avl_compact_node_set_bf(nodes[parent], 1);
+        break;
+      }
+      if (avl_compact_node_bf(nodes[parent]) < 0) {
+        avl_compact_node_set_bf(nodes[parent], 0);
+        subtree = parent;
+      } else {
+        z = nodes[parent].rchild;
+        z_bf = avl_compact_node_bf(nodes[z]);
+        subtree = (z_bf < 0) ? avl_compact_tree_rotate_rl(tree, parent, z)
+                             : avl_compact_tree_rotate_rr(tree, parent, z);
+      }
+    } else {
+      if (avl_compact_node_bf(nodes[parent]) == 0) {
+        avl_compact_node_set_bf(nodes[parent], -1);
+        break;
+      }
+      if (avl_compact_node_bf(nodes[parent]) > 0) {
+        avl_compact_node_set_bf(nodes[parent], 0);
+        subtree = parent;
+      } else {
+        z = nodes[parent].lchild;
+        z_bf = avl_compact_node_bf(nodes[z]);
+        subtree = (z_bf > 0) ? avl_compact_tree_rotate_lr(tree, parent, z)
+                             : avl_compact_tree_rotate_ll(tree, parent, z);
+      }
+    }
+
+    // Single rotation of a balanced child keeps the subtree height
+    if (z_bf == 0) break;
+
+    parent = nodes[subtree].parent;
+    if (parent != AVL_COMPACT_NIL) is_left = (nodes[parent].lchild == subtree);
+  }
+
+  return RET_OK;
+}
+
+int avl_compact_tree_get_name(AVLCompactTree* tree, uint32_t node,
+                              std::string* name)
+{
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given compact AVL tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if (node >= tree->nodes.size()) {
+    std::cerr << "Invalid index (" << node << "): Node out of range" << std::endl;
+    return INVALID_INDEX;
+  }
+
+  name->assign(tree->name_arena.data() + tree->names[node].offset,
+               tree->names[node].length);
+  return RET_OK;
+}
+
+int avl_compact_tree_get_name_ref(AVLCompactTree* tree, uint32_t node,
+                                  const char** name, uint32_t* length)
+{
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given compact AVL tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if (node >= tree->nodes.size()) {
+    std::cerr << "Invalid index (" << node << "): Node out of range" << std::endl;
+    return INVALID_INDEX;
+  }
+
+  *name = tree->name_arena.data() + tree->names[node].offset;
+  *length = tree->names[node].length;
+  return RET_OK;
+}
+
+int avl_compact_tree_get_size(AVLCompactTree* tree, int* size)
+{
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given compact AVL tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  *size = tree->size;
+  return RET_OK;
+}
@@ -0,0 +1,381 @@
+#include "include/data_structures/avl_concurrent_tree.hpp"
+#include <algorithm>
+
+/* Retires the nodes replaced by the update just published and frees every
+ * batch retired before the oldest epoch still observed by a reader.
+ */
+static void avl_concurrent_reclaim(AVLConcurrentTree* tree)
+{
+  uint64_t oldest = 0;
+  size_t kept = 0;
+
+  if (!tree->retiring.empty()) {
+    tree->retired.emplace_back(avl_epoch_advance(&tree->epochs), std::move(tree->retiring));
+    tree->retiring.clear();
+  }
+
+  oldest = avl_epoch_oldest(&tree->epochs);
+
+  for (size_t i = 0; i < tree->retired.size(); i++) {
+    if (tree->retired[i].first < oldest) {
+      for (AVLConcurrentNode* node : tree->retired[i].second) delete node;
+    } else {
+      // A self move would empty the batch, leaking its nodes
+      if (kept != i) tree->retired[kept] = std::move(tree->retired[i]);
+      kept++;
+    }
+  }
+  tree->retired.resize(kept);
+}
+
+static inline int avl_concurrent_height(AVLConcurrentNode* node)
+{
+  return node ? node->height : 0;
+}
+
+static inline void avl_concurrent_update_height(AVLConcurrentNode* node)
+{
+  node->height = 1 + std::max(avl_concurrent_height(node->lchild),
+                              avl_concurrent_height(node->rchild));
+}
+
+// Returns a node the running update may modify, copying published nodes
+static AVLConcurrentNode* avl_concurrent_own(AVLConcurrentTree* tree, AVLConcurrentNode* node)
+{
+  AVLConcurrentNode* copy = NULL;
+
+  if (node->version == tree->version) return node;
+
+  copy = new AVLConcurrentNode(*node);
+  copy->version = tree->version;
+  tree->retiring.push_back(node);
+
+  return copy;
+}
+
+// RR rotation: z is right heavy and its right child y is not left heavy
+static AVLConcurrentNode* avl_concurrent_rotate_rr(AVLConcurrentTree* tree, AVLConcurrentNode* z)
+{
+  AVLConcurrentNode* y = avl_concurrent_own(tree, z->rchild);
+
+  z->rchild = y->lchild;
+  y->lchild = z;
+  avl_concurrent_update_height(z);
+  avl_concurrent_update_height(y);
+
+  return y;
+}
+
+// LL rotation: z is left heavy and its left child y is not right heavy
+static AVLConcurrentNode* avl_concurrent_rotate_ll(AVLConcurrentTree* tree, AVLConcurrentNode* z)
+{
+  AVLConcurrentNode* y = avl_concurrent_own(tree, z->lchild);
+
+  z->lchild = y->rchild;
+  y->rchild = z;
+  avl_concurrent_update_height(z);
+  avl_concurrent_update_height(y);
+
+  return y;
+}
+
+// RL rotation: z is right heavy and its right child is left heavy
+static AVLConcurrentNode* avl_concurrent_rotate_rl(AVLConcurrentTree* tree, AVLConcurrentNode* z)
+{
+  z->rchild = avl_concurrent_rotate_ll(tree, avl_concurrent_own(tree, z->rchild));
+  return avl_concurrent_rotate_rr(tree, z);
+}
+
+// LR rotation: z is left heavy and its left child is right heavy
+static AVLConcurrentNode* avl_concurrent_rotate_lr(AVLConcurrentTree* tree, AVLConcurrentNode* z)
+{
+  z->lchild = avl_concurrent_rotate_rr(tree, avl_concurrent_own(tree, z->lchild));
+  return avl_concurrent_rotate_ll(tree, z);
+}
+
+// Updates the height of a node of the running update and rebalances it
+static AVLConcurrentNode* avl_concurrent_rebalance(AVLConcurrentTree* tree, AVLConcurrentNode* z)
+{
+  int balance_factor = avl_concurrent_height(z->rchild) - avl_concurrent_height(z->lchild);
+
+  if (balance_factor > 1) {
+    if (avl_concurrent_height(z->rchild->lchild) > avl_concurrent_height(z->rchild->rchild)) {
+      return avl_concurrent_rotate_rl(tree, z);
+    }
+    return avl_concurrent_rotate_rr(tree, z);
+  }
+
+  if (balance_factor < -1) {
+    if (avl_concurrent_height(z->lchild->rchild) > avl_concurrent_height(z->lchild->lchild)) {
+      return avl_concurrent_rotate_lr(tree, z);
+    }
+    return avl_concurrent_rotate_ll(tree, z);
+  }
+
+  avl_concurrent_update_height(z);
+  return z;
+}
+
+// Inserts a key known to be missing, copying the path down to it
+static AVLConcurrentNode* avl_concurrent_insert_at(AVLConcurrentTree* tree,
+                                                   AVLConcurrentNode* node,
+                                                   uint32_t id, std::string* name)
+{
+  if (node == NULL) {
+    node = new AVLConcurrentNode;
+    node->id = id;
+    node->version = tree->version;
+    node->name = std::move(*name);
+    return node;
+  }
+
+  node = avl_concurrent_own(tree, node);
+  if (id < node->id) {
+    node->lchild = avl_concurrent_insert_at(tree, node->lchild, id, name);
+  } else {
+    node->rchild = avl_concurrent_insert_at(tree, node->rchild, id, name);
+  }
+
+  return avl_concurrent_rebalance(tree, node);
+}
+
+// Unlinks the minimum node of a subtree, stored in min
+static AVLConcurrentNode* avl_concurrent_remove_min(AVLConcurrentTree* tree,
+                                                    AVLConcurrentNode* node,
+                                                    AVLConcurrentNode** min)
+{
+  if (node->lchild == NULL) {
+    *min = node;
+    tree->retiring.push_back(node);
+    return node->rchild;
+  }
+
+  node = avl_concurrent_own(tree, node);
+  node->lchild = avl_concurrent_remove_min(tree, node->lchild, min);
+
+  return avl_concurrent_rebalance(tree, node);
+}
+
+// Removes a key known to be present, copying the path down to it
+static AVLConcurrentNode* avl_concurrent_remove_at(AVLConcurrentTree* tree,
+                                                   AVLConcurrentNode* node, uint32_t id)
+{
+  AVLConcurrentNode* successor = NULL;
+  AVLConcurrentNode* replacement = NULL;
+
+  if (id == node->id) {
+    tree->retiring.push_back(node);
+    if (node->lchild == NULL) return node->rchild;
+    if (node->rchild == NULL) return node->lchild;
+
+    // Two children, a copy of the successor takes the node place
+    replacement = new AVLConcurrentNode;
+    replacement->version = tree->version;
+    replacement->rchild = avl_concurrent_remove_min(tree, node->rchild, &successor);
+    replacement->lchild = node->lchild;
+    replacement->id = successor->id;
+    replacement->name = successor->name;
+
+    return avl_concurrent_rebalance(tree, replacement);
+  }
+
+  node = avl_concurrent_own(tree, node);
+  if (id < node->id) {
+    node->lchild = avl_concurrent_remove_at(tree, node->lchild, id);
+  } else {
+    node->rchild = avl_concurrent_remove_at(tree, node->rchild, id);
+  }
+
+  return avl_concurrent_rebalance(tree, node);
+}
+
+// Looks a key up in a published version
+static AVLConcurrentNode* avl_concurrent_find(AVLConcurrentNode* node, uint32_t id)
+{
+  while (node != NULL && node->id != id) {
+    node = (id < node->id) ? node->lchild : node->rchild;
+  }
+
+  return node;
+}
+
+int avl_concurrent_tree_create(AVLConcurrentTree** tree)
+{
+  if (*tree != NULL) {
+    std::cerr << "Invalid tree: Given concurrent tree pointer is not NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  *tree = new AVLConcurrentTree;
+
+  return RET_OK;
+}
+
+int avl_concurrent_tree_destroy(AVLConcurrentTree** tree)
+{
+  std::vector<AVLConcurrentNode*> pending;
+
+  if (*tree == NULL) {
+    std::cerr << "Invalid tree: Given concurrent tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if ((*tree)->root.load() != NULL) pending.push_back((*tree)->root.load());
+  while (!pending.empty()) {
+    AVLConcurrentNode* node = pending.back();
+    pending.pop_back();
+
+    if (node->lchild) pending.push_back(node->lchild);
+    if (node->rchild) pending.push_back(node->rchild);
+    delete node;
+  }
+
+  for (auto& batch : (*tree)->retired) {
+    for (AVLConcurrentNode* node : batch.second) delete node;
+  }
+
+  delete *tree;
+  *tree = NULL;
+
+  return RET_OK;
+}
+
+int avl_concurrent_tree_insert(AVLConcurrentTree* tree, uint32_t id,
+                               std::string name)
+{
+  AVLConcurrentNode* root = NULL;
+
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given concurrent tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if ((id < MIN_ID) || (id > MAX_ID)) {
+    std::cerr << "Invalid key (" << id << "): Value out of range" << std::endl;
+    return INVALID_KEY;
+  }
+
+  std::lock_guard<std::mutex> lock(tree->writer);
+
+  // The writer is the only one changing the tree, no epoch needed to read it
+  root = tree->root.load(std::memory_order_relaxed);
+  if (avl_concurrent_find(root, id) != NULL) {
+    std::cerr << "Invalid insertion: Key already exists" << std::endl;
+    return KEY_EXISTS;
+  }
+
+  tree->version++;
+  root = avl_concurrent_insert_at(tree, root, id, &name);
+
+  tree->root.store(root, std::memory_order_seq_cst);
+  tree->size.fetch_add(1, std::memory_order_relaxed);
+  avl_concurrent_reclaim(tree);
+
+  return RET_OK;
+}
+
+int avl_concurrent_tree_remove(AVLConcurrentTree* tree, uint32_t id)
+{
+  AVLConcurrentNode* root = NULL;
+
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given concurrent tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  std::lock_guard<std::mutex> lock(tree->writer);
+
+  root = tree->root.load(std::memory_order_relaxed);
+  if (avl_concurrent_find(root, id) == NULL) {
+    std::cerr << "Invalid deletion: Key not found" << std::endl;
+    return KEY_NOT_FOUND;
+  }
+
+  tree->version++;
+  root = avl_concurrent_remove_at(tree, root, id);
+
+  tree->root.store(root, std::memory_order_seq_cst);
+  tree->size.fetch_sub(1, std::memory_order_relaxed);
+  avl_concurrent_reclaim(tree);
+
+  return RET_OK;
+}
+
+int avl_concurrent_tree_search(AVLConcurrentTree* tree, uint32_t id,
+                               std::string* name, bool* found)
+{
+  AVLEpochSlot* slot = NULL;
+  AVLConcurrentNode* node = NULL;
+
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given concurrent tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  slot = avl_epoch_enter(&tree->epochs);
+
+  node = avl_concurrent_find(tree->root.load(), id);
+  *found = (node != NULL);
+  if (node && name) *name = node->name;
+
+  avl_epoch_exit(slot);
+
+  return RET_OK;
+}
+
+int avl_concurrent_tree_range_scan(AVLConcurrentTree* tree, uint32_t lo,
+                                   uint32_t hi, avl_concurrent_scan_fn callback,
+                                   void* arg)
+{
+  std::vector<AVLConcurrentNode*> pending;
+  AVLEpochSlot* slot = NULL;
+  AVLConcurrentNode* node = NULL;
+
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given concurrent tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if (lo > hi) {
+    std::cerr << "Invalid key (" << lo << "): Range lower bound above upper bound" << std::endl;
+    return INVALID_KEY;
+  }
+
+  slot = avl_epoch_enter(&tree->epochs);
+
+  // In-order walk of the version loaded here, skipping subtrees out of range
+  node = tree->root.load();
+  while (node != NULL || !pending.empty()) {
+    while (node != NULL) {
+      if (node->id < lo) {
+        node = node->rchild;
+      } else {
+        pending.push_back(node);
+        node = node->lchild;
+      }
+    }
+
+    if (pending.empty()) break;
+    node = pending.back();
+    pending.pop_back();
+
+    if (node->id > hi || !callback(node, arg)) break;
+    node = node->rchild;
+  }
+
+  avl_epoch_exit(slot);
+
+  return RET_OK;
+}
+
+int avl_concurrent_tree_get_size(AVLConcurrentTree* tree, int* size)
+{
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given concurrent tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  *size = tree->size.load(std::memory_order_relaxed);
+
+  return RET_OK;
+}
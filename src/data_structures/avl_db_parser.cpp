@@ -0,0 +1,342 @@
+#include "include/data_structures/avl_db_parser.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define AVL_DB_X86 1
+#endif
+
+//! Bytes scanned per block (one bit per byte in the masks)
+#define AVL_DB_BLOCK 64
+
+//! Initial size of the buffer of inputs read with read(2)
+#define AVL_DB_READ_SIZE (64 << 10)
+
+// Reads a whole input of unknown size (pipe, FIFO, procfs...) into a heap buffer
+static int avl_db_file_read(int fd, AVLDbFile* file)
+{
+  char* buffer = NULL;
+  char* grown = NULL;
+  size_t capacity = 0;
+  size_t size = 0;
+  ssize_t count = 0;
+
+  while (true) {
+    if (size == capacity) {
+      capacity = capacity ? 2 * capacity : AVL_DB_READ_SIZE;
+      grown = static_cast<char*>(realloc(buffer, capacity));
+      if (grown == NULL) {
+        free(buffer);
+        return INVALID_FILE;
+      }
+      buffer = grown;
+    }
+
+    count = read(fd, buffer + size, capacity - size);
+    if (count < 0 && errno == EINTR) continue;
+    if (count < 0) {
+      free(buffer);
+      return INVALID_FILE;
+    }
+    if (count == 0) break;
+    size += count;
+  }
+
+  if (size == 0) {
+    free(buffer);
+    buffer = NULL;
+  }
+
+  file->data = buffer;
+  file->size = size;
+  file->mapped = false;
+
+  return RET_OK;
+}
+
+int avl_db_file_map(const std::string& infile, AVLDbFile* file)
+{
+  struct stat st;
+  void* data = NULL;
+  int fd = open(infile.c_str(), O_RDONLY);
+  int ret = RET_OK;
+
+  if (fd < 0) return INVALID_FILE;
+
+  if (fstat(fd, &st)) {
+    close(fd);
+    return INVALID_FILE;
+  }
+
+  // Pipes and FIFOs can't be mapped, and procfs files report a 0 size,
+  // so inputs without a known size are read instead
+  if (!S_ISREG(st.st_mode) || st.st_size == 0) {
+    ret = avl_db_file_read(fd, file);
+    close(fd);
+    return ret;
+  }
+
+  data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return INVALID_FILE;
+
+  madvise(data, st.st_size, MADV_SEQUENTIAL);
+  file->data = static_cast<const char*>(data);
+  file->size = st.st_size;
+  file->mapped = true;
+
+  return RET_OK;
+}
+
+void avl_db_file_unmap(AVLDbFile* file)
+{
+  if (file->data != NULL) {
+    if (file->mapped) munmap(const_cast<char*>(file->data), file->size);
+    else free(const_cast<char*>(file->data));
+  }
+  file->data = NULL;
+  file->size = 0;
+  file->mapped = false;
+}
+
+/* Block scan kernels. Each one sets bit i of the masks when byte i of the
+ * 64-byte block is a comma or a newline.
+ */
+static void avl_db_scan_scalar(const char* block, uint64_t* commas, uint64_t* newlines)
+{
+  *commas = 0;
+  *newlines = 0;
+
+  for (int i = 0; i < AVL_DB_BLOCK; i++) {
+    *commas |= (uint64_t) (block[i] == ',') << i;
+    *newlines |= (uint64_t) (block[i] == '\n') << i;
+  }
+}
+
+#ifdef AVL_DB_X86
+__attribute__((target("avx2")))
+static void avl_db_scan_avx2(const char* block, uint64_t* commas, uint64_t* newlines)
+{
+  const __m256i comma_vec = _mm256_set1_epi8(',');
+  const __m256i newline_vec = _mm256_set1_epi8('\n');
+  __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+  __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+
+  *commas = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, comma_vec))
+          | ((uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, comma_vec)) << 32);
+  *newlines = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline_vec))
+            | ((uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline_vec)) << 32);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void avl_db_scan_avx512(const char* block, uint64_t* commas, uint64_t* newlines)
+{
+  __m512i bytes = _mm512_loadu_si512(block);
+
+  *commas = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8(','));
+  *newlines = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('\n'));
+}
+#endif
+
+using avl_db_scan_fn = void (*)(const char*, uint64_t*, uint64_t*);
+
+// Selects the widest block scan kernel supported by the running CPU
+static avl_db_scan_fn avl_db_select_kernel(const char** name)
+{
+#ifdef AVL_DB_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512bw")) {
+    *name = "avx512";
+    return avl_db_scan_avx512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    *name = "avx2";
+    return avl_db_scan_avx2;
+  }
+#endif
+  *name = "scalar";
+  return avl_db_scan_scalar;
+}
+
+static const char* avl_db_kernel_name = "scalar";
+static const avl_db_scan_fn avl_db_scan_kernel = avl_db_select_kernel(&avl_db_kernel_name);
+
+/* Converts 8 ASCII digits to their value with SWAR multiplies: pairs of
+ * digits, then groups of 4, then the whole 8 are combined in 3 steps.
+ * Returns false if any of the bytes is not a digit.
+ */
+static inline bool avl_db_parse_8digits(const char* p, uint32_t* value)
+{
+  uint64_t v = 0;
+
+  memcpy(&v, p, sizeof(v));
+
+  // Every byte in '0'..'9': high nibble is 3 and adding 6 doesn't carry into it
+  if (((v & 0xF0F0F0F0F0F0F0F0) | (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4))
+      != 0x3333333333333333) {
+    return false;
+  }
+
+  v = (v & 0x0F0F0F0F0F0F0F0F) * 2561 >> 8;
+  v = (v & 0x00FF00FF00FF00FF) * 6553601 >> 16;
+  *value = (uint32_t) ((v & 0x0000FFFF0000FFFF) * 42949672960001 >> 32);
+
+  return true;
+}
+
+/* Parses a decimal id field [p, end), skipping the blanks after the comma.
+ * IDs are 9 digits wide, that case is converted as 8 SWAR digits plus one;
+ * other widths take the generic loop. Values above UINT32_MAX saturate, so
+ * they are rejected later as out of range.
+ */
+static inline bool avl_db_parse_id(const char* p, const char* end, uint32_t* id)
+{
+  uint64_t value = 0;
+  uint32_t digit = 0;
+  uint32_t high = 0;
+
+  while (p < end && (*p == ' ' || *p == '\t')) p++;
+
+  if (end - p == 9) {
+    digit = (uint32_t) (p[8] - '0');
+    if (!avl_db_parse_8digits(p, &high) || digit >= 10) return false;
+    *id = high * 10 + digit;
+    return true;
+  }
+
+  if (p == end) return false;
+
+  for (; p < end; p++) {
+    digit = (uint32_t) (*p - '0');
+    if (digit >= 10) return false;
+    value = std::min<uint64_t>(value * 10 + digit, UINT32_MAX);
+  }
+
+  *id = value;
+  return true;
+}
+
+/* Checks and converts one line [line, line_end), given its first two comma
+ * positions (NULL if missing) and its comma count.
+ */
+static int avl_db_parse_line(const char* line, const char* line_end,
+                             const char* comma, const char* id_end, size_t commas,
+                             const std::string& infile, int lnum, std::string* error,
+                             avl_db_entry_fn add, void* arg)
+{
+  size_t cols = 0;
+  uint32_t id = 0;
+
+  // Columns as split by getline, a trailing empty column is not counted
+  cols = commas + 1;
+  if ((line == line_end) || (line_end[-1] == ',')) cols--;
+
+  if (cols != 2) {
+    *error = "Invalid number of rows " + std::to_string(cols) + " in file \""
+           + infile + "\" line " + std::to_string(lnum);
+    return INVALID_FILE;
+  }
+  if (id_end == NULL) id_end = line_end;
+
+  if (!avl_db_parse_id(comma + 1, id_end, &id)) {
+    *error = "Invalid id \"" + std::string(comma + 1, id_end) + "\" in file \""
+           + infile + "\" line " + std::to_string(lnum);
+    return INVALID_KEY;
+  }
+
+  add(id, line, comma - line, arg);
+  return RET_OK;
+}
+
+int avl_db_parse(const char* begin, const char* end, const std::string& infile,
+                 int lnum, std::string* error, avl_db_entry_fn add, void* arg)
+{
+  char tail[AVL_DB_BLOCK];
+  const char* line = begin;
+  const char* comma = NULL;
+  const char* id_end = NULL;
+  const char* pos = NULL;
+  size_t commas = 0;
+  uint64_t comma_mask = 0;
+  uint64_t newline_mask = 0;
+  uint64_t events = 0;
+  int ret = RET_OK;
+
+  for (const char* block = begin; block < end; block += AVL_DB_BLOCK) {
+    // The last partial block is scanned from a zero padded copy
+    if (end - block >= AVL_DB_BLOCK) {
+      avl_db_scan_kernel(block, &comma_mask, &newline_mask);
+    } else {
+      memset(tail, 0, sizeof(tail));
+      memcpy(tail, block, end - block);
+      avl_db_scan_kernel(tail, &comma_mask, &newline_mask);
+    }
+
+    // Walk the commas and newlines of the block in order
+    events = comma_mask | newline_mask;
+    while (events) {
+      pos = block + __builtin_ctzll(events);
+
+      if (comma_mask & events & -events) {
+        if (commas == 0) comma = pos;
+        else if (commas == 1) id_end = pos;
+        commas++;
+      } else {
+        ret = avl_db_parse_line(line, pos, comma, id_end, commas, infile, lnum,
+                                error, add, arg);
+        if (ret) return ret;
+
+        line = pos + 1;
+        comma = NULL;
+        id_end = NULL;
+        commas = 0;
+        lnum++;
+      }
+
+      events &= events - 1;
+    }
+  }
+
+  // Last line without a final newline
+  if (line < end) {
+    ret = avl_db_parse_line(line, end, comma, id_end, commas, infile, lnum,
+                            error, add, arg);
+  }
+
+  return ret;
+}
+
+// Appends a parsed entry to the DB list given as argument
+static void avl_db_list_add(uint32_t id, const char* name, size_t length, void* arg)
+{
+  static_cast<std::vector<db_entry>*>(arg)->emplace_back(id, std::string(name, length));
+}
+
+int avl_db_parse_file(std::string infile, std::vector<db_entry>* db_list)
+{
+  AVLDbFile file;
+  std::string error;
+  int ret = RET_OK;
+
+  if (avl_db_file_map(infile, &file)) return RET_OK;
+
+  ret = avl_db_parse(file.data, file.data + file.size, infile, 0, &error,
+                     avl_db_list_add, db_list);
+  avl_db_file_unmap(&file);
+
+  if (ret) std::cerr << error << std::endl;
+
+  return ret;
+}
+
+const char* avl_db_parse_kernel()
+{
+  return avl_db_kernel_name;
+}
@@ -0,0 +1,50 @@
+#include "include/data_structures/avl_epoch.hpp"
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+/* The slot CAS is sequentially consistent with the retiring thread's
+ * unlink and slot scan: a thread the scan doesn't see is ordered after the
+ * unlink, so it can't reach the nodes being freed.
+ */
+AVLEpochSlot* avl_epoch_enter(AVLEpochDomain* domain)
+{
+  size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+  uint64_t expected = 0;
+
+  for (size_t i = 0;; i++) {
+    AVLEpochSlot* slot = &domain->slots[(start + i) % AVL_EPOCH_SLOTS];
+
+    expected = 0;
+    if (slot->epoch.load(std::memory_order_relaxed) == 0 &&
+        slot->epoch.compare_exchange_strong(expected, domain->epoch.load())) {
+      return slot;
+    }
+
+    // Every slot is taken, wait for a thread to leave
+    if (i % AVL_EPOCH_SLOTS == AVL_EPOCH_SLOTS - 1) std::this_thread::yield();
+  }
+}
+
+void avl_epoch_exit(AVLEpochSlot* slot)
+{
+  slot->epoch.store(0, std::memory_order_release);
+}
+
+uint64_t avl_epoch_advance(AVLEpochDomain* domain)
+{
+  return domain->epoch.fetch_add(1);
+}
+
+uint64_t avl_epoch_oldest(AVLEpochDomain* domain)
+{
+  uint64_t oldest = UINT64_MAX;
+  uint64_t epoch = 0;
+
+  for (AVLEpochSlot& slot : domain->slots) {
+    epoch = slot.epoch.load();
+    if (epoch != 0) oldest = std::min(oldest, epoch);
+  }
+
+  return oldest;
+}
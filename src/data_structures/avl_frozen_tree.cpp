@@ -0,0 +1,160 @@
+#include "include/data_structures/avl_frozen_tree.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+//! Alignment of the frozen key array (cache line size)
+#define AVL_FROZEN_ALIGN 64
+
+// Collects the tree nodes in key order
+static void avl_tree_collect(AVLNode* root, std::vector<AVLNode*>* sorted)
+{
+  std::vector<AVLNode*> pending;
+  AVLNode* node = root;
+
+  while (node != NULL || !pending.empty()) {
+    while (node != NULL) {
+      pending.push_back(node);
+      node = node->lchild;
+    }
+
+    node = pending.back();
+    pending.pop_back();
+    sorted->push_back(node);
+    node = node->rchild;
+  }
+}
+
+// Places the sorted nodes in Eytzinger order, returns the next sorted index
+static size_t eytzinger_fill(const std::vector<AVLNode*>& sorted, size_t i,
+                             size_t k, std::vector<AVLNode*>* slots)
+{
+  if (k < slots->size()) {
+    i = eytzinger_fill(sorted, i, 2 * k, slots);
+    (*slots)[k] = sorted[i++];
+    i = eytzinger_fill(sorted, i, 2 * k + 1, slots);
+  }
+
+  return i;
+}
+
+int avl_tree_freeze(AVLNode* root, AVLFrozenTree** frozen)
+{
+  std::vector<AVLNode*> sorted;
+  std::vector<AVLNode*> slots;
+  size_t names_size = 0;
+  size_t keys_size = 0;
+  void* keys = NULL;
+
+  if (root == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if (*frozen != NULL) {
+    std::cerr << "Invalid tree: Given frozen tree pointer is not NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  sorted.reserve(root->size);
+  avl_tree_collect(root, &sorted);
+
+  slots.resize(sorted.size() + 1);
+  eytzinger_fill(sorted, 0, 1, &slots);
+
+  // Keys array rounded up to whole cache lines
+  keys_size = (slots.size() * sizeof(uint32_t) + AVL_FROZEN_ALIGN - 1)
+            & ~((size_t) AVL_FROZEN_ALIGN - 1);
+  if (posix_memalign(&keys, AVL_FROZEN_ALIGN, keys_size)) {
+    std::cerr << "Out of memory: Can't allocate the frozen tree keys" << std::endl;
+    return OUT_OF_MEMORY;
+  }
+
+  *frozen = new AVLFrozenTree;
+  (*frozen)->size = sorted.size();
+  (*frozen)->keys = static_cast<uint32_t*>(keys);
+  (*frozen)->name_offsets = new uint64_t[slots.size() + 1];
+
+  (*frozen)->keys[0] = 0;
+  (*frozen)->name_offsets[0] = 0;
+  (*frozen)->name_offsets[1] = 0;
+
+  for (size_t k = 1; k < slots.size(); k++) {
+    (*frozen)->keys[k] = slots[k]->id;
+    names_size += slots[k]->name.size();
+    (*frozen)->name_offsets[k + 1] = names_size;
+  }
+
+  (*frozen)->names = new char[names_size + 1];
+  for (size_t k = 1; k < slots.size(); k++) {
+    memcpy((*frozen)->names + (*frozen)->name_offsets[k], slots[k]->name.data(),
+           slots[k]->name.size());
+  }
+
+  return RET_OK;
+}
+
+int avl_frozen_tree_destroy(AVLFrozenTree** frozen)
+{
+  if (*frozen == NULL) {
+    std::cerr << "Invalid tree: Given frozen tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  free((*frozen)->keys);
+  delete[] (*frozen)->name_offsets;
+  delete[] (*frozen)->names;
+  delete *frozen;
+  *frozen = NULL;
+
+  return RET_OK;
+}
+
+int avl_frozen_tree_search(AVLFrozenTree* frozen, uint32_t id, uint32_t* slot,
+                           bool* found)
+{
+  const uint32_t* keys = NULL;
+  uint32_t n = 0;
+  uint32_t k = 1;
+
+  if (frozen == NULL) {
+    std::cerr << "Invalid tree: Given frozen tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  keys = frozen->keys;
+  n = frozen->size;
+
+  // Descend without branching on the comparison, prefetching the cache line
+  // holding the 16 descendants four levels below
+  while (k <= n) {
+    __builtin_prefetch(keys + 16 * k);
+    k = 2 * k + (keys[k] < id);
+  }
+
+  // Undo the trailing right turns to get the lower bound slot
+  k >>= __builtin_ffs(~k);
+
+  *slot = k;
+  *found = (k != 0) && (keys[k] == id);
+
+  return RET_OK;
+}
+
+int avl_frozen_tree_get_name(AVLFrozenTree* frozen, uint32_t slot,
+                             std::string* name)
+{
+  if (frozen == NULL) {
+    std::cerr << "Invalid tree: Given frozen tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if ((slot == 0) || (slot > frozen->size)) {
+    std::cerr << "Invalid index (" << slot << "): Slot out of range" << std::endl;
+    return INVALID_INDEX;
+  }
+
+  name->assign(frozen->names + frozen->name_offsets[slot],
+               frozen->name_offsets[slot + 1] - frozen->name_offsets[slot]);
+  return RET_OK;
+}
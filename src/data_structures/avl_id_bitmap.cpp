@@ -0,0 +1,135 @@
+#include "include/data_structures/avl_tree.hpp"
+#include <cstdlib>
+#include <vector>
+
+//! Number of 64-bit words of the existence bitmap
+#define AVL_ID_BITMAP_WORDS ((AVL_ID_BITMAP_BITS + 63) / 64)
+
+int avl_id_bitmap_create(AVLIdBitmap** bitmap)
+{
+  if (*bitmap != NULL) {
+    std::cerr << "Invalid bitmap: Given ID bitmap pointer is not NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  // calloc maps zeroed pages lazily, sparse ID sets only commit what they touch
+  *bitmap = new AVLIdBitmap;
+  (*bitmap)->words = static_cast<uint64_t*>(calloc(AVL_ID_BITMAP_WORDS, sizeof(uint64_t)));
+  if ((*bitmap)->words == NULL) {
+    std::cerr << "Out of memory: Can't allocate the ID bitmap" << std::endl;
+    delete *bitmap;
+    *bitmap = NULL;
+    return OUT_OF_MEMORY;
+  }
+
+  return RET_OK;
+}
+
+int avl_id_bitmap_clear(AVLIdBitmap* bitmap)
+{
+  uint64_t* words = NULL;
+
+  if (bitmap == NULL) {
+    std::cerr << "Invalid bitmap: Given ID bitmap pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  // Fresh zero pages instead of a memset, which would commit all 112 MB
+  words = static_cast<uint64_t*>(calloc(AVL_ID_BITMAP_WORDS, sizeof(uint64_t)));
+  if (words == NULL) {
+    std::cerr << "Out of memory: Can't allocate the ID bitmap" << std::endl;
+    return OUT_OF_MEMORY;
+  }
+
+  free(bitmap->words);
+  bitmap->words = words;
+
+  return RET_OK;
+}
+
+int avl_id_bitmap_destroy(AVLIdBitmap** bitmap)
+{
+  if (*bitmap == NULL) {
+    std::cerr << "Invalid bitmap: Given ID bitmap pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  free((*bitmap)->words);
+  delete *bitmap;
+  *bitmap = NULL;
+
+  return RET_OK;
+}
+
+int avl_id_bitmap_build(AVLIdBitmap* bitmap, AVLNode* root)
+{
+  std::vector<AVLNode*> pending;
+
+  if (bitmap == NULL) {
+    std::cerr << "Invalid bitmap: Given ID bitmap pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if (root == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  pending.push_back(root);
+  while (!pending.empty()) {
+    AVLNode* node = pending.back();
+    pending.pop_back();
+
+    avl_id_bitmap_set(bitmap, node->id, true);
+
+    if (node->lchild) pending.push_back(node->lchild);
+    if (node->rchild) pending.push_back(node->rchild);
+  }
+
+  return RET_OK;
+}
+
+int avl_id_bitmap_test(AVLIdBitmap* bitmap, uint32_t id, bool* found)
+{
+  uint64_t bit = 0;
+
+  if (bitmap == NULL) {
+    std::cerr << "Invalid bitmap: Given ID bitmap pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  // Out of range keys can never be in the tree
+  if ((id < MIN_ID) || (id > MAX_ID)) {
+    *found = false;
+    return RET_OK;
+  }
+
+  bit = id - MIN_ID;
+  *found = (bitmap->words[bit >> 6] >> (bit & 63)) & 1;
+
+  return RET_OK;
+}
+
+int avl_id_bitmap_set(AVLIdBitmap* bitmap, uint32_t id, bool value)
+{
+  uint64_t bit = 0;
+
+  if (bitmap == NULL) {
+    std::cerr << "Invalid bitmap: Given ID bitmap pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if ((id < MIN_ID) || (id > MAX_ID)) {
+    std::cerr << "Invalid key (" << id << "): Value out of range" << std::endl;
+    return INVALID_KEY;
+  }
+
+  bit = id - MIN_ID;
+  if (value) {
+    bitmap->words[bit >> 6] |= (uint64_t) 1 << (bit & 63);
+  } else {
+    bitmap->words[bit >> 6] &= ~((uint64_t) 1 << (bit & 63));
+  }
+
+  return RET_OK;
+}
@@ -0,0 +1,246 @@
+#include "include/data_structures/avl_kary_index.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define AVL_KARY_X86 1
+#endif
+
+//! Alignment of the k-ary key blocks (cache line size)
+#define AVL_KARY_ALIGN 64
+
+/* Padding key of the last blocks. IDs are below 2^30, so padding with
+ * INT32_MAX keeps every key comparable with signed 32-bit vector compares.
+ */
+#define AVL_KARY_PAD INT32_MAX
+
+// Index of the i-th child block of block k
+static inline uint32_t avl_kary_child(uint32_t k, uint32_t i)
+{
+  return k * (AVL_KARY_BLOCK + 1) + i + 1;
+}
+
+// Fills the blocks in in-order (B-tree) order, returns the next sorted index
+static uint32_t avl_kary_fill(AVLKaryIndex* index, const std::vector<AVLNode*>& sorted,
+                              uint32_t t, uint32_t k)
+{
+  if (k >= index->num_blocks) return t;
+
+  for (uint32_t i = 0; i < AVL_KARY_BLOCK; i++) {
+    t = avl_kary_fill(index, sorted, t, avl_kary_child(k, i));
+
+    if (t < sorted.size()) {
+      index->keys[k * AVL_KARY_BLOCK + i] = sorted[t]->id;
+      index->ranks[k * AVL_KARY_BLOCK + i] = t++;
+    } else {
+      index->keys[k * AVL_KARY_BLOCK + i] = AVL_KARY_PAD;
+      index->ranks[k * AVL_KARY_BLOCK + i] = sorted.size();
+    }
+  }
+
+  return avl_kary_fill(index, sorted, t, avl_kary_child(k, AVL_KARY_BLOCK));
+}
+
+/* Block search kernels. Each one walks the blocks from the root, counting
+ * the keys of the block lower than x to pick the child, and returns the
+ * slot of the last lower bound candidate seen (UINT32_MAX if none).
+ */
+static uint32_t avl_kary_search_scalar(const AVLKaryIndex* index, int32_t x)
+{
+  const int32_t* keys = reinterpret_cast<const int32_t*>(index->keys);
+  uint32_t slot = UINT32_MAX;
+  uint32_t k = 0;
+  uint32_t i = 0;
+
+  while (k < index->num_blocks) {
+    i = 0;
+    for (uint32_t j = 0; j < AVL_KARY_BLOCK; j++) i += (keys[k * AVL_KARY_BLOCK + j] < x);
+
+    if (i < AVL_KARY_BLOCK) slot = k * AVL_KARY_BLOCK + i;
+    k = avl_kary_child(k, i);
+  }
+
+  return slot;
+}
+
+#ifdef AVL_KARY_X86
+__attribute__((target("avx2")))
+static uint32_t avl_kary_search_avx2(const AVLKaryIndex* index, int32_t x)
+{
+  const __m256i x_vec = _mm256_set1_epi32(x);
+  uint32_t slot = UINT32_MAX;
+  uint32_t k = 0;
+  uint32_t i = 0;
+
+  while (k < index->num_blocks) {
+    const __m256i* block = reinterpret_cast<const __m256i*>(index->keys + k * AVL_KARY_BLOCK);
+    __m256i lo = _mm256_cmpgt_epi32(x_vec, _mm256_load_si256(block));
+    __m256i hi = _mm256_cmpgt_epi32(x_vec, _mm256_load_si256(block + 1));
+    uint32_t mask = _mm256_movemask_ps(_mm256_castsi256_ps(lo))
+                  | (_mm256_movemask_ps(_mm256_castsi256_ps(hi)) << 8);
+
+    i = __builtin_popcount(mask);
+    if (i < AVL_KARY_BLOCK) slot = k * AVL_KARY_BLOCK + i;
+    k = avl_kary_child(k, i);
+  }
+
+  return slot;
+}
+
+__attribute__((target("avx512f")))
+static uint32_t avl_kary_search_avx512(const AVLKaryIndex* index, int32_t x)
+{
+  const __m512i x_vec = _mm512_set1_epi32(x);
+  uint32_t slot = UINT32_MAX;
+  uint32_t k = 0;
+  uint32_t i = 0;
+
+  while (k < index->num_blocks) {
+    __m512i block = _mm512_load_si512(index->keys + k * AVL_KARY_BLOCK);
+    __mmask16 mask = _mm512_cmpgt_epi32_mask(x_vec, block);
+
+    i = __builtin_popcount(mask);
+    if (i < AVL_KARY_BLOCK) slot = k * AVL_KARY_BLOCK + i;
+    k = avl_kary_child(k, i);
+  }
+
+  return slot;
+}
+#endif
+
+using avl_kary_search_fn = uint32_t (*)(const AVLKaryIndex*, int32_t);
+
+// Selects the widest block compare kernel supported by the running CPU
+static avl_kary_search_fn avl_kary_select_kernel(const char** name)
+{
+#ifdef AVL_KARY_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    *name = "avx512";
+    return avl_kary_search_avx512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    *name = "avx2";
+    return avl_kary_search_avx2;
+  }
+#endif
+  *name = "scalar";
+  return avl_kary_search_scalar;
+}
+
+static const char* avl_kary_kernel_name = "scalar";
+static const avl_kary_search_fn avl_kary_search_kernel =
+  avl_kary_select_kernel(&avl_kary_kernel_name);
+
+int avl_kary_index_create(AVLNode* root, AVLKaryIndex** index)
+{
+  std::vector<AVLNode*> sorted;
+  size_t names_size = 0;
+  size_t num_blocks = 0;
+  void* keys = NULL;
+  int ret = RET_OK;
+
+  if (root == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if (*index != NULL) {
+    std::cerr << "Invalid index: Given k-ary index pointer is not NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  ret = avl_tree_get_page(root, 0, root->size, &sorted);
+  if (ret) return ret;
+
+  num_blocks = (sorted.size() + AVL_KARY_BLOCK - 1) / AVL_KARY_BLOCK;
+  if (posix_memalign(&keys, AVL_KARY_ALIGN, num_blocks * AVL_KARY_BLOCK * sizeof(uint32_t))) {
+    std::cerr << "Out of memory: Can't allocate the k-ary index keys" << std::endl;
+    return OUT_OF_MEMORY;
+  }
+
+  *index = new AVLKaryIndex;
+  (*index)->size = sorted.size();
+  (*index)->num_blocks = num_blocks;
+  (*index)->keys = static_cast<uint32_t*>(keys);
+  (*index)->ranks = new uint32_t[(*index)->num_blocks * AVL_KARY_BLOCK];
+
+  avl_kary_fill(*index, sorted, 0, 0);
+
+  (*index)->name_offsets = new uint64_t[sorted.size() + 1];
+  (*index)->name_offsets[0] = 0;
+  for (size_t i = 0; i < sorted.size(); i++) {
+    names_size += sorted[i]->name.size();
+    (*index)->name_offsets[i + 1] = names_size;
+  }
+
+  (*index)->names = new char[names_size + 1];
+  for (size_t i = 0; i < sorted.size(); i++) {
+    memcpy((*index)->names + (*index)->name_offsets[i], sorted[i]->name.data(),
+           sorted[i]->name.size());
+  }
+
+  return RET_OK;
+}
+
+int avl_kary_index_destroy(AVLKaryIndex** index)
+{
+  if (*index == NULL) {
+    std::cerr << "Invalid index: Given k-ary index pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  free((*index)->keys);
+  delete[] (*index)->ranks;
+  delete[] (*index)->name_offsets;
+  delete[] (*index)->names;
+  delete *index;
+  *index = NULL;
+
+  return RET_OK;
+}
+
+int avl_kary_index_search(AVLKaryIndex* index, uint32_t id, uint32_t* rank,
+                          bool* found)
+{
+  uint32_t slot = 0;
+
+  if (index == NULL) {
+    std::cerr << "Invalid index: Given k-ary index pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  // Keys above the padding value are greater than every stored key
+  slot = avl_kary_search_kernel(index, (id > AVL_KARY_PAD) ? AVL_KARY_PAD : id);
+
+  *rank = (slot == UINT32_MAX) ? index->size : index->ranks[slot];
+  *found = (*rank < index->size) && (index->keys[slot] == id);
+
+  return RET_OK;
+}
+
+int avl_kary_index_get_name(AVLKaryIndex* index, uint32_t rank,
+                            std::string* name)
+{
+  if (index == NULL) {
+    std::cerr << "Invalid index: Given k-ary index pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if (rank >= index->size) {
+    std::cerr << "Invalid index (" << rank << "): Rank out of range" << std::endl;
+    return INVALID_INDEX;
+  }
+
+  name->assign(index->names + index->name_offsets[rank],
+               index->name_offsets[rank + 1] - index->name_offsets[rank]);
+  return RET_OK;
+}
+
+const char* avl_kary_index_kernel()
+{
+  return avl_kary_kernel_name;
+}
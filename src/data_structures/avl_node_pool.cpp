@@ -0,0 +1,123 @@
+#include "include/data_structures/avl_tree.hpp"
+#include "include/data_structures/avl_tree_stats.hpp"
+#include <new>
+#include <vector>
+
+int avl_node_pool_create(AVLNodePool** pool, size_t chunk_size)
+{
+  if (*pool != NULL) {
+    std::cerr << "Invalid pool: Given AVL node pool pointer is not NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  *pool = new AVLNodePool;
+  (*pool)->chunk_size = (chunk_size > 0) ? chunk_size : AVL_NODE_POOL_CHUNK_SIZE;
+  (*pool)->chunk_used = (*pool)->chunk_size;
+
+  return RET_OK;
+}
+
+int avl_node_pool_destroy(AVLNodePool** pool)
+{
+  if (*pool == NULL) {
+    std::cerr << "Invalid pool: Given AVL node pool pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  avl_node_pool_reset(*pool);
+  delete *pool;
+  *pool = NULL;
+
+  return RET_OK;
+}
+
+int avl_node_pool_reset(AVLNodePool* pool)
+{
+  size_t used = 0;
+
+  if (pool == NULL) {
+    std::cerr << "Invalid pool: Given AVL node pool pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+#ifdef AVL_TREE_STATS
+  // The carved nodes not already released are released by the reset
+  used = pool->chunks.empty() ? 0 : (pool->chunks.size() - 1) * pool->chunk_size + pool->chunk_used;
+  for (AVLNode* node = pool->freelist; node != NULL; node = node->lchild) used--;
+  AVL_TREE_STATS_ADD(AVL_STATS_FREES, used);
+#endif
+
+  // Every carved slot holds a constructed node (freed ones have empty names),
+  // so chunks are scanned linearly instead of walking the tree
+  for (size_t i = 0; i < pool->chunks.size(); i++) {
+    used = (i + 1 == pool->chunks.size()) ? pool->chunk_used : pool->chunk_size;
+    for (size_t j = 0; j < used; j++) pool->chunks[i][j].~AVLNode();
+    ::operator delete(pool->chunks[i]);
+  }
+
+  pool->chunks.clear();
+  pool->chunk_used = pool->chunk_size;
+  pool->freelist = NULL;
+
+  return RET_OK;
+}
+
+int avl_node_alloc(AVLNodePool* pool, AVLNode** node)
+{
+  AVLNode* chunk = NULL;
+
+  AVL_TREE_STATS_ADD(AVL_STATS_ALLOCS, 1);
+
+  if (pool == NULL) {
+    *node = new AVLNode;
+    return RET_OK;
+  }
+
+  // Reuse a released node if available
+  if (pool->freelist) {
+    *node = pool->freelist;
+    pool->freelist = (*node)->lchild;
+    (*node)->lchild = NULL;
+    return RET_OK;
+  }
+
+  // Carve a new chunk when the last one is exhausted
+  if (pool->chunks.empty() || pool->chunk_used >= pool->chunk_size) {
+    chunk = static_cast<AVLNode*>(::operator new(pool->chunk_size * sizeof(AVLNode)));
+    pool->chunks.push_back(chunk);
+    pool->chunk_used = 0;
+  }
+
+  *node = new (&pool->chunks.back()[pool->chunk_used]) AVLNode;
+  pool->chunk_used++;
+
+  return RET_OK;
+}
+
+int avl_node_free(AVLNodePool* pool, AVLNode* node)
+{
+  if (node == NULL) {
+    std::cerr << "Invalid node: Given AVL node pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  AVL_TREE_STATS_ADD(AVL_STATS_FREES, 1);
+
+  if (pool == NULL) {
+    delete node;
+    return RET_OK;
+  }
+
+  // Keep the node constructed (so the pool can be scanned on reset),
+  // only releasing the name storage
+  std::string().swap(node->name);
+  node->parent = NULL;
+  node->rchild = NULL;
+  node->lheight = 0;
+  node->rheight = 0;
+  node->size = 1;
+  node->lchild = pool->freelist;
+  pool->freelist = node;
+
+  return RET_OK;
+}
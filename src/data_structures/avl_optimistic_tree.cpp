@@ -0,0 +1,774 @@
+#include "include/data_structures/avl_optimistic_tree.hpp"
+#include <algorithm>
+#include <thread>
+
+//! Version of a node unlinked from the tree
+#define AVL_OPTIMISTIC_UNLINKED 1
+//! Version bit set while a rotation moves keys out of the node subtree
+#define AVL_OPTIMISTIC_SHRINKING 2
+//! Version increment of a completed change
+#define AVL_OPTIMISTIC_CHANGE 4
+//! Version checks before a thread blocks on a node being rotated
+#define AVL_OPTIMISTIC_SPINS 100
+
+//! Internal code of an attempt invalidated by a concurrent change
+#define AVL_OPTIMISTIC_RETRY 1
+
+//! Node conditions, any other value is the height the node should have
+#define AVL_OPTIMISTIC_NOTHING_REQUIRED -1
+#define AVL_OPTIMISTIC_REBALANCE_REQUIRED -2
+#define AVL_OPTIMISTIC_UNLINK_REQUIRED -3
+
+static inline int avl_optimistic_height(AVLOptimisticNode* node)
+{
+  return node ? node->height.load() : 0;
+}
+
+// Child link of a node, left for negative directions and right otherwise
+static inline std::atomic<AVLOptimisticNode*>& avl_optimistic_child(AVLOptimisticNode* node,
+                                                                    int dir)
+{
+  return (dir < 0) ? node->lchild : node->rchild;
+}
+
+static inline bool avl_optimistic_unlinked(AVLOptimisticNode* node)
+{
+  return node->version.load() == AVL_OPTIMISTIC_UNLINKED;
+}
+
+static inline uint64_t avl_optimistic_begin_change(uint64_t version)
+{
+  return version | AVL_OPTIMISTIC_SHRINKING;
+}
+
+static inline uint64_t avl_optimistic_end_change(uint64_t version)
+{
+  return (version & ~(uint64_t) AVL_OPTIMISTIC_SHRINKING) + AVL_OPTIMISTIC_CHANGE;
+}
+
+// Waits for the rotation shrinking the node, if any, to complete
+static void avl_optimistic_wait(AVLOptimisticNode* node, uint64_t version)
+{
+  if (!(version & AVL_OPTIMISTIC_SHRINKING)) return;
+
+  for (int i = 0; i < AVL_OPTIMISTIC_SPINS; i++) {
+    if (node->version.load() != version) return;
+    std::this_thread::yield();
+  }
+
+  // The rotation holds the node lock until the change is complete
+  std::lock_guard<std::mutex> lock(node->lock);
+}
+
+/* Retires an unlinked node or a replaced name, freeing the ones retired
+ * before the oldest epoch of the threads inside the tree once enough of
+ * them piled up.
+ */
+static void avl_optimistic_retire(AVLOptimisticTree* tree, AVLOptimisticNode* node,
+                                  const std::string* name)
+{
+  uint64_t oldest = 0;
+  size_t kept = 0;
+
+  std::lock_guard<std::mutex> lock(tree->reclaim);
+
+  tree->retired.push_back({tree->epochs.epoch.load(), node, name});
+  if (tree->retired.size() < tree->reclaim_threshold) return;
+
+  avl_epoch_advance(&tree->epochs);
+  oldest = avl_epoch_oldest(&tree->epochs);
+
+  for (AVLOptimisticRetired& entry : tree->retired) {
+    if (entry.epoch < oldest) {
+      delete entry.node;
+      delete entry.name;
+    } else {
+      tree->retired[kept++] = entry;
+    }
+  }
+  tree->retired.resize(kept);
+  tree->reclaim_threshold = kept + AVL_OPTIMISTIC_RECLAIM_BATCH;
+}
+
+// Checks what a node needs: an unlink, a rotation or a new height
+static int avl_optimistic_condition(AVLOptimisticNode* node)
+{
+  AVLOptimisticNode* lchild = node->lchild.load();
+  AVLOptimisticNode* rchild = node->rchild.load();
+  int lheight = 0;
+  int rheight = 0;
+  int height = 0;
+
+  if ((lchild == NULL || rchild == NULL) && node->name.load() == NULL) {
+    return AVL_OPTIMISTIC_UNLINK_REQUIRED;
+  }
+
+  lheight = avl_optimistic_height(lchild);
+  rheight = avl_optimistic_height(rchild);
+  height = 1 + std::max(lheight, rheight);
+
+  if (std::abs(lheight - rheight) > 1) return AVL_OPTIMISTIC_REBALANCE_REQUIRED;
+
+  return (height != node->height.load()) ? height : AVL_OPTIMISTIC_NOTHING_REQUIRED;
+}
+
+/* Updates the height of a locked node. Returns the next node to repair:
+ * the node itself if it needs a rotation or an unlink, its parent if its
+ * height changed, or NULL.
+ */
+static AVLOptimisticNode* avl_optimistic_fix_height(AVLOptimisticNode* node)
+{
+  int condition = avl_optimistic_condition(node);
+
+  switch (condition) {
+    case AVL_OPTIMISTIC_REBALANCE_REQUIRED:
+    case AVL_OPTIMISTIC_UNLINK_REQUIRED:
+      return node;
+    case AVL_OPTIMISTIC_NOTHING_REQUIRED:
+      return NULL;
+    default:
+      node->height = condition;
+      return node->parent.load();
+  }
+}
+
+// Unlinks a locked node with at most one child from its locked parent
+static bool avl_optimistic_unlink(AVLOptimisticNode* parent, AVLOptimisticNode* node)
+{
+  AVLOptimisticNode* lchild = node->lchild.load();
+  AVLOptimisticNode* rchild = node->rchild.load();
+  AVLOptimisticNode* splice = NULL;
+  bool left = (parent->lchild.load() == node);
+
+  if (!left && parent->rchild.load() != node) return false;
+  if (lchild != NULL && rchild != NULL) return false;
+
+  splice = (lchild != NULL) ? lchild : rchild;
+  if (left) parent->lchild = splice;
+  else parent->rchild = splice;
+  if (splice) splice->parent = parent;
+
+  node->version = AVL_OPTIMISTIC_UNLINKED;
+  node->name = NULL;
+
+  return true;
+}
+
+/* Right rotation of n under its parent, moving its left child nL up.
+ * Parent, n and nL are locked. The heights are the ones observed by the
+ * caller. Returns the next node to repair.
+ */
+static AVLOptimisticNode* avl_optimistic_rotate_right(AVLOptimisticNode* parent,
+                                                      AVLOptimisticNode* n,
+                                                      AVLOptimisticNode* nL, int hR,
+                                                      int hLL, AVLOptimisticNode* nLR,
+                                                      int hLR)
+{
+  uint64_t version = n->version.load();
+  AVLOptimisticNode* parent_left = parent->lchild.load();
+  int hNRepl = 0;
+
+  n->version = avl_optimistic_begin_change(version);
+
+  n->lchild = nLR;
+  if (nLR) nLR->parent = n;
+
+  nL->rchild = n;
+  n->parent = nL;
+
+  if (parent_left == n) parent->lchild = nL;
+  else parent->rchild = nL;
+  nL->parent = parent;
+
+  hNRepl = 1 + std::max(hLR, hR);
+  n->height = hNRepl;
+  nL->height = 1 + std::max(hLL, hNRepl);
+
+  n->version = avl_optimistic_end_change(version);
+
+  // Repair the lowest node still damaged first
+  if (std::abs(hLR - hR) > 1) return n;
+  if ((nLR == NULL || hR == 0) && n->name.load() == NULL) return n;
+  if (std::abs(hLL - hNRepl) > 1) return nL;
+  if (hLL == 0 && nL->name.load() == NULL) return nL;
+
+  return avl_optimistic_fix_height(parent);
+}
+
+// Mirror of avl_optimistic_rotate_right, moving the right child nR up
+static AVLOptimisticNode* avl_optimistic_rotate_left(AVLOptimisticNode* parent,
+                                                     AVLOptimisticNode* n, int hL,
+                                                     AVLOptimisticNode* nR,
+                                                     AVLOptimisticNode* nRL, int hRL,
+                                                     int hRR)
+{
+  uint64_t version = n->version.load();
+  AVLOptimisticNode* parent_left = parent->lchild.load();
+  int hNRepl = 0;
+
+  n->version = avl_optimistic_begin_change(version);
+
+  n->rchild = nRL;
+  if (nRL) nRL->parent = n;
+
+  nR->lchild = n;
+  n->parent = nR;
+
+  if (parent_left == n) parent->lchild = nR;
+  else parent->rchild = nR;
+  nR->parent = parent;
+
+  hNRepl = 1 + std::max(hL, hRL);
+  n->height = hNRepl;
+  nR->height = 1 + std::max(hNRepl, hRR);
+
+  n->version = avl_optimistic_end_change(version);
+
+  if (std::abs(hRL - hL) > 1) return n;
+  if ((nRL == NULL || hL == 0) && n->name.load() == NULL) return n;
+  if (std::abs(hRR - hNRepl) > 1) return nR;
+  if (hRR == 0 && nR->name.load() == NULL) return nR;
+
+  return avl_optimistic_fix_height(parent);
+}
+
+/* Double rotation of n, moving the right child nLR of its left child nL
+ * up (LR case). Parent, n, nL and nLR are locked.
+ */
+static AVLOptimisticNode* avl_optimistic_rotate_right_over_left(AVLOptimisticNode* parent,
+                                                                AVLOptimisticNode* n,
+                                                                AVLOptimisticNode* nL,
+                                                                int hR, int hLL,
+                                                                AVLOptimisticNode* nLR,
+                                                                int hLRL)
+{
+  uint64_t version = n->version.load();
+  uint64_t left_version = nL->version.load();
+  AVLOptimisticNode* parent_left = parent->lchild.load();
+  AVLOptimisticNode* nLRL = nLR->lchild.load();
+  AVLOptimisticNode* nLRR = nLR->rchild.load();
+  int hLRR = avl_optimistic_height(nLRR);
+  int hNRepl = 0;
+  int hLRepl = 0;
+
+  n->version = avl_optimistic_begin_change(version);
+  nL->version = avl_optimistic_begin_change(left_version);
+
+  n->lchild = nLRR;
+  if (nLRR) nLRR->parent = n;
+
+  nL->rchild = nLRL;
+  if (nLRL) nLRL->parent = nL;
+
+  nLR->lchild = nL;
+  nL->parent = nLR;
+  nLR->rchild = n;
+  n->parent = nLR;
+
+  if (parent_left == n) parent->lchild = nLR;
+  else parent->rchild = nLR;
+  nLR->parent = parent;
+
+  hNRepl = 1 + std::max(hLRR, hR);
+  n->height = hNRepl;
+  hLRepl = 1 + std::max(hLL, hLRL);
+  nL->height = hLRepl;
+  nLR->height = 1 + std::max(hLRepl, hNRepl);
+
+  n->version = avl_optimistic_end_change(version);
+  nL->version = avl_optimistic_end_change(left_version);
+
+  if (std::abs(hLRR - hR) > 1) return n;
+  if ((nLRR == NULL || hR == 0) && n->name.load() == NULL) return n;
+  if (std::abs(hLRepl - hNRepl) > 1) return nLR;
+
+  return avl_optimistic_fix_height(parent);
+}
+
+// Mirror of avl_optimistic_rotate_right_over_left (RL case)
+static AVLOptimisticNode* avl_optimistic_rotate_left_over_right(AVLOptimisticNode* parent,
+                                                                AVLOptimisticNode* n, int hL,
+                                                                AVLOptimisticNode* nR,
+                                                                AVLOptimisticNode* nRL,
+                                                                int hRR, int hRLR)
+{
+  uint64_t version = n->version.load();
+  uint64_t right_version = nR->version.load();
+  AVLOptimisticNode* parent_left = parent->lchild.load();
+  AVLOptimisticNode* nRLL = nRL->lchild.load();
+  AVLOptimisticNode* nRLR = nRL->rchild.load();
+  int hRLL = avl_optimistic_height(nRLL);
+  int hNRepl = 0;
+  int hRRepl = 0;
+
+  n->version = avl_optimistic_begin_change(version);
+  nR->version = avl_optimistic_begin_change(right_version);
+
+  n->rchild = nRLL;
+  if (nRLL) nRLL->parent = n;
+
+  nR->lchild = nRLR;
+  if (nRLR) nRLR->parent = nR;
+
+  nRL->rchild = nR;
+  nR->parent = nRL;
+  nRL->lchild = n;
+  n->parent = nRL;
+
+  if (parent_left == n) parent->lchild = nRL;
+  else parent->rchild = nRL;
+  nRL->parent = parent;
+
+  hNRepl = 1 + std::max(hL, hRLL);
+  n->height = hNRepl;
+  hRRepl = 1 + std::max(hRLR, hRR);
+  nR->height = hRRepl;
+  nRL->height = 1 + std::max(hNRepl, hRRepl);
+
+  n->version = avl_optimistic_end_change(version);
+  nR->version = avl_optimistic_end_change(right_version);
+
+  if (std::abs(hRLL - hL) > 1) return n;
+  if ((nRLL == NULL || hL == 0) && n->name.load() == NULL) return n;
+  if (std::abs(hRRepl - hNRepl) > 1) return nRL;
+
+  return avl_optimistic_fix_height(parent);
+}
+
+static AVLOptimisticNode* avl_optimistic_rebalance_to_left(AVLOptimisticNode* parent,
+                                                           AVLOptimisticNode* n,
+                                                           AVLOptimisticNode* nR, int hL0);
+
+/* Rebalances a locked node whose left subtree is too high, choosing
+ * between the LL and LR rotations from the heights seen under the locks.
+ * Returns the node itself when the heights changed meanwhile (retry).
+ */
+static AVLOptimisticNode* avl_optimistic_rebalance_to_right(AVLOptimisticNode* parent,
+                                                            AVLOptimisticNode* n,
+                                                            AVLOptimisticNode* nL, int hR0)
+{
+  AVLOptimisticNode* nLR = NULL;
+  int hLL0 = 0;
+  int hLR0 = 0;
+  int hLRL = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(nL->lock);
+
+    if (nL->height.load() - hR0 <= 1) return n;
+
+    nLR = nL->rchild.load();
+    hLL0 = avl_optimistic_height(nL->lchild.load());
+    hLR0 = avl_optimistic_height(nLR);
+    if (hLL0 >= hLR0) return avl_optimistic_rotate_right(parent, n, nL, hR0, hLL0, nLR, hLR0);
+
+    {
+      std::lock_guard<std::mutex> lock_lr(nLR->lock);
+
+      hLR0 = nLR->height.load();
+      if (hLL0 >= hLR0) return avl_optimistic_rotate_right(parent, n, nL, hR0, hLL0, nLR, hLR0);
+
+      hLRL = avl_optimistic_height(nLR->lchild.load());
+      if (std::abs(hLL0 - hLRL) <= 1 &&
+          !((hLL0 == 0 || hLRL == 0) && nL->name.load() == NULL)) {
+        return avl_optimistic_rotate_right_over_left(parent, n, nL, hR0, hLL0, nLR, hLRL);
+      }
+    }
+
+    // The double rotation would leave nL unbalanced, rebalance nL first
+    return avl_optimistic_rebalance_to_left(n, nL, nLR, hLL0);
+  }
+}
+
+// Mirror of avl_optimistic_rebalance_to_right (RR and RL rotations)
+static AVLOptimisticNode* avl_optimistic_rebalance_to_left(AVLOptimisticNode* parent,
+                                                           AVLOptimisticNode* n,
+                                                           AVLOptimisticNode* nR, int hL0)
+{
+  AVLOptimisticNode* nRL = NULL;
+  int hRR0 = 0;
+  int hRL0 = 0;
+  int hRLR = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(nR->lock);
+
+    if (hL0 - nR->height.load() >= -1) return n;
+
+    nRL = nR->lchild.load();
+    hRL0 = avl_optimistic_height(nRL);
+    hRR0 = avl_optimistic_height(nR->rchild.load());
+    if (hRR0 >= hRL0) return avl_optimistic_rotate_left(parent, n, hL0, nR, nRL, hRL0, hRR0);
+
+    {
+      std::lock_guard<std::mutex> lock_rl(nRL->lock);
+
+      hRL0 = nRL->height.load();
+      if (hRR0 >= hRL0) return avl_optimistic_rotate_left(parent, n, hL0, nR, nRL, hRL0, hRR0);
+
+      hRLR = avl_optimistic_height(nRL->rchild.load());
+      if (std::abs(hRR0 - hRLR) <= 1 &&
+          !((hRR0 == 0 || hRLR == 0) && nR->name.load() == NULL)) {
+        return avl_optimistic_rotate_left_over_right(parent, n, hL0, nR, nRL, hRR0, hRLR);
+      }
+    }
+
+    return avl_optimistic_rebalance_to_right(n, nR, nRL, hRR0);
+  }
+}
+
+/* Repairs a locked node under its locked parent: unlinks it if it is a
+ * routing node with a missing child, rotates it if unbalanced or fixes its
+ * height. Returns the next node to repair.
+ */
+static AVLOptimisticNode* avl_optimistic_rebalance(AVLOptimisticTree* tree,
+                                                   AVLOptimisticNode* parent,
+                                                   AVLOptimisticNode* n)
+{
+  AVLOptimisticNode* nL = n->lchild.load();
+  AVLOptimisticNode* nR = n->rchild.load();
+  int hL0 = 0;
+  int hR0 = 0;
+  int hNRepl = 0;
+
+  if ((nL == NULL || nR == NULL) && n->name.load() == NULL) {
+    if (!avl_optimistic_unlink(parent, n)) return n;
+
+    avl_optimistic_retire(tree, n, NULL);
+    return avl_optimistic_fix_height(parent);
+  }
+
+  hL0 = avl_optimistic_height(nL);
+  hR0 = avl_optimistic_height(nR);
+  hNRepl = 1 + std::max(hL0, hR0);
+
+  if (hL0 - hR0 > 1) return avl_optimistic_rebalance_to_right(parent, n, nL, hR0);
+  if (hL0 - hR0 < -1) return avl_optimistic_rebalance_to_left(parent, n, nR, hL0);
+
+  if (hNRepl != n->height.load()) {
+    n->height = hNRepl;
+    return avl_optimistic_fix_height(parent);
+  }
+
+  return NULL;
+}
+
+// Walks up from a damaged node, repairing heights and balance
+static void avl_optimistic_fix_height_and_rebalance(AVLOptimisticTree* tree,
+                                                    AVLOptimisticNode* node)
+{
+  AVLOptimisticNode* parent = NULL;
+  int condition = 0;
+
+  // The root holder has no parent and is never repaired
+  while (node != NULL && node->parent.load() != NULL) {
+    condition = avl_optimistic_condition(node);
+    if (condition == AVL_OPTIMISTIC_NOTHING_REQUIRED || avl_optimistic_unlinked(node)) return;
+
+    if (condition != AVL_OPTIMISTIC_UNLINK_REQUIRED &&
+        condition != AVL_OPTIMISTIC_REBALANCE_REQUIRED) {
+      std::lock_guard<std::mutex> lock(node->lock);
+      node = avl_optimistic_fix_height(node);
+    } else {
+      parent = node->parent.load();
+      std::lock_guard<std::mutex> parent_lock(parent->lock);
+
+      // Otherwise the node moved meanwhile, check it again
+      if (!avl_optimistic_unlinked(parent) && node->parent.load() == parent) {
+        std::lock_guard<std::mutex> lock(node->lock);
+        node = avl_optimistic_rebalance(tree, parent, node);
+      }
+    }
+  }
+}
+
+/* Searches the subtree of a child of node, whose version was validated as
+ * version. Stores the name of the key (NULL if missing) and returns
+ * RET_OK, or AVL_OPTIMISTIC_RETRY if a rotation moved keys out of node.
+ */
+static int avl_optimistic_get(AVLOptimisticNode* node, int dir, uint64_t version,
+                              uint32_t id, const std::string** name)
+{
+  AVLOptimisticNode* child = NULL;
+  uint64_t child_version = 0;
+  int ret = 0;
+
+  while (true) {
+    child = avl_optimistic_child(node, dir).load();
+
+    if (child == NULL) {
+      if (node->version.load() != version) return AVL_OPTIMISTIC_RETRY;
+      *name = NULL;
+      return RET_OK;
+    }
+
+    if (id == child->id) {
+      *name = child->name.load();
+      return RET_OK;
+    }
+
+    child_version = child->version.load();
+    if (child_version & (AVL_OPTIMISTIC_UNLINKED | AVL_OPTIMISTIC_SHRINKING)) {
+      avl_optimistic_wait(child, child_version);
+      if (node->version.load() != version) return AVL_OPTIMISTIC_RETRY;
+    } else if (child != avl_optimistic_child(node, dir).load()) {
+      if (node->version.load() != version) return AVL_OPTIMISTIC_RETRY;
+    } else {
+      // Hand-over-hand: the child is valid, so node no longer needs to be
+      if (node->version.load() != version) return AVL_OPTIMISTIC_RETRY;
+
+      ret = avl_optimistic_get(child, (id < child->id) ? -1 : 1, child_version, id, name);
+      if (ret != AVL_OPTIMISTIC_RETRY) return ret;
+    }
+  }
+}
+
+/* Inserts (name not NULL) or removes (name NULL) the key of a node found
+ * under parent.
+ */
+static int avl_optimistic_update_node(AVLOptimisticTree* tree, const std::string* name,
+                                      AVLOptimisticNode* parent, AVLOptimisticNode* node)
+{
+  const std::string* prev = NULL;
+  AVLOptimisticNode* damaged = NULL;
+
+  if (name == NULL && node->name.load() == NULL) return KEY_NOT_FOUND;
+
+  // Removing a node with a missing child unlinks it
+  if (name == NULL && (node->lchild.load() == NULL || node->rchild.load() == NULL)) {
+    {
+      std::lock_guard<std::mutex> parent_lock(parent->lock);
+      if (avl_optimistic_unlinked(parent) || node->parent.load() != parent) {
+        return AVL_OPTIMISTIC_RETRY;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(node->lock);
+        prev = node->name.load();
+        if (prev == NULL) return KEY_NOT_FOUND;
+        if (!avl_optimistic_unlink(parent, node)) return AVL_OPTIMISTIC_RETRY;
+      }
+
+      tree->size--;
+      damaged = avl_optimistic_fix_height(parent);
+    }
+
+    avl_optimistic_retire(tree, node, prev);
+    avl_optimistic_fix_height_and_rebalance(tree, damaged);
+    return RET_OK;
+  }
+
+  std::lock_guard<std::mutex> lock(node->lock);
+  if (avl_optimistic_unlinked(node)) return AVL_OPTIMISTIC_RETRY;
+
+  prev = node->name.load();
+
+  if (name == NULL) {
+    if (prev == NULL) return KEY_NOT_FOUND;
+    // A child was removed meanwhile, the node must be unlinked instead
+    if (node->lchild.load() == NULL || node->rchild.load() == NULL) return AVL_OPTIMISTIC_RETRY;
+
+    // Keep the node as a routing node, the nodes below still go through it
+    node->name = NULL;
+    tree->size--;
+    avl_optimistic_retire(tree, NULL, prev);
+    return RET_OK;
+  }
+
+  if (prev != NULL) return KEY_EXISTS;
+
+  // Revive a routing node
+  node->name = new std::string(*name);
+  tree->size++;
+  return RET_OK;
+}
+
+/* Inserts (name not NULL) or removes (name NULL) a key in the subtree of
+ * node, whose version was validated as version. A NULL parent means node
+ * is the root holder. Returns AVL_OPTIMISTIC_RETRY if a rotation moved
+ * keys out of node.
+ */
+static int avl_optimistic_update(AVLOptimisticTree* tree, uint32_t id, const std::string* name,
+                                 AVLOptimisticNode* parent, AVLOptimisticNode* node,
+                                 uint64_t version)
+{
+  AVLOptimisticNode* child = NULL;
+  AVLOptimisticNode* damaged = NULL;
+  uint64_t child_version = 0;
+  int dir = 1;
+  int ret = 0;
+
+  if (parent != NULL) {
+    if (id == node->id) return avl_optimistic_update_node(tree, name, parent, node);
+    dir = (id < node->id) ? -1 : 1;
+  }
+
+  while (true) {
+    child = avl_optimistic_child(node, dir).load();
+    if (node->version.load() != version) return AVL_OPTIMISTIC_RETRY;
+
+    if (child == NULL) {
+      if (name == NULL) return KEY_NOT_FOUND;
+
+      {
+        std::lock_guard<std::mutex> lock(node->lock);
+        if (node->version.load() != version) return AVL_OPTIMISTIC_RETRY;
+        // A node was linked here meanwhile, go down to it
+        if (avl_optimistic_child(node, dir).load() != NULL) continue;
+
+        child = new AVLOptimisticNode;
+        child->id = id;
+        child->parent = node;
+        child->name = new std::string(*name);
+        avl_optimistic_child(node, dir) = child;
+
+        tree->size++;
+        damaged = avl_optimistic_fix_height(node);
+      }
+
+      avl_optimistic_fix_height_and_rebalance(tree, damaged);
+      return RET_OK;
+    }
+
+    child_version = child->version.load();
+    if (child_version & (AVL_OPTIMISTIC_UNLINKED | AVL_OPTIMISTIC_SHRINKING)) {
+      avl_optimistic_wait(child, child_version);
+    } else if (child == avl_optimistic_child(node, dir).load()) {
+      if (node->version.load() != version) return AVL_OPTIMISTIC_RETRY;
+
+      ret = avl_optimistic_update(tree, id, name, node, child, child_version);
+      if (ret != AVL_OPTIMISTIC_RETRY) return ret;
+    }
+  }
+}
+
+int avl_optimistic_tree_create(AVLOptimisticTree** tree)
+{
+  if (*tree != NULL) {
+    std::cerr << "Invalid tree: Given optimistic tree pointer is not NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  *tree = new AVLOptimisticTree;
+
+  return RET_OK;
+}
+
+int avl_optimistic_tree_destroy(AVLOptimisticTree** tree)
+{
+  std::vector<AVLOptimisticNode*> pending;
+  AVLOptimisticNode* node = NULL;
+
+  if (*tree == NULL) {
+    std::cerr << "Invalid tree: Given optimistic tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  node = (*tree)->root_holder.rchild.load();
+  if (node != NULL) pending.push_back(node);
+
+  while (!pending.empty()) {
+    node = pending.back();
+    pending.pop_back();
+
+    if (node->lchild.load()) pending.push_back(node->lchild.load());
+    if (node->rchild.load()) pending.push_back(node->rchild.load());
+    delete node->name.load();
+    delete node;
+  }
+
+  for (AVLOptimisticRetired& entry : (*tree)->retired) {
+    delete entry.node;
+    delete entry.name;
+  }
+
+  delete *tree;
+  *tree = NULL;
+
+  return RET_OK;
+}
+
+int avl_optimistic_tree_insert(AVLOptimisticTree* tree, uint32_t id,
+                               std::string name)
+{
+  AVLEpochSlot* slot = NULL;
+  int ret = 0;
+
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given optimistic tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if ((id < MIN_ID) || (id > MAX_ID)) {
+    std::cerr << "Invalid key (" << id << "): Value out of range" << std::endl;
+    return INVALID_KEY;
+  }
+
+  slot = avl_epoch_enter(&tree->epochs);
+  do {
+    ret = avl_optimistic_update(tree, id, &name, NULL, &tree->root_holder, 0);
+  } while (ret == AVL_OPTIMISTIC_RETRY);
+  avl_epoch_exit(slot);
+
+  if (ret == KEY_EXISTS) {
+    std::cerr << "Invalid insertion: Key already exists" << std::endl;
+  }
+
+  return ret;
+}
+
+int avl_optimistic_tree_remove(AVLOptimisticTree* tree, uint32_t id)
+{
+  AVLEpochSlot* slot = NULL;
+  int ret = 0;
+
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given optimistic tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  slot = avl_epoch_enter(&tree->epochs);
+  do {
+    ret = avl_optimistic_update(tree, id, NULL, NULL, &tree->root_holder, 0);
+  } while (ret == AVL_OPTIMISTIC_RETRY);
+  avl_epoch_exit(slot);
+
+  if (ret == KEY_NOT_FOUND) {
+    std::cerr << "Invalid deletion: Key not found" << std::endl;
+  }
+
+  return ret;
+}
+
+int avl_optimistic_tree_search(AVLOptimisticTree* tree, uint32_t id,
+                               std::string* name, bool* found)
+{
+  AVLEpochSlot* slot = NULL;
+  const std::string* value = NULL;
+
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given optimistic tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  slot = avl_epoch_enter(&tree->epochs);
+  while (avl_optimistic_get(&tree->root_holder, 1, 0, id, &value) == AVL_OPTIMISTIC_RETRY) {}
+
+  *found = (value != NULL);
+  if (value && name) *name = *value;
+  avl_epoch_exit(slot);
+
+  return RET_OK;
+}
+
+int avl_optimistic_tree_get_size(AVLOptimisticTree* tree, int* size)
+{
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given optimistic tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  *size = tree->size.load();
+
+  return RET_OK;
+}
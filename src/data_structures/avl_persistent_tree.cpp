@@ -0,0 +1,316 @@
+#include "include/data_structures/avl_persistent_tree.hpp"
+#include <algorithm>
+
+static inline int avl_persistent_height(AVLPersistentNode* node)
+{
+  return node ? node->height : 0;
+}
+
+static inline int avl_persistent_size(AVLPersistentNode* node)
+{
+  return node ? node->size : 0;
+}
+
+static inline void avl_persistent_update(AVLPersistentNode* node)
+{
+  node->height = 1 + std::max(avl_persistent_height(node->lchild),
+                              avl_persistent_height(node->rchild));
+  node->size = 1 + avl_persistent_size(node->lchild) + avl_persistent_size(node->rchild);
+}
+
+static inline AVLPersistentNode* avl_persistent_retain(AVLPersistentNode* node)
+{
+  if (node) node->refs.fetch_add(1, std::memory_order_relaxed);
+  return node;
+}
+
+// Drops a reference, freeing the node and releasing its children on the last one
+static void avl_persistent_release(AVLPersistentNode* node)
+{
+  if (node == NULL || node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+  avl_persistent_release(node->lchild);
+  avl_persistent_release(node->rchild);
+  delete node;
+}
+
+/* Turns a reference to a node into a node only the caller references,
+ * which it may modify. Nodes referenced elsewhere are copied, the copy
+ * sharing their children.
+ */
+static AVLPersistentNode* avl_persistent_own(AVLPersistentNode* node)
+{
+  AVLPersistentNode* copy = NULL;
+
+  if (node->refs.load(std::memory_order_acquire) == 1) return node;
+
+  copy = new AVLPersistentNode;
+  copy->lchild = avl_persistent_retain(node->lchild);
+  copy->rchild = avl_persistent_retain(node->rchild);
+  copy->id = node->id;
+  copy->height = node->height;
+  copy->size = node->size;
+  copy->name = node->name;
+  avl_persistent_release(node);
+
+  return copy;
+}
+
+// RR rotation of an owned node: z is right heavy, its right child moves up
+static AVLPersistentNode* avl_persistent_rotate_rr(AVLPersistentNode* z)
+{
+  AVLPersistentNode* y = avl_persistent_own(z->rchild);
+
+  z->rchild = y->lchild;
+  y->lchild = z;
+  avl_persistent_update(z);
+  avl_persistent_update(y);
+
+  return y;
+}
+
+// LL rotation of an owned node: z is left heavy, its left child moves up
+static AVLPersistentNode* avl_persistent_rotate_ll(AVLPersistentNode* z)
+{
+  AVLPersistentNode* y = avl_persistent_own(z->lchild);
+
+  z->lchild = y->rchild;
+  y->rchild = z;
+  avl_persistent_update(z);
+  avl_persistent_update(y);
+
+  return y;
+}
+
+// Updates an owned node and rebalances it (RR, LL, RL or LR rotations)
+static AVLPersistentNode* avl_persistent_rebalance(AVLPersistentNode* z)
+{
+  int balance_factor = avl_persistent_height(z->rchild) - avl_persistent_height(z->lchild);
+
+  if (balance_factor > 1) {
+    if (avl_persistent_height(z->rchild->lchild) > avl_persistent_height(z->rchild->rchild)) {
+      z->rchild = avl_persistent_rotate_ll(avl_persistent_own(z->rchild));
+    }
+    return avl_persistent_rotate_rr(z);
+  }
+
+  if (balance_factor < -1) {
+    if (avl_persistent_height(z->lchild->rchild) > avl_persistent_height(z->lchild->lchild)) {
+      z->lchild = avl_persistent_rotate_rr(avl_persistent_own(z->lchild));
+    }
+    return avl_persistent_rotate_ll(z);
+  }
+
+  avl_persistent_update(z);
+  return z;
+}
+
+// Inserts a key known to be missing, taking over the reference to node
+static AVLPersistentNode* avl_persistent_insert_at(AVLPersistentNode* node, uint32_t id,
+                                                   std::string* name)
+{
+  if (node == NULL) {
+    node = new AVLPersistentNode;
+    node->id = id;
+    node->name = std::move(*name);
+    return node;
+  }
+
+  node = avl_persistent_own(node);
+  if (id < node->id) {
+    node->lchild = avl_persistent_insert_at(node->lchild, id, name);
+  } else {
+    node->rchild = avl_persistent_insert_at(node->rchild, id, name);
+  }
+
+  return avl_persistent_rebalance(node);
+}
+
+// Removes a key known to be present, taking over the reference to node
+static AVLPersistentNode* avl_persistent_remove_at(AVLPersistentNode* node, uint32_t id)
+{
+  AVLPersistentNode* child = NULL;
+  AVLPersistentNode* successor = NULL;
+
+  node = avl_persistent_own(node);
+
+  if (id < node->id) {
+    node->lchild = avl_persistent_remove_at(node->lchild, id);
+  } else if (id > node->id) {
+    node->rchild = avl_persistent_remove_at(node->rchild, id);
+  } else if (node->lchild == NULL || node->rchild == NULL) {
+    // The only child takes the node place
+    child = node->lchild ? node->lchild : node->rchild;
+    node->lchild = NULL;
+    node->rchild = NULL;
+    avl_persistent_release(node);
+    return child;
+  } else {
+    // Two children, the successor key takes the node place
+    successor = node->rchild;
+    while (successor->lchild) successor = successor->lchild;
+
+    node->id = successor->id;
+    node->name = successor->name;
+    node->rchild = avl_persistent_remove_at(node->rchild, node->id);
+  }
+
+  return avl_persistent_rebalance(node);
+}
+
+int avl_persistent_version_insert(AVLPersistentNode* version, uint32_t id,
+                                  std::string name,
+                                  AVLPersistentNode** new_version)
+{
+  AVLPersistentNode* node = NULL;
+  bool found = false;
+
+  if ((id < MIN_ID) || (id > MAX_ID)) {
+    std::cerr << "Invalid key (" << id << "): Value out of range" << std::endl;
+    return INVALID_KEY;
+  }
+
+  avl_persistent_version_search(version, id, &node, &found);
+  if (found) {
+    std::cerr << "Invalid insertion: Key already exists" << std::endl;
+    return KEY_EXISTS;
+  }
+
+  // The given version keeps its reference, the new one takes another
+  *new_version = avl_persistent_insert_at(avl_persistent_retain(version), id, &name);
+
+  return RET_OK;
+}
+
+int avl_persistent_version_remove(AVLPersistentNode* version, uint32_t id,
+                                  AVLPersistentNode** new_version)
+{
+  AVLPersistentNode* node = NULL;
+  bool found = false;
+
+  avl_persistent_version_search(version, id, &node, &found);
+  if (!found) {
+    std::cerr << "Invalid deletion: Key not found" << std::endl;
+    return KEY_NOT_FOUND;
+  }
+
+  *new_version = avl_persistent_remove_at(avl_persistent_retain(version), id);
+
+  return RET_OK;
+}
+
+int avl_persistent_version_search(AVLPersistentNode* version, uint32_t id,
+                                  AVLPersistentNode** node, bool* found)
+{
+  *node = version;
+  while (*node != NULL && (*node)->id != id) {
+    *node = (id < (*node)->id) ? (*node)->lchild : (*node)->rchild;
+  }
+
+  *found = (*node != NULL);
+
+  return RET_OK;
+}
+
+int avl_persistent_version_get_size(AVLPersistentNode* version, int* size)
+{
+  *size = avl_persistent_size(version);
+
+  return RET_OK;
+}
+
+int avl_persistent_version_release(AVLPersistentNode** version)
+{
+  avl_persistent_release(*version);
+  *version = NULL;
+
+  return RET_OK;
+}
+
+int avl_persistent_tree_create(AVLPersistentTree** tree)
+{
+  if (*tree != NULL) {
+    std::cerr << "Invalid tree: Given persistent tree pointer is not NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  *tree = new AVLPersistentTree;
+
+  return RET_OK;
+}
+
+int avl_persistent_tree_destroy(AVLPersistentTree** tree)
+{
+  if (*tree == NULL) {
+    std::cerr << "Invalid tree: Given persistent tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  avl_persistent_version_release(&(*tree)->root);
+  delete *tree;
+  *tree = NULL;
+
+  return RET_OK;
+}
+
+int avl_persistent_tree_insert(AVLPersistentTree* tree, uint32_t id,
+                               std::string name)
+{
+  AVLPersistentNode* previous = NULL;
+  int ret = RET_OK;
+
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given persistent tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(tree->lock);
+
+    previous = tree->root;
+    ret = avl_persistent_version_insert(previous, id, name, &tree->root);
+    if (ret) return ret;
+  }
+
+  // Frees the replaced path, unless a snapshot still holds it
+  avl_persistent_version_release(&previous);
+
+  return RET_OK;
+}
+
+int avl_persistent_tree_remove(AVLPersistentTree* tree, uint32_t id)
+{
+  AVLPersistentNode* previous = NULL;
+  int ret = RET_OK;
+
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given persistent tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(tree->lock);
+
+    previous = tree->root;
+    ret = avl_persistent_version_remove(previous, id, &tree->root);
+    if (ret) return ret;
+  }
+
+  avl_persistent_version_release(&previous);
+
+  return RET_OK;
+}
+
+int avl_persistent_tree_snapshot(AVLPersistentTree* tree,
+                                 AVLPersistentNode** version)
+{
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given persistent tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  std::lock_guard<std::mutex> lock(tree->lock);
+  *version = avl_persistent_retain(tree->root);
+
+  return RET_OK;
+}
@@ -0,0 +1,279 @@
+#include "include/data_structures/avl_sharded_tree.hpp"
+#include <algorithm>
+
+//! User callback of a range scan across shards
+struct AVLShardedScan {
+  avl_tree_scan_fn callback;
+  void* arg;
+  bool stopped;
+};
+
+static bool avl_sharded_tree_scan_node(AVLNode* node, void* arg)
+{
+  AVLShardedScan* scan = static_cast<AVLShardedScan*>(arg);
+
+  if (!scan->callback(node, scan->arg)) scan->stopped = true;
+
+  return !scan->stopped;
+}
+
+// Highest key of a shard, set by the lowest key of the next one
+static inline uint32_t avl_sharded_tree_shard_hi(AVLShardedTree* tree, size_t i)
+{
+  return (i + 1 < tree->shards.size()) ? tree->shards[i + 1].lo.load() - 1 : UINT32_MAX;
+}
+
+/* Locks the shard holding a key and returns its index. The shard is found
+ * from the boundaries without locking, then checked again under its lock,
+ * since a rebalance may have moved them meanwhile. IDs below MIN_ID go to
+ * the first shard.
+ */
+static size_t avl_sharded_tree_lock(AVLShardedTree* tree, uint32_t id,
+                                    std::unique_lock<std::mutex>* lock)
+{
+  size_t lo = 0;
+  size_t hi = 0;
+  size_t mid = 0;
+
+  while (true) {
+    // Last shard with its lowest key not above the ID
+    lo = 0;
+    hi = tree->shards.size() - 1;
+    while (lo < hi) {
+      mid = lo + (hi - lo + 1) / 2;
+      if (tree->shards[mid].lo.load(std::memory_order_relaxed) <= id) lo = mid;
+      else hi = mid - 1;
+    }
+
+    std::unique_lock<std::mutex> guard(tree->shards[lo].lock);
+    if ((lo == 0 || tree->shards[lo].lo.load() <= id) &&
+        id <= avl_sharded_tree_shard_hi(tree, lo)) {
+      *lock = std::move(guard);
+      return lo;
+    }
+  }
+}
+
+int avl_sharded_tree_create(AVLShardedTree** tree, size_t num_shards)
+{
+  uint64_t width = 0;
+
+  if (*tree != NULL) {
+    std::cerr << "Invalid tree: Given sharded tree pointer is not NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if (num_shards == 0 || num_shards > (uint64_t) MAX_ID - MIN_ID + 1) {
+    std::cerr << "Invalid index (" << num_shards << "): Number of shards out of range" << std::endl;
+    return INVALID_INDEX;
+  }
+
+  *tree = new AVLShardedTree(num_shards);
+
+  width = ((uint64_t) MAX_ID - MIN_ID + 1) / num_shards;
+  for (size_t i = 0; i < num_shards; i++) {
+    (*tree)->shards[i].lo = MIN_ID + i * width;
+    avl_node_pool_create(&(*tree)->shards[i].pool);
+  }
+
+  return RET_OK;
+}
+
+int avl_sharded_tree_destroy(AVLShardedTree** tree)
+{
+  if (*tree == NULL) {
+    std::cerr << "Invalid tree: Given sharded tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  // The pools release the nodes of their shards
+  for (AVLShard& shard : (*tree)->shards) avl_node_pool_destroy(&shard.pool);
+
+  delete *tree;
+  *tree = NULL;
+
+  return RET_OK;
+}
+
+int avl_sharded_tree_insert(AVLShardedTree* tree, uint32_t id,
+                            std::string name)
+{
+  std::unique_lock<std::mutex> lock;
+  AVLShard* shard = NULL;
+
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given sharded tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if ((id < MIN_ID) || (id > MAX_ID)) {
+    std::cerr << "Invalid key (" << id << "): Value out of range" << std::endl;
+    return INVALID_KEY;
+  }
+
+  shard = &tree->shards[avl_sharded_tree_lock(tree, id, &lock)];
+
+  return avl_tree_insert(&shard->root, id, name, shard->pool);
+}
+
+int avl_sharded_tree_remove(AVLShardedTree* tree, uint32_t id)
+{
+  std::unique_lock<std::mutex> lock;
+  AVLShard* shard = NULL;
+
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given sharded tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  shard = &tree->shards[avl_sharded_tree_lock(tree, id, &lock)];
+
+  if (shard->root == NULL) {
+    std::cerr << "Invalid deletion: Key not found" << std::endl;
+    return KEY_NOT_FOUND;
+  }
+
+  return avl_tree_remove(&shard->root, id, shard->pool);
+}
+
+int avl_sharded_tree_search(AVLShardedTree* tree, uint32_t id,
+                            std::string* name, bool* found)
+{
+  std::unique_lock<std::mutex> lock;
+  AVLShard* shard = NULL;
+  AVLNode* node = NULL;
+
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given sharded tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  *found = false;
+  shard = &tree->shards[avl_sharded_tree_lock(tree, id, &lock)];
+  if (shard->root == NULL) return RET_OK;
+
+  avl_tree_search(shard->root, id, &node, found);
+  if (*found && name) *name = node->name;
+
+  return RET_OK;
+}
+
+int avl_sharded_tree_range_scan(AVLShardedTree* tree, uint32_t lo, uint32_t hi,
+                                avl_tree_scan_fn callback, void* arg)
+{
+  AVLShardedScan scan = {callback, arg, false};
+  uint32_t current = lo;
+  uint32_t shard_hi = 0;
+  size_t i = 0;
+
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given sharded tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  // Each step locks the shard of the next key to visit, so keys moved by a
+  // rebalance between two steps are neither skipped nor visited twice
+  while (current <= hi) {
+    std::unique_lock<std::mutex> lock;
+    i = avl_sharded_tree_lock(tree, current, &lock);
+    shard_hi = avl_sharded_tree_shard_hi(tree, i);
+
+    if (tree->shards[i].root != NULL) {
+      avl_tree_range_scan(tree->shards[i].root, current, std::min(hi, shard_hi),
+                          avl_sharded_tree_scan_node, &scan);
+    }
+
+    if (scan.stopped || shard_hi >= hi) break;
+    current = shard_hi + 1;
+  }
+
+  return RET_OK;
+}
+
+int avl_sharded_tree_get_size(AVLShardedTree* tree, int* size)
+{
+  std::vector<std::unique_lock<std::mutex>> locks;
+
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given sharded tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  // Shards are always locked in key order
+  *size = 0;
+  for (AVLShard& shard : tree->shards) {
+    locks.emplace_back(shard.lock);
+    if (shard.root) *size += shard.root->size;
+  }
+
+  return RET_OK;
+}
+
+int avl_sharded_tree_rebalance(AVLShardedTree* tree)
+{
+  std::vector<std::unique_lock<std::mutex>> locks;
+  std::vector<uint32_t> bounds;
+  std::vector<AVLNode*> nodes;
+  std::vector<db_entry> entries;
+  std::vector<db_entry> slice;
+  AVLNode* node = NULL;
+  size_t num_shards = 0;
+  size_t total = 0;
+  size_t offset = 0;
+  size_t rank = 0;
+  size_t s = 0;
+  int ret = RET_OK;
+
+  if (tree == NULL) {
+    std::cerr << "Invalid tree: Given sharded tree pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  num_shards = tree->shards.size();
+  for (AVLShard& shard : tree->shards) {
+    locks.emplace_back(shard.lock);
+    if (shard.root) total += shard.root->size;
+  }
+
+  if (total < num_shards) return RET_OK;
+
+  // The key of global rank i * total / num_shards starts shard i, found
+  // with the order statistics of the shard holding it
+  bounds.push_back(MIN_ID);
+  for (size_t i = 1; i < num_shards; i++) {
+    rank = i * total / num_shards;
+    while (offset + (tree->shards[s].root ? tree->shards[s].root->size : 0) <= rank) {
+      offset += tree->shards[s].root ? tree->shards[s].root->size : 0;
+      s++;
+    }
+    avl_tree_select(tree->shards[s].root, rank - offset, &node);
+    bounds.push_back(node->id);
+  }
+
+  // Collect the entries in key order, moving the names out of the shards
+  entries.reserve(total);
+  for (AVLShard& shard : tree->shards) {
+    if (shard.root == NULL) continue;
+
+    nodes.clear();
+    avl_tree_get_page(shard.root, 0, shard.root->size, &nodes);
+    for (AVLNode* entry : nodes) entries.emplace_back(entry->id, std::move(entry->name));
+    avl_tree_destroy(&shard.root, shard.pool);
+  }
+
+  // Rebuild each shard from its slice of the entries
+  offset = 0;
+  for (size_t i = 0; i < num_shards; i++) {
+    rank = (i + 1 < num_shards) ? (i + 1) * total / num_shards : total;
+
+    slice.assign(std::make_move_iterator(entries.begin() + offset),
+                 std::make_move_iterator(entries.begin() + rank));
+    ret = avl_tree_bulk_load(&slice, &tree->shards[i].root, tree->shards[i].pool);
+    if (ret) return ret;
+
+    tree->shards[i].lo = bounds[i];
+    offset = rank;
+  }
+
+  return RET_OK;
+}
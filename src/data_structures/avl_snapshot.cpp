@@ -0,0 +1,368 @@
+#include "include/data_structures/avl_snapshot.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//! Seed of the section checksum
+#define AVL_SNAPSHOT_SEED 0x9E3779B97F4A7C15
+
+// Bytes of a section once padded to a multiple of 8
+static inline uint64_t avl_snapshot_padded(uint64_t bytes)
+{
+  return (bytes + 7) & ~(uint64_t) 7;
+}
+
+/* Folds 8-byte words into the checksum, a multiply-xorshift mix that keeps
+ * up with sequential reads. The last partial word is zero padded.
+ */
+static uint64_t avl_snapshot_checksum(const char* data, uint64_t bytes, uint64_t hash)
+{
+  uint64_t word = 0;
+
+  for (uint64_t i = 0; i < bytes; i += 8) {
+    word = 0;
+    memcpy(&word, data + i, (bytes - i < 8) ? bytes - i : 8);
+    hash = (hash ^ word) * 0xFF51AFD7ED558CCD;
+    hash ^= hash >> 32;
+  }
+
+  return hash;
+}
+
+// Writes the whole buffer, retrying short and interrupted writes
+static bool avl_snapshot_write_all(int fd, const char* data, uint64_t bytes)
+{
+  ssize_t count = 0;
+
+  while (bytes > 0) {
+    count = write(fd, data, bytes);
+    if (count < 0 && errno == EINTR) continue;
+    if (count <= 0) return false;
+    data += count;
+    bytes -= count;
+  }
+
+  return true;
+}
+
+// Writes a section zero padded to 8 bytes, folding it into the checksum
+static bool avl_snapshot_write(int fd, const void* data, uint64_t bytes,
+                               uint64_t* checksum)
+{
+  const char zeros[8] = {0};
+
+  *checksum = avl_snapshot_checksum(static_cast<const char*>(data), bytes, *checksum);
+  return avl_snapshot_write_all(fd, static_cast<const char*>(data), bytes)
+         && avl_snapshot_write_all(fd, zeros, avl_snapshot_padded(bytes) - bytes);
+}
+
+// Flushes the directory holding path, so that a rename in it is durable
+static bool avl_snapshot_sync_dir(const std::string& path)
+{
+  size_t slash = path.find_last_of('/');
+  std::string dir = (slash == std::string::npos) ? "." : path.substr(0, slash + 1);
+  int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  bool ok = false;
+
+  if (fd < 0) return false;
+  ok = (fsync(fd) == 0);
+  close(fd);
+
+  return ok;
+}
+
+// Places the sorted ranks in Eytzinger order, returns the next sorted rank
+static uint32_t avl_snapshot_fill(std::vector<uint32_t>* ranks, uint32_t rank, size_t k)
+{
+  if (k < ranks->size()) {
+    rank = avl_snapshot_fill(ranks, rank, 2 * k);
+    (*ranks)[k] = rank++;
+    rank = avl_snapshot_fill(ranks, rank, 2 * k + 1);
+  }
+
+  return rank;
+}
+
+int avl_tree_save(AVLNode* root, std::string path, bool layout)
+{
+  AVLSnapshotHeader header;
+  std::vector<AVLNode*> sorted;
+  std::vector<uint32_t> ids;
+  std::vector<uint64_t> name_offsets;
+  std::vector<char> names;
+  std::vector<uint32_t> layout_keys;
+  std::vector<uint32_t> layout_ranks;
+  std::string tmp_path = path + ".XXXXXX";
+  bool ok = true;
+  int fd = -1;
+  int ret = RET_OK;
+
+  if (root == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  ret = avl_tree_get_page(root, 0, root->size, &sorted);
+  if (ret) return ret;
+
+  ids.reserve(sorted.size());
+  name_offsets.reserve(sorted.size() + 1);
+  name_offsets.push_back(0);
+  for (AVLNode* node : sorted) {
+    ids.push_back(node->id);
+    names.insert(names.end(), node->name.begin(), node->name.end());
+    name_offsets.push_back(names.size());
+  }
+
+  if (layout) {
+    layout_ranks.resize(sorted.size() + 1);
+    layout_keys.resize(sorted.size() + 1);
+    avl_snapshot_fill(&layout_ranks, 0, 1);
+    layout_ranks[0] = sorted.size();
+    layout_keys[0] = 0;
+    for (size_t k = 1; k < layout_ranks.size(); k++) layout_keys[k] = ids[layout_ranks[k]];
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, AVL_SNAPSHOT_MAGIC, sizeof(AVL_SNAPSHOT_MAGIC));
+  header.version = AVL_SNAPSHOT_VERSION;
+  header.flags = layout ? AVL_SNAPSHOT_LAYOUT : 0;
+  header.size = sorted.size();
+  header.names_size = names.size();
+  header.checksum = AVL_SNAPSHOT_SEED;
+
+  // A unique temporary file, so concurrent saves to the same path don't
+  // write into each other's file
+  fd = mkstemp(&tmp_path[0]);
+  if (fd < 0) {
+    std::cerr << "Invalid file: Can't write snapshot \"" << tmp_path << "\"" << std::endl;
+    return INVALID_FILE;
+  }
+  fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+  // The header is rewritten once the checksum of the sections is known
+  ok = avl_snapshot_write_all(fd, reinterpret_cast<const char*>(&header), sizeof(header));
+  ok = ok && avl_snapshot_write(fd, ids.data(), ids.size() * sizeof(uint32_t), &header.checksum);
+  ok = ok && avl_snapshot_write(fd, name_offsets.data(), name_offsets.size() * sizeof(uint64_t),
+                                &header.checksum);
+  ok = ok && avl_snapshot_write(fd, names.data(), names.size(), &header.checksum);
+  if (layout) {
+    ok = ok && avl_snapshot_write(fd, layout_keys.data(), layout_keys.size() * sizeof(uint32_t),
+                                  &header.checksum);
+    ok = ok && avl_snapshot_write(fd, layout_ranks.data(), layout_ranks.size() * sizeof(uint32_t),
+                                  &header.checksum);
+  }
+  ok = ok && pwrite(fd, &header, sizeof(header), 0) == (ssize_t) sizeof(header);
+
+  // The data must be durable before the rename publishes it, and the
+  // rename before the previous snapshot is considered replaced
+  ok = ok && (fsync(fd) == 0);
+  ok = (close(fd) == 0) && ok;
+  ok = ok && (rename(tmp_path.c_str(), path.c_str()) == 0);
+
+  if (!ok) {
+    std::cerr << "Invalid file: Can't write snapshot \"" << path << "\"" << std::endl;
+    std::remove(tmp_path.c_str());
+    return INVALID_FILE;
+  }
+
+  if (!avl_snapshot_sync_dir(path)) {
+    std::cerr << "Invalid file: Can't sync the directory of snapshot \"" << path << "\"" << std::endl;
+    return INVALID_FILE;
+  }
+
+  return RET_OK;
+}
+
+int avl_tree_open_snapshot(std::string path, AVLSnapshot** snapshot, bool verify)
+{
+  AVLSnapshotHeader header;
+  struct stat st;
+  void* data = NULL;
+  uint64_t expected_size = 0;
+  uint64_t offset = sizeof(AVLSnapshotHeader);
+  int fd = -1;
+
+  if (*snapshot != NULL) {
+    std::cerr << "Invalid snapshot: Given snapshot pointer is not NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) || (size_t) st.st_size < sizeof(header)) {
+    std::cerr << "Invalid file: Can't open snapshot \"" << path << "\"" << std::endl;
+    if (fd >= 0) close(fd);
+    return INVALID_FILE;
+  }
+
+  data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    std::cerr << "Invalid file: Can't map snapshot \"" << path << "\"" << std::endl;
+    return INVALID_FILE;
+  }
+
+  memcpy(&header, data, sizeof(header));
+
+  // Size of the file the header describes, before trusting any offset
+  if (header.size < UINT32_MAX && header.names_size < ((uint64_t) 1 << 48)) {
+    expected_size = sizeof(header) + avl_snapshot_padded(header.size * sizeof(uint32_t))
+                  + (header.size + 1) * sizeof(uint64_t)
+                  + avl_snapshot_padded(header.names_size);
+    if (header.flags & AVL_SNAPSHOT_LAYOUT) {
+      expected_size += 2 * avl_snapshot_padded((header.size + 1) * sizeof(uint32_t));
+    }
+  }
+
+  if (memcmp(header.magic, AVL_SNAPSHOT_MAGIC, sizeof(AVL_SNAPSHOT_MAGIC))
+      || header.version != AVL_SNAPSHOT_VERSION
+      || (header.flags & ~AVL_SNAPSHOT_LAYOUT)
+      || expected_size != (uint64_t) st.st_size) {
+    std::cerr << "Invalid file: Unsupported or truncated snapshot \"" << path << "\"" << std::endl;
+    munmap(data, st.st_size);
+    return INVALID_FILE;
+  }
+
+  if (verify && avl_snapshot_checksum(static_cast<const char*>(data) + sizeof(header),
+                                      st.st_size - sizeof(header), AVL_SNAPSHOT_SEED)
+                != header.checksum) {
+    std::cerr << "Invalid file: Checksum mismatch in snapshot \"" << path << "\"" << std::endl;
+    munmap(data, st.st_size);
+    return INVALID_FILE;
+  }
+
+  // Name offsets are checked even without the checksum, since reads trust them
+  const uint64_t* name_offsets = reinterpret_cast<const uint64_t*>(
+      static_cast<const char*>(data) + offset + avl_snapshot_padded(header.size * sizeof(uint32_t)));
+  bool offsets_valid = (name_offsets[0] == 0) && (name_offsets[header.size] == header.names_size);
+  for (uint64_t i = 0; offsets_valid && i < header.size; i++) {
+    offsets_valid = (name_offsets[i] <= name_offsets[i + 1]);
+  }
+  if (!offsets_valid) {
+    std::cerr << "Invalid file: Corrupted name offsets in snapshot \"" << path << "\"" << std::endl;
+    munmap(data, st.st_size);
+    return INVALID_FILE;
+  }
+
+  *snapshot = new AVLSnapshot;
+  (*snapshot)->data = static_cast<const char*>(data);
+  (*snapshot)->file_size = st.st_size;
+  (*snapshot)->size = header.size;
+
+  (*snapshot)->ids = reinterpret_cast<const uint32_t*>((*snapshot)->data + offset);
+  offset += avl_snapshot_padded(header.size * sizeof(uint32_t));
+  (*snapshot)->name_offsets = reinterpret_cast<const uint64_t*>((*snapshot)->data + offset);
+  offset += (header.size + 1) * sizeof(uint64_t);
+  (*snapshot)->names = (*snapshot)->data + offset;
+  offset += avl_snapshot_padded(header.names_size);
+
+  if (header.flags & AVL_SNAPSHOT_LAYOUT) {
+    (*snapshot)->layout_keys = reinterpret_cast<const uint32_t*>((*snapshot)->data + offset);
+    offset += avl_snapshot_padded((header.size + 1) * sizeof(uint32_t));
+    (*snapshot)->layout_ranks = reinterpret_cast<const uint32_t*>((*snapshot)->data + offset);
+  }
+
+  return RET_OK;
+}
+
+int avl_snapshot_close(AVLSnapshot** snapshot)
+{
+  if (*snapshot == NULL) {
+    std::cerr << "Invalid snapshot: Given snapshot pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  munmap(const_cast<char*>((*snapshot)->data), (*snapshot)->file_size);
+  delete *snapshot;
+  *snapshot = NULL;
+
+  return RET_OK;
+}
+
+int avl_snapshot_search(AVLSnapshot* snapshot, uint32_t id, uint32_t* rank,
+                        bool* found)
+{
+  const uint32_t* keys = NULL;
+  uint64_t n = 0;
+  uint64_t k = 1;
+  uint64_t lo = 0;
+  uint64_t hi = 0;
+
+  if (snapshot == NULL) {
+    std::cerr << "Invalid snapshot: Given snapshot pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  n = snapshot->size;
+
+  if (snapshot->layout_keys != NULL) {
+    // Same branchless descent as avl_frozen_tree_search
+    keys = snapshot->layout_keys;
+    while (k <= n) {
+      __builtin_prefetch(keys + 16 * k);
+      k = 2 * k + (keys[k] < id);
+    }
+    k >>= __builtin_ffsll(~k);
+    *rank = snapshot->layout_ranks[k];
+  } else {
+    hi = n;
+    while (lo < hi) {
+      k = lo + (hi - lo) / 2;
+      if (snapshot->ids[k] < id) lo = k + 1;
+      else hi = k;
+    }
+    *rank = lo;
+  }
+
+  *found = (*rank < n) && (snapshot->ids[*rank] == id);
+
+  return RET_OK;
+}
+
+int avl_snapshot_get_name(AVLSnapshot* snapshot, uint32_t rank,
+                          std::string* name)
+{
+  if (snapshot == NULL) {
+    std::cerr << "Invalid snapshot: Given snapshot pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if (rank >= snapshot->size) {
+    std::cerr << "Invalid index (" << rank << "): Rank out of range" << std::endl;
+    return INVALID_INDEX;
+  }
+
+  name->assign(snapshot->names + snapshot->name_offsets[rank],
+               snapshot->name_offsets[rank + 1] - snapshot->name_offsets[rank]);
+  return RET_OK;
+}
+
+int avl_snapshot_to_tree(AVLSnapshot* snapshot, AVLNode** root,
+                         AVLNodePool* pool)
+{
+  std::vector<db_entry> db_list;
+
+  if (snapshot == NULL) {
+    std::cerr << "Invalid snapshot: Given snapshot pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if (*root != NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is not NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  db_list.reserve(snapshot->size);
+  for (uint64_t i = 0; i < snapshot->size; i++) {
+    db_list.emplace_back(snapshot->ids[i],
+                         std::string(snapshot->names + snapshot->name_offsets[i],
+                                     snapshot->name_offsets[i + 1] - snapshot->name_offsets[i]));
+  }
+
+  return avl_tree_bulk_load(&db_list, root, pool);
+}
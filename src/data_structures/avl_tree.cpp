@@ -1,87 +1,506 @@
 #include "include/data_structures/avl_tree.hpp"
+#include "include/data_structures/avl_db_parser.hpp"
+#include "include/data_structures/avl_tree_stats.hpp"
 #include <cstdlib>
-#include <fstream>
-#include <sstream>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <utility>
 #include <algorithm>
 #include <stack>
 #include <queue>
+#include <thread>
+#include <future>
+#include <mutex>
+#include <cerrno>
+#include <unistd.h>
+
+int avl_tree_create(std::string infile, AVLNode** root, AVLNodePool* pool,
+                    AVLIdBitmap* bitmap)
+{
+  int ret = RET_OK;
+  std::vector<db_entry> db_list;
+
+  if (*root != NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is not NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  ret = avl_db_parse_file(infile, &db_list);
+  if (ret) return ret;
+
+  // Insert each parsed DB entry into the tree
+  for (auto& db_entry : db_list) {
+    ret = avl_tree_insert(root, db_entry.first, db_entry.second, pool, bitmap);
+    if (ret && (ret != INVALID_KEY) && (ret != KEY_EXISTS)) return ret;
+  }
+
+  return ret;
+}
 
-//! Reads the input file and returns a vector of DB entries (id-name pairs)
-static int parse_db_list(std::string infile, std::vector<db_entry>* db_list)
+int avl_tree_create_bulk(std::string infile, AVLNode** root, AVLNodePool* pool)
 {
-  std::string name = "";
-  std::string id_s = "";
-  int id = 0;
+  int ret = RET_OK;
+  std::vector<db_entry> db_list;
 
-  std::string line, col;
-  std::ifstream file(infile);
-  char* endp = NULL;
-  int lnum = 0;
+  if (*root != NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is not NULL" << std::endl;
+    return INVALID_TREE;
+  }
 
-  if (file.is_open()) {
-    lnum = 0;
-    while (std::getline(file, line)) {
-      std::stringstream linestream(line);
-      std::vector<std::string> cols;
+  ret = avl_db_parse_file(infile, &db_list);
+  if (ret) return ret;
 
-      while (std::getline(linestream, col, ',')) cols.push_back(col);
+  return avl_tree_bulk_load(&db_list, root, pool);
+}
 
-      if (cols.size() > 2) {
-        std::cerr << "Invalid number of rows " << std::to_string(cols.size())
-                  << " in file \"" << std::string(infile) << "\" line "
-                  << std::to_string(lnum) << std::endl;
-        file.close();
-        return INVALID_FILE;
-      }
+/* Stable LSD radix sort of (id << 32 | position) keys by their 30-bit id,
+ * so equal ids keep their original (file) order.
+ */
+static void radix_sort_ids(std::vector<uint64_t>* keys)
+{
+  const int radix_bits = 10;
+  const uint64_t radix_mask = (1 << radix_bits) - 1;
+  std::vector<uint64_t> tmp(keys->size());
+  std::vector<size_t> count(radix_mask + 1);
+  size_t sum = 0;
+  size_t bucket_size = 0;
+
+  for (int shift = 32; shift < 32 + 30; shift += radix_bits) {
+    std::fill(count.begin(), count.end(), 0);
+    for (uint64_t key : *keys) count[(key >> shift) & radix_mask]++;
+
+    sum = 0;
+    for (size_t& c : count) {
+      bucket_size = c;
+      c = sum;
+      sum += bucket_size;
+    }
 
-      name = cols.at(0);
-      id_s = cols.at(1);
-      id = strtod(id_s.c_str(), &endp);
+    for (uint64_t key : *keys) tmp[count[(key >> shift) & radix_mask]++] = key;
+    keys->swap(tmp);
+  }
+}
 
-      if (endp != id_s.c_str()+id_s.size()) {
-        std::cerr << "Invalid id \"" << id_s << "\" in file \""
-                  << std::string(infile) << "\" line "
-                  << std::to_string(lnum) << std::endl;
-        file.close();
-        return INVALID_KEY;
-      }
+// Recursively builds a balanced subtree from sorted keys [lo, hi)
+static AVLNode* avl_tree_build(std::vector<db_entry>* db_list,
+                               const std::vector<uint64_t>& keys,
+                               size_t lo, size_t hi, AVLNode* parent,
+                               AVLNodePool* pool)
+{
+  AVLNode* node = NULL;
+  size_t mid = lo + (hi - lo) / 2;
+
+  if (lo >= hi) return NULL;
+
+  avl_node_alloc(pool, &node);
+  node->id = keys[mid] >> 32;
+  node->name = std::move((*db_list)[keys[mid] & 0xffffffff].second);
+  node->parent = parent;
+
+  node->lchild = avl_tree_build(db_list, keys, lo, mid, node, pool);
+  node->rchild = avl_tree_build(db_list, keys, mid + 1, hi, node, pool);
+
+  if (node->lchild) avl_tree_get_max_height(node->lchild, &(node->lheight));
+  if (node->rchild) avl_tree_get_max_height(node->rchild, &(node->rheight));
+  node->size = (int) (hi - lo);
+
+  return node;
+}
+
+int avl_tree_bulk_load(std::vector<db_entry>* db_list, AVLNode** root,
+                       AVLNodePool* pool)
+{
+  std::vector<uint64_t> keys;
+  size_t n = 0;
+
+  if (*root != NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is not NULL" << std::endl;
+    return INVALID_TREE;
+  }
 
-      db_list->push_back(std::make_pair(id, name));
-      lnum++;
+  // Drop out of range keys, same as avl_tree_insert
+  keys.reserve(db_list->size());
+  for (size_t i = 0; i < db_list->size(); i++) {
+    uint32_t id = (*db_list)[i].first;
+    if ((id < MIN_ID) || (id > MAX_ID)) {
+      std::cerr << "Invalid key (" << id << "): Value out of range" << std::endl;
+      continue;
     }
+    keys.push_back(((uint64_t) id << 32) | i);
+  }
 
-    file.close();
+  radix_sort_ids(&keys);
+
+  // Drop duplicates, keeping the first occurrence in input order
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (n > 0 && (keys[n-1] >> 32) == (keys[i] >> 32)) {
+      std::cerr << "Invalid insertion: Key already exists" << std::endl;
+      continue;
+    }
+    keys[n++] = keys[i];
   }
+  keys.resize(n);
+
+  *root = avl_tree_build(db_list, keys, 0, n, NULL, pool);
 
   return RET_OK;
 }
 
-int avl_tree_create(std::string infile, AVLNode** root)
+//! Reads up to size bytes from a source, returns 0 at its end and -1 on errors
+typedef ssize_t (*avl_tree_read_fn)(void* source, char* buffer, size_t size);
+
+static ssize_t avl_tree_read_stream(void* source, char* buffer, size_t size)
+{
+  std::istream* in = static_cast<std::istream*>(source);
+
+  in->read(buffer, size);
+  return in->bad() ? -1 : in->gcount();
+}
+
+static ssize_t avl_tree_read_fd(void* source, char* buffer, size_t size)
+{
+  ssize_t n = 0;
+
+  do {
+    n = read(*static_cast<int*>(source), buffer, size);
+  } while (n < 0 && errno == EINTR);
+
+  return n;
+}
+
+//! Entries parsed and waiting to be inserted by the streaming loader
+struct AVLStreamBatch {
+  std::vector<db_entry> entries;
+  size_t bytes;
+};
+
+// Stages a parsed entry in the batch
+static void avl_tree_stream_add(uint32_t id, const char* name, size_t length, void* arg)
+{
+  AVLStreamBatch* batch = static_cast<AVLStreamBatch*>(arg);
+
+  batch->entries.emplace_back(id, std::string(name, length));
+  batch->bytes += sizeof(db_entry) + length;
+}
+
+/* Loads the "name, id" lines read from a source. Only whole lines are
+ * parsed, the partial last line of each buffer is moved to its front and
+ * completed by the next read. A quarter of the budget goes to the buffer
+ * (grown only for lines longer than it), the rest to the staged entries.
+ */
+static int avl_tree_create_source(avl_tree_read_fn read_source, void* source,
+                                  const std::string& name, AVLNode** root,
+                                  size_t memory_budget, AVLNodePool* pool)
 {
+  std::vector<char> buffer(std::max<size_t>(std::min<size_t>(memory_budget / 4,
+                                                              AVL_STREAM_BUFFER_SIZE), 4096));
+  AVLStreamBatch batch = {{}, 0};
+  std::vector<int> results;
+  std::string error;
+  const char* newline = NULL;
+  size_t used = 0;
+  size_t end = 0;
+  ssize_t n = 0;
+  bool eof = false;
+  int lnum = 0;
   int ret = RET_OK;
-  std::vector<db_entry> db_list;
 
   if (*root != NULL) {
     std::cerr << "Invalid tree: Given AVL tree root pointer is not NULL" << std::endl;
     return INVALID_TREE;
   }
 
-  ret = parse_db_list(infile, &db_list);
-  if (ret) return ret;
+  while (!eof) {
+    n = read_source(source, buffer.data() + used, buffer.size() - used);
+    if (n < 0) {
+      std::cerr << "Invalid file: Read error on \"" << name << "\"" << std::endl;
+      ret = INVALID_FILE;
+      break;
+    }
+    eof = (n == 0);
+    used += n;
 
-  // Insert each parsed DB entry into the tree
-  for (auto& db_entry : db_list) {
-    ret = avl_tree_insert(root, db_entry.first, db_entry.second);
-    if (ret && (ret != INVALID_KEY) && (ret != KEY_EXISTS)) return ret;
+    // Parse up to the last newline, everything that's left at the end
+    newline = static_cast<const char*>(memrchr(buffer.data(), '\n', used));
+    end = eof ? used : (newline ? newline - buffer.data() + 1 : 0);
+
+    if (end == 0 && !eof) {
+      if (used == buffer.size()) buffer.resize(2 * buffer.size());
+      continue;
+    }
+
+    n = batch.entries.size();
+    ret = avl_db_parse(buffer.data(), buffer.data() + end, name, lnum, &error,
+                       avl_tree_stream_add, &batch);
+    if (ret) {
+      std::cerr << error << std::endl;
+      break;
+    }
+    lnum += batch.entries.size() - n;
+
+    memmove(buffer.data(), buffer.data() + end, used - end);
+    used -= end;
+
+    if (batch.bytes + buffer.size() >= memory_budget || eof) {
+      avl_tree_insert_batch(root, &batch.entries, &results, pool);
+      batch.entries.clear();
+      batch.bytes = 0;
+    }
   }
 
+  if (ret && *root != NULL) avl_tree_destroy(root, pool);
+
   return ret;
 }
 
-int avl_tree_destroy(AVLNode** root)
+int avl_tree_create_stream(std::istream* in, AVLNode** root,
+                           size_t memory_budget, AVLNodePool* pool)
+{
+  return avl_tree_create_source(avl_tree_read_stream, in, "<stream>", root,
+                                memory_budget, pool);
+}
+
+int avl_tree_create_fd(int fd, AVLNode** root, size_t memory_budget,
+                       AVLNodePool* pool)
+{
+  return avl_tree_create_source(avl_tree_read_fd, &fd, "<fd " + std::to_string(fd) + ">",
+                                root, memory_budget, pool);
+}
+
+//! Nodes filled by one parallel loader thread
+struct AVLParallelChunk {
+  std::vector<AVLNode*>* nodes;
+  size_t index;
+  bool allocate;
+};
+
+// Stores a parsed entry in the next node of the chunk
+static void avl_tree_parallel_add(uint32_t id, const char* name, size_t length, void* arg)
+{
+  AVLParallelChunk* chunk = static_cast<AVLParallelChunk*>(arg);
+  AVLNode*& node = (*chunk->nodes)[chunk->index++];
+
+  if (chunk->allocate) {
+    node = new AVLNode;
+    AVL_TREE_STATS_ADD(AVL_STATS_ALLOCS, 1);
+  }
+  node->id = id;
+  node->name.assign(name, length);
+}
+
+//! Runs fn(t) for t in [0, num_threads), fn(0) on the calling thread
+template <typename Task>
+static void run_parallel(unsigned int num_threads, Task fn)
+{
+  std::vector<std::thread> workers;
+
+  for (unsigned int t = 1; t < num_threads; t++) workers.emplace_back(fn, t);
+  fn(0);
+  for (auto& worker : workers) worker.join();
+}
+
+// Links the already allocated nodes of sorted keys [lo, hi) into a balanced subtree
+static AVLNode* avl_tree_link(const std::vector<AVLNode*>& nodes,
+                              const std::vector<uint64_t>& keys,
+                              size_t lo, size_t hi, AVLNode* parent, int depth)
+{
+  AVLNode* node = NULL;
+  size_t mid = lo + (hi - lo) / 2;
+  std::thread left;
+
+  if (lo >= hi) return NULL;
+
+  node = nodes[keys[mid] & 0xffffffff];
+  node->parent = parent;
+
+  // Hand the left subtree to a new thread for the first depth levels
+  if (depth > 0) {
+    left = std::thread([&]() {
+      node->lchild = avl_tree_link(nodes, keys, lo, mid, node, depth - 1);
+    });
+  } else {
+    node->lchild = avl_tree_link(nodes, keys, lo, mid, node, 0);
+  }
+  node->rchild = avl_tree_link(nodes, keys, mid + 1, hi, node, depth - 1);
+  if (left.joinable()) left.join();
+
+  if (node->lchild) avl_tree_get_max_height(node->lchild, &(node->lheight));
+  if (node->rchild) avl_tree_get_max_height(node->rchild, &(node->rheight));
+  node->size = (int) (hi - lo);
+
+  return node;
+}
+
+int avl_tree_create_parallel(std::string infile, AVLNode** root,
+                             unsigned int num_threads, AVLNodePool* pool)
+{
+  AVLDbFile file;
+  std::vector<size_t> bounds;
+  std::vector<size_t> first_line;
+  std::vector<int> rets;
+  std::vector<std::string> errors;
+  std::vector<AVLNode*> nodes;
+  std::vector<std::vector<uint64_t>> runs;
+  std::vector<std::vector<uint64_t>> regions;
+  std::vector<std::vector<uint32_t>> dropped;
+  std::vector<uint64_t> samples;
+  std::vector<uint64_t> splitters;
+  std::vector<size_t> offsets;
+  std::vector<uint64_t> keys;
+  const char* data = NULL;
+  const char* newline = NULL;
+  size_t pos = 0;
+  int depth = 0;
+
+  if (*root != NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is not NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if (num_threads == 0) num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+  if (avl_db_file_map(infile, &file)) return RET_OK;
+  data = file.data;
+
+  // Split the file into one chunk per thread, on line boundaries
+  bounds.resize(num_threads + 1);
+  bounds[0] = 0;
+  for (unsigned int t = 1; t < num_threads; t++) {
+    pos = std::max(file.size * t / num_threads, bounds[t - 1]);
+    newline = (pos > 0 && pos < file.size)
+            ? static_cast<const char*>(memchr(data + pos - 1, '\n', file.size - pos + 1))
+            : NULL;
+    bounds[t] = (pos == 0) ? 0 : (newline ? newline - data + 1 : file.size);
+  }
+  bounds[num_threads] = file.size;
+
+  // Count the lines of each chunk to number them globally. Every line of a
+  // valid file holds one entry, so the line number is also the entry index.
+  first_line.resize(num_threads + 1);
+  run_parallel(num_threads, [&](unsigned int t) {
+    size_t lines = std::count(data + bounds[t], data + bounds[t + 1], '\n');
+    if ((bounds[t + 1] > bounds[t]) && (data[bounds[t + 1] - 1] != '\n')) lines++;
+    first_line[t + 1] = lines;
+  });
+  first_line[0] = 0;
+  for (unsigned int t = 0; t < num_threads; t++) first_line[t + 1] += first_line[t];
+
+  // The pool is not thread safe, carve its nodes before parsing
+  nodes.resize(first_line[num_threads]);
+  if (pool != NULL) {
+    for (AVLNode*& node : nodes) avl_node_alloc(pool, &node);
+  }
+
+  // Parse each chunk into its nodes, and sort the chunk keys
+  rets.resize(num_threads);
+  errors.resize(num_threads);
+  runs.resize(num_threads);
+  dropped.resize(num_threads);
+  run_parallel(num_threads, [&](unsigned int t) {
+    AVLParallelChunk chunk = {&nodes, first_line[t], pool == NULL};
+    size_t index = 0;
+
+    rets[t] = avl_db_parse(data + bounds[t], data + bounds[t + 1], infile,
+                           first_line[t], &errors[t], avl_tree_parallel_add, &chunk);
+    if (rets[t]) return;
+
+    runs[t].reserve(first_line[t + 1] - first_line[t]);
+    for (index = first_line[t]; index < first_line[t + 1]; index++) {
+      uint32_t id = nodes[index]->id;
+      if ((id < MIN_ID) || (id > MAX_ID)) {
+        dropped[t].push_back(index);
+        continue;
+      }
+      runs[t].push_back(((uint64_t) id << 32) | index);
+    }
+    radix_sort_ids(&runs[t]);
+  });
+  avl_db_file_unmap(&file);
+
+  for (unsigned int t = 0; t < num_threads; t++) {
+    if (rets[t] == RET_OK) continue;
+
+    std::cerr << errors[t] << std::endl;
+    for (AVLNode* node : nodes) {
+      if (node != NULL) avl_node_free(pool, node);
+    }
+    return rets[t];
+  }
+
+  for (unsigned int t = 0; t < num_threads; t++) {
+    for (uint32_t index : dropped[t]) {
+      std::cerr << "Invalid key (" << nodes[index]->id << "): Value out of range" << std::endl;
+      avl_node_free(pool, nodes[index]);
+    }
+    dropped[t].clear();
+  }
+
+  // Pick the ID ranges merged by each thread from evenly spaced key samples
+  for (auto& run : runs) {
+    for (unsigned int s = 0; s < num_threads && !run.empty(); s++) {
+      samples.push_back(run[run.size() * s / num_threads]);
+    }
+  }
+  std::sort(samples.begin(), samples.end());
+
+  splitters.resize(num_threads + 1);
+  splitters[0] = 0;
+  for (unsigned int t = 1; t < num_threads; t++) {
+    splitters[t] = samples.empty() ? 0 : (samples[samples.size() * t / num_threads] >> 32) << 32;
+  }
+  splitters[num_threads] = UINT64_MAX;
+
+  // Merge each ID range across the chunks, dropping duplicates. Chunks are
+  // appended in file order and the radix sort is stable, so the first
+  // occurrence of an ID is the one kept.
+  regions.resize(num_threads);
+  run_parallel(num_threads, [&](unsigned int t) {
+    std::vector<uint64_t>& region = regions[t];
+    size_t n = 0;
+
+    for (auto& run : runs) {
+      region.insert(region.end(),
+                    std::lower_bound(run.begin(), run.end(), splitters[t]),
+                    std::lower_bound(run.begin(), run.end(), splitters[t + 1]));
+    }
+    radix_sort_ids(&region);
+
+    for (size_t i = 0; i < region.size(); i++) {
+      if (n > 0 && (region[n-1] >> 32) == (region[i] >> 32)) {
+        dropped[t].push_back(region[i] & 0xffffffff);
+        continue;
+      }
+      region[n++] = region[i];
+    }
+    region.resize(n);
+  });
+
+  runs.clear();
+  for (unsigned int t = 0; t < num_threads; t++) {
+    for (uint32_t index : dropped[t]) {
+      std::cerr << "Invalid insertion: Key already exists" << std::endl;
+      avl_node_free(pool, nodes[index]);
+    }
+  }
+
+  offsets.resize(num_threads + 1);
+  offsets[0] = 0;
+  for (unsigned int t = 0; t < num_threads; t++) offsets[t + 1] = offsets[t] + regions[t].size();
+
+  keys.resize(offsets[num_threads]);
+  run_parallel(num_threads, [&](unsigned int t) {
+    std::copy(regions[t].begin(), regions[t].end(), keys.begin() + offsets[t]);
+  });
+
+  // Build the top levels of the tree on one thread per subtree
+  while ((1u << depth) < num_threads) depth++;
+  *root = avl_tree_link(nodes, keys, 0, keys.size(), NULL, depth);
+
+  return RET_OK;
+}
+
+int avl_tree_destroy(AVLNode** root, AVLNodePool* pool, AVLIdBitmap* bitmap)
 {
   AVLNode* lchild = NULL;
   AVLNode* rchild = NULL;
@@ -91,6 +510,15 @@ int avl_tree_destroy(AVLNode** root)
     return INVALID_TREE;
   }
 
+  // The bitmap belongs to this single tree, none of its keys remain
+  if (bitmap) avl_id_bitmap_clear(bitmap);
+
+  // Pooled trees release all their chunks at once
+  if (pool != NULL) {
+    *root = NULL;
+    return avl_node_pool_reset(pool);
+  }
+
   lchild = (*root)->lchild;
   rchild = (*root)->rchild;
 
@@ -99,10 +527,23 @@ int avl_tree_destroy(AVLNode** root)
 
   delete *root;
   *root = NULL;
+  AVL_TREE_STATS_ADD(AVL_STATS_FREES, 1);
 
   return RET_OK;
 }
 
+// Number of nodes of the given subtree (0 for an empty one)
+static inline int avl_node_size(AVLNode* node)
+{
+  return node ? node->size : 0;
+}
+
+// Recalculates the subtree size of the node from its children
+static inline void avl_node_update_size(AVLNode* node)
+{
+  node->size = 1 + avl_node_size(node->lchild) + avl_node_size(node->rchild);
+}
+
 // Perform AVL Tree RR rotation
 static AVLNode* avl_tree_rotate_rr (AVLNode** root, AVLNode* z, AVLNode* y)
 {
@@ -127,6 +568,9 @@ static AVLNode* avl_tree_rotate_rr (AVLNode** root, AVLNode* z, AVLNode* y)
   avl_tree_get_max_height(z, &(y->lheight));
   z->parent = y;
 
+  avl_node_update_size(z);
+  avl_node_update_size(y);
+
   return y;
 }
 
@@ -153,7 +597,10 @@ static AVLNode* avl_tree_rotate_ll (AVLNode** root, AVLNode* z, AVLNode* y)
   y->rchild = z;
   avl_tree_get_max_height(z, &(y->rheight));
   z->parent = y;
-  
+
+  avl_node_update_size(z);
+  avl_node_update_size(y);
+
   return y;
 }
 
@@ -168,6 +615,9 @@ static AVLNode* avl_tree_rotate_rl (AVLNode** root, AVLNode* z, AVLNode* y, AVLN
   avl_tree_get_max_height(y, &(x->rheight));
   y->parent = x;
 
+  avl_node_update_size(y);
+  avl_node_update_size(x);
+
   z->rchild = x;
   avl_tree_get_max_height(x, &(z->rheight));
   x->parent = z;
@@ -186,6 +636,9 @@ static AVLNode* avl_tree_rotate_lr (AVLNode** root, AVLNode* z, AVLNode* y, AVLN
   avl_tree_get_max_height(y, &(x->lheight));
   y->parent = x;
 
+  avl_node_update_size(y);
+  avl_node_update_size(x);
+
   z->lchild = x;
   avl_tree_get_max_height(x, &(z->lheight));
   x->parent = z;
@@ -212,6 +665,8 @@ static int avl_tree_rebalance(AVLNode** root, AVLNode* node)
   int n_height = 0;
 
   // Traverse tree upwards from inserted leaf
+  AVL_TREE_STATS_ADD(AVL_STATS_REBALANCES, 1);
+  AVL_TREE_STATS_ADD(AVL_STATS_REBALANCE_NODES, 1);
   avl_tree_get_balance_factor(node, &balance_factor);
   is_unbalanced = (std::abs(balance_factor) >= 2);
 
@@ -226,6 +681,7 @@ static int avl_tree_rebalance(AVLNode** root, AVLNode* node)
     }
 
     node = node->parent;
+    AVL_TREE_STATS_ADD(AVL_STATS_REBALANCE_NODES, 1);
 
     avl_tree_get_balance_factor(node, &balance_factor);
     is_unbalanced = (std::abs(balance_factor) >= 2);
@@ -241,18 +697,22 @@ static int avl_tree_rebalance(AVLNode** root, AVLNode* node)
     // RR
     if (y_info.second && x_info.second) {
       node = avl_tree_rotate_rr(root, node, y_info.first);
+      AVL_TREE_STATS_ADD(AVL_STATS_ROTATIONS_RR, 1);
     }
     // RL
     else if (y_info.second && !x_info.second) {
       node = avl_tree_rotate_rl(root, node, y_info.first, x_info.first);
+      AVL_TREE_STATS_ADD(AVL_STATS_ROTATIONS_RL, 1);
     }
     // LR
     else if (!y_info.second && x_info.second) {
       node = avl_tree_rotate_lr(root, node, y_info.first, x_info.first);
+      AVL_TREE_STATS_ADD(AVL_STATS_ROTATIONS_LR, 1);
     }
     // LL
     else if (!y_info.second && !x_info.second) {
       node = avl_tree_rotate_ll(root, node, y_info.first);
+      AVL_TREE_STATS_ADD(AVL_STATS_ROTATIONS_LL, 1);
     }
   }
 
@@ -260,6 +720,7 @@ static int avl_tree_rebalance(AVLNode** root, AVLNode* node)
   while (node != *root && n_height != height) {
     is_right = (node == node->parent->rchild);
     node = node->parent;
+    AVL_TREE_STATS_ADD(AVL_STATS_REBALANCE_NODES, 1);
     avl_tree_get_max_height(node, &height);
 
     if (is_right) {
@@ -274,12 +735,23 @@ static int avl_tree_rebalance(AVLNode** root, AVLNode* node)
   return RET_OK;
 }
 
-int avl_tree_insert(AVLNode** root, uint32_t id, std::string name)
+int avl_tree_insert(AVLNode** root, uint32_t id, std::string name,
+                    AVLNodePool* pool, AVLIdBitmap* bitmap)
 {
+  AVLNode* node = NULL;
   AVLNode* current = NULL;
   bool is_right = false;
   bool found = false;
 
+  // Duplicates are rejected by the bitmap without searching the tree
+  if (bitmap && (id >= MIN_ID) && (id <= MAX_ID)) {
+    avl_id_bitmap_test(bitmap, id, &found);
+    if (found) {
+      std::cerr << "Invalid insertion: Key already exists" << std::endl;
+      return KEY_EXISTS;
+    }
+  }
+
   if (*root) {
     // Search of node insertion position
     avl_tree_search(*root, id, &current, &found);
@@ -296,29 +768,28 @@ int avl_tree_insert(AVLNode** root, uint32_t id, std::string name)
     return INVALID_KEY;
   }
 
+  avl_node_alloc(pool, &node);
+  node->id = id;
+  node->name = std::move(name);
+  if (bitmap) avl_id_bitmap_set(bitmap, id, true);
+
   // Insert new node in proper position
   if (!current) {
-    current = new AVLNode;
-    current->parent = NULL;
-    current->id = id;
-    current->name = name;
-    *root = current;
+    node->parent = NULL;
+    *root = node;
   } else {
     is_right = (id > current->id);
     if (is_right) {
-      current->rchild = new AVLNode;
-      current->rchild->parent = current;
-      current->rchild->id = id;
-      current->rchild->name = name;
-      current = current->rchild;
+      current->rchild = node;
     } else {
-      current->lchild = new AVLNode;
-      current->lchild->parent = current;
-      current->lchild->id = id;
-      current->lchild->name = name;
-      current = current->lchild;
+      current->lchild = node;
     }
+    node->parent = current;
   }
+  current = node;
+
+  // Account the new node on every subtree of the insertion path
+  for (node = current->parent; node != NULL; node = node->parent) node->size++;
 
   // Rebalance the tree after insertion
   avl_tree_rebalance(root, current);
@@ -326,91 +797,668 @@ int avl_tree_insert(AVLNode** root, uint32_t id, std::string name)
   return RET_OK;
 }
 
-int avl_tree_search(AVLNode* root, uint32_t id, AVLNode** node, bool* found)
+// Height of the given subtree (0 for an empty one)
+static inline int avl_node_height(AVLNode* node)
 {
-  AVLNode* next;
-  bool is_right;
+  return node ? 1 + std::max(node->lheight, node->rheight) : 0;
+}
 
-  *found = false;
+// Makes l and r the children of node, updating its heights and size
+static AVLNode* avl_node_link(AVLNode* node, AVLNode* l, AVLNode* r)
+{
+  node->lchild = l;
+  node->rchild = r;
+  if (l) l->parent = node;
+  if (r) r->parent = node;
 
-  if (root == NULL) {
-    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
-    return INVALID_TREE;
-  }
+  node->lheight = avl_node_height(l);
+  node->rheight = avl_node_height(r);
+  avl_node_update_size(node);
 
-  *node = next = root;
+  return node;
+}
 
-  // BST traversal, compare ID to detect if node is found
-  while (next != NULL && !*found) {
-    *node = next;
-    is_right = (id > (*node)->id);
-    next = is_right ? (*node)->rchild : (*node)->lchild;
-    *found = ((*node)->id == id);
+// Rotates a detached subtree to the left, returning its new root
+static AVLNode* avl_subtree_rotate_left(AVLNode* x)
+{
+  AVLNode* y = x->rchild;
+
+  avl_node_link(x, x->lchild, y->lchild);
+  return avl_node_link(y, x, y->rchild);
+}
+
+// Rotates a detached subtree to the right, returning its new root
+static AVLNode* avl_subtree_rotate_right(AVLNode* x)
+{
+  AVLNode* y = x->lchild;
+
+  avl_node_link(x, y->rchild, x->rchild);
+  return avl_node_link(y, y->lchild, x);
+}
+
+// Joins l, k and r when l is taller, descending the right spine of l
+static AVLNode* avl_tree_join_right(AVLNode* l, AVLNode* k, AVLNode* r)
+{
+  AVLNode* c = l->rchild;
+  AVLNode* t = NULL;
+
+  if (avl_node_height(c) <= avl_node_height(r) + 1) {
+    t = avl_node_link(k, c, r);
+    if (avl_node_height(t) <= avl_node_height(l->lchild) + 1) {
+      return avl_node_link(l, l->lchild, t);
+    }
+    avl_node_link(l, l->lchild, avl_subtree_rotate_right(t));
+    AVL_TREE_STATS_ADD(AVL_STATS_ROTATIONS_RL, 1);
+    return avl_subtree_rotate_left(l);
   }
 
-  return RET_OK;
+  t = avl_tree_join_right(c, k, r);
+  avl_node_link(l, l->lchild, t);
+  if (avl_node_height(t) <= avl_node_height(l->lchild) + 1) return l;
+  AVL_TREE_STATS_ADD(AVL_STATS_ROTATIONS_RR, 1);
+  return avl_subtree_rotate_left(l);
 }
 
-int avl_tree_get_max_node(AVLNode* root, AVLNode** node)
+// Joins l, k and r when r is taller, descending the left spine of r
+static AVLNode* avl_tree_join_left(AVLNode* l, AVLNode* k, AVLNode* r)
 {
-  AVLNode* next;
+  AVLNode* c = r->lchild;
+  AVLNode* t = NULL;
 
-  if (root == NULL) {
-    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
-    return INVALID_TREE;
+  if (avl_node_height(c) <= avl_node_height(l) + 1) {
+    t = avl_node_link(k, l, c);
+    if (avl_node_height(t) <= avl_node_height(r->rchild) + 1) {
+      return avl_node_link(r, t, r->rchild);
+    }
+    avl_node_link(r, avl_subtree_rotate_left(t), r->rchild);
+    AVL_TREE_STATS_ADD(AVL_STATS_ROTATIONS_LR, 1);
+    return avl_subtree_rotate_right(r);
   }
 
-  *node = next = root;
+  t = avl_tree_join_left(l, k, c);
+  avl_node_link(r, t, r->rchild);
+  if (avl_node_height(t) <= avl_node_height(r->rchild) + 1) return r;
+  AVL_TREE_STATS_ADD(AVL_STATS_ROTATIONS_LL, 1);
+  return avl_subtree_rotate_right(r);
+}
 
-  while (next != NULL) {
-    *node = next;
-    next = (*node)->rchild;
+/* Joins two AVL subtrees and a middle node (every key of l lower than k,
+ * every key of r greater) into a single AVL subtree, in O(|h(l) - h(r)|).
+ * The parent pointer of the returned root is left to the caller.
+ */
+static AVLNode* avl_tree_join_nodes(AVLNode* l, AVLNode* k, AVLNode* r)
+{
+  if (avl_node_height(l) > avl_node_height(r) + 1) return avl_tree_join_right(l, k, r);
+  if (avl_node_height(r) > avl_node_height(l) + 1) return avl_tree_join_left(l, k, r);
+  return avl_node_link(k, l, r);
+}
+
+/* Inserts the sorted keys [lo, hi) into the subtree t. The keys are split
+ * around t, each half descends into its side only once, and the subtree is
+ * rebalanced a single time by joining the results back around t.
+ */
+static AVLNode* avl_tree_insert_sorted(AVLNode* t, std::vector<db_entry>* db_list,
+                                       const std::vector<uint64_t>& keys,
+                                       size_t lo, size_t hi,
+                                       std::vector<int>* results,
+                                       AVLNodePool* pool)
+{
+  size_t mid = lo;
+  size_t next = lo;
+  AVLNode* l = NULL;
+  AVLNode* r = NULL;
+
+  if (lo >= hi) return t;
+  if (t == NULL) return avl_tree_build(db_list, keys, lo, hi, NULL, pool);
+
+  // Split the keys around t, a key equal to t already exists
+  mid = std::lower_bound(keys.begin() + lo, keys.begin() + hi,
+                         (uint64_t) t->id << 32) - keys.begin();
+  next = mid;
+  if (next < hi && (keys[next] >> 32) == t->id) {
+    std::cerr << "Invalid insertion: Key already exists" << std::endl;
+    (*results)[keys[next] & 0xffffffff] = KEY_EXISTS;
+    next++;
   }
 
-  return RET_OK;
+  l = avl_tree_insert_sorted(t->lchild, db_list, keys, lo, mid, results, pool);
+  r = avl_tree_insert_sorted(t->rchild, db_list, keys, next, hi, results, pool);
+
+  return avl_tree_join_nodes(l, t, r);
 }
 
-int avl_tree_get_min_node(AVLNode* root, AVLNode** node)
+int avl_tree_insert_batch(AVLNode** root, std::vector<db_entry>* db_list,
+                          std::vector<int>* results, AVLNodePool* pool,
+                          AVLIdBitmap* bitmap)
 {
-  AVLNode* next;
+  std::vector<uint64_t> keys;
+  size_t n = 0;
+
+  results->assign(db_list->size(), RET_OK);
+
+  // Out of range keys are rejected, as with avl_tree_insert
+  keys.reserve(db_list->size());
+  for (size_t i = 0; i < db_list->size(); i++) {
+    uint32_t id = (*db_list)[i].first;
+    if ((id < MIN_ID) || (id > MAX_ID)) {
+      std::cerr << "Invalid key (" << id << "): Value out of range" << std::endl;
+      (*results)[i] = INVALID_KEY;
+      continue;
+    }
+    keys.push_back(((uint64_t) id << 32) | i);
+  }
 
-  if (root == NULL) {
-    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
-    return INVALID_TREE;
+  radix_sort_ids(&keys);
+
+  // Later duplicates within the batch find the key already inserted
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (n > 0 && (keys[n-1] >> 32) == (keys[i] >> 32)) {
+      std::cerr << "Invalid insertion: Key already exists" << std::endl;
+      (*results)[keys[i] & 0xffffffff] = KEY_EXISTS;
+      continue;
+    }
+    keys[n++] = keys[i];
   }
+  keys.resize(n);
 
-  *node = next = root;
+  *root = avl_tree_insert_sorted(*root, db_list, keys, 0, n, results, pool);
+  if (*root) (*root)->parent = NULL;
 
-  while (next != NULL) {
-    *node = next;
-    next = (*node)->lchild;
+  if (bitmap) {
+    for (uint64_t key : keys) {
+      if ((*results)[key & 0xffffffff] == RET_OK) avl_id_bitmap_set(bitmap, key >> 32, true);
+    }
   }
 
   return RET_OK;
 }
 
-// FIXME: Implement rebalance step
-//! Removes a node from the AVL Tree
-int avl_tree_remove(AVLNode** root, uint32_t id)
+/* Splits the subtree t around a key: l gets the keys lower than id, r the
+ * greater ones and m the node of the key itself (NULL if missing), in
+ * O(h(t)) by joining back the subtrees hanging off the search path.
+ */
+static void avl_tree_split_nodes(AVLNode* t, uint32_t id, AVLNode** l,
+                                 AVLNode** m, AVLNode** r)
 {
-  AVLNode* current = NULL;
-  AVLNode* replace = NULL;
-  AVLNode* del_node = NULL;
-  bool is_right = false;
-  bool found = false;
+  AVLNode* lchild = NULL;
+  AVLNode* rchild = NULL;
 
-  if (root == NULL) {
-    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
-    return INVALID_TREE;
+  if (t == NULL) {
+    *l = *m = *r = NULL;
+    return;
   }
 
-  avl_tree_search(*root, id, &current, &found);
-  if (!found) {
-    std::cerr << "Invalid deletion: Key not found" << std::endl;
-    return KEY_NOT_FOUND;
+  lchild = t->lchild;
+  rchild = t->rchild;
+
+  if (id == t->id) {
+    *l = lchild;
+    *m = avl_node_link(t, NULL, NULL);
+    *r = rchild;
+  } else if (id < t->id) {
+    avl_tree_split_nodes(lchild, id, l, m, r);
+    *r = avl_tree_join_nodes(*r, t, rchild);
+  } else {
+    avl_tree_split_nodes(rchild, id, l, m, r);
+    *l = avl_tree_join_nodes(lchild, t, *l);
   }
+}
 
-  if (!current->rchild && !current->lchild) {
+// Detaches the maximum key node of a non empty subtree t into last
+static AVLNode* avl_tree_split_last(AVLNode* t, AVLNode** last)
+{
+  AVLNode* rest = t->lchild;
+
+  if (t->rchild == NULL) {
+    *last = avl_node_link(t, NULL, NULL);
+    return rest;
+  }
+
+  rest = avl_tree_split_last(t->rchild, last);
+  return avl_tree_join_nodes(t->lchild, t, rest);
+}
+
+// Joins two subtrees (every key of l lower than every key of r)
+static AVLNode* avl_tree_join2_nodes(AVLNode* l, AVLNode* r)
+{
+  AVLNode* k = NULL;
+
+  if (l == NULL) return r;
+  if (r == NULL) return l;
+
+  l = avl_tree_split_last(l, &k);
+  return avl_tree_join_nodes(l, k, r);
+}
+
+//! Shared state of a fork-join set operation
+struct AVLSetOp {
+  //! Node pool of both trees (NULL for the heap)
+  AVLNodePool* pool;
+  //! Serializes the releases to the pool, which is not thread safe
+  std::mutex lock;
+};
+
+//! Kind of fork-join set operation
+enum AVLSetOpKind {
+  AVL_SET_UNION,
+  AVL_SET_INTERSECTION,
+  AVL_SET_DIFFERENCE
+};
+
+// Releases every node of a detached subtree
+static void avl_set_op_free(AVLSetOp* op, AVLNode* t)
+{
+  if (t == NULL) return;
+
+  avl_set_op_free(op, t->lchild);
+  avl_set_op_free(op, t->rchild);
+
+  if (op->pool) {
+    std::lock_guard<std::mutex> guard(op->lock);
+    avl_node_free(op->pool, t);
+  } else {
+    avl_node_free(NULL, t);
+  }
+}
+
+/* Combines the subtrees t1 and t2, consuming both. t2 is split by the root
+ * key of t1, the two halves are combined recursively with the children of
+ * t1 (in parallel for the first depth levels) and joined back around the
+ * root of t1, or joined together when that key is dropped. Entries of t1
+ * are kept when both subtrees hold a key.
+ */
+static AVLNode* avl_set_op_nodes(AVLSetOp* op, AVLSetOpKind kind,
+                                 AVLNode* t1, AVLNode* t2, int depth)
+{
+  AVLNode* l1 = NULL;
+  AVLNode* r1 = NULL;
+  AVLNode* l2 = NULL;
+  AVLNode* m2 = NULL;
+  AVLNode* r2 = NULL;
+  AVLNode* l = NULL;
+  AVLNode* r = NULL;
+  std::future<AVLNode*> left;
+  int size = 0;
+  bool keep = false;
+
+  if (t1 == NULL || t2 == NULL) {
+    if (kind == AVL_SET_UNION) return t1 ? t1 : t2;
+    avl_set_op_free(op, t2);
+    if (kind == AVL_SET_DIFFERENCE) return t1;
+    avl_set_op_free(op, t1);
+    return NULL;
+  }
+
+  size = avl_node_size(t1) + avl_node_size(t2);
+  l1 = t1->lchild;
+  r1 = t1->rchild;
+  avl_tree_split_nodes(t2, t1->id, &l2, &m2, &r2);
+
+  // Small subtrees are not worth a new thread
+  if (depth > 0 && size >= AVL_SET_OP_GRAIN) {
+    left = std::async(std::launch::async, avl_set_op_nodes, op, kind, l1, l2, depth - 1);
+    r = avl_set_op_nodes(op, kind, r1, r2, depth - 1);
+    l = left.get();
+  } else {
+    l = avl_set_op_nodes(op, kind, l1, l2, 0);
+    r = avl_set_op_nodes(op, kind, r1, r2, 0);
+  }
+
+  if (m2) avl_set_op_free(op, m2);
+
+  switch (kind) {
+    case AVL_SET_UNION:        keep = true;          break;
+    case AVL_SET_INTERSECTION: keep = (m2 != NULL);  break;
+    case AVL_SET_DIFFERENCE:   keep = (m2 == NULL);  break;
+  }
+
+  if (keep) return avl_tree_join_nodes(l, t1, r);
+
+  avl_node_link(t1, NULL, NULL);
+  avl_set_op_free(op, t1);
+  return avl_tree_join2_nodes(l, r);
+}
+
+// Runs a set operation on two whole trees, consuming both
+static int avl_tree_set_op(AVLSetOpKind kind, AVLNode** first, AVLNode** second,
+                           AVLNode** root, AVLNodePool* pool,
+                           unsigned int num_threads)
+{
+  AVLSetOp op;
+  int depth = 0;
+
+  if (first == NULL || second == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if (*first != NULL && *first == *second) {
+    std::cerr << "Invalid tree: Given AVL trees are the same tree" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if (num_threads == 0) num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  while ((1u << depth) < num_threads) depth++;
+
+  op.pool = pool;
+  *root = avl_set_op_nodes(&op, kind, *first, *second, depth);
+  if (*root) (*root)->parent = NULL;
+  if (root != first) *first = NULL;
+  if (root != second) *second = NULL;
+
+  return RET_OK;
+}
+
+int avl_tree_join(AVLNode** left, AVLNode* node, AVLNode** right, AVLNode** root)
+{
+  AVLNode* max_node = NULL;
+  AVLNode* min_node = NULL;
+
+  if (left == NULL || right == NULL || node == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if (*left) avl_tree_get_max_node(*left, &max_node);
+  if (*right) avl_tree_get_min_node(*right, &min_node);
+  if ((max_node && max_node->id >= node->id) || (min_node && min_node->id <= node->id)) {
+    std::cerr << "Invalid join: Keys out of order" << std::endl;
+    return INVALID_KEY;
+  }
+
+  *root = avl_tree_join_nodes(*left, node, *right);
+  (*root)->parent = NULL;
+  if (root != left) *left = NULL;
+  if (root != right) *right = NULL;
+
+  return RET_OK;
+}
+
+int avl_tree_join2(AVLNode** left, AVLNode** right, AVLNode** root)
+{
+  AVLNode* max_node = NULL;
+  AVLNode* min_node = NULL;
+
+  if (left == NULL || right == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if (*left) avl_tree_get_max_node(*left, &max_node);
+  if (*right) avl_tree_get_min_node(*right, &min_node);
+  if (max_node && min_node && max_node->id >= min_node->id) {
+    std::cerr << "Invalid join: Keys out of order" << std::endl;
+    return INVALID_KEY;
+  }
+
+  *root = avl_tree_join2_nodes(*left, *right);
+  if (*root) (*root)->parent = NULL;
+  if (root != left) *left = NULL;
+  if (root != right) *right = NULL;
+
+  return RET_OK;
+}
+
+int avl_tree_split(AVLNode** root, uint32_t id, AVLNode** left,
+                   AVLNode** node, AVLNode** right)
+{
+  AVLNode* t = NULL;
+
+  if (root == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  t = *root;
+  *root = NULL;
+  avl_tree_split_nodes(t, id, left, node, right);
+  if (*left) (*left)->parent = NULL;
+  if (*node) (*node)->parent = NULL;
+  if (*right) (*right)->parent = NULL;
+
+  return RET_OK;
+}
+
+int avl_tree_union(AVLNode** first, AVLNode** second, AVLNode** root,
+                   AVLNodePool* pool, unsigned int num_threads)
+{
+  return avl_tree_set_op(AVL_SET_UNION, first, second, root, pool, num_threads);
+}
+
+int avl_tree_intersection(AVLNode** first, AVLNode** second, AVLNode** root,
+                          AVLNodePool* pool, unsigned int num_threads)
+{
+  return avl_tree_set_op(AVL_SET_INTERSECTION, first, second, root, pool, num_threads);
+}
+
+int avl_tree_difference(AVLNode** first, AVLNode** second, AVLNode** root,
+                        AVLNodePool* pool, unsigned int num_threads)
+{
+  return avl_tree_set_op(AVL_SET_DIFFERENCE, first, second, root, pool, num_threads);
+}
+
+int avl_tree_search(AVLNode* root, uint32_t id, AVLNode** node, bool* found,
+                    AVLIdBitmap* bitmap)
+{
+  AVLNode* next;
+  bool is_right;
+
+  *found = false;
+
+  if (root == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  // Misses are answered by the bitmap without touching the tree
+  if (bitmap) {
+    avl_id_bitmap_test(bitmap, id, found);
+    if (!*found) {
+      *node = NULL;
+      return RET_OK;
+    }
+    *found = false;
+  }
+
+  *node = next = root;
+  AVL_TREE_STATS_ADD(AVL_STATS_SEARCHES, 1);
+
+  // BST traversal, compare ID to detect if node is found
+  while (next != NULL && !*found) {
+    AVL_TREE_STATS_ADD(AVL_STATS_COMPARISONS, 1);
+    *node = next;
+    is_right = (id > (*node)->id);
+    next = is_right ? (*node)->rchild : (*node)->lchild;
+    *found = ((*node)->id == id);
+  }
+
+  return RET_OK;
+}
+
+int avl_tree_search_batch(AVLNode* root, const uint32_t* ids, size_t n,
+                          AVLNode** results, size_t inflight)
+{
+  // State of a lookup in flight: current node and position of its key
+  struct lookup {
+    AVLNode* node;
+    size_t index;
+  } lookups[AVL_SEARCH_BATCH_MAX_INFLIGHT];
+
+  AVLNode* node = NULL;
+  size_t active = 0;
+  size_t next = 0;
+  size_t i = 0;
+  uint32_t id = 0;
+
+  if (root == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  inflight = std::max<size_t>(1, std::min<size_t>(inflight, AVL_SEARCH_BATCH_MAX_INFLIGHT));
+
+  for (; active < inflight && next < n; active++, next++) {
+    lookups[active].node = root;
+    lookups[active].index = next;
+  }
+
+  // Round-robin over the lookups in flight, one tree level per visit. A
+  // finished lookup hands its slot to the next pending key.
+  while (active > 0) {
+    i = 0;
+    while (i < active) {
+      node = lookups[i].node;
+      id = ids[lookups[i].index];
+
+      if (node == NULL || node->id == id) {
+        results[lookups[i].index] = node;
+
+        if (next < n) {
+          lookups[i].node = root;
+          lookups[i].index = next++;
+          i++;
+        } else {
+          lookups[i] = lookups[--active];
+        }
+        continue;
+      }
+
+      node = (id > node->id) ? node->rchild : node->lchild;
+      if (node) __builtin_prefetch(node);
+
+      lookups[i].node = node;
+      i++;
+    }
+  }
+
+  return RET_OK;
+}
+
+int avl_tree_get_max_node(AVLNode* root, AVLNode** node)
+{
+  AVLNode* next;
+
+  if (root == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  *node = next = root;
+
+  while (next != NULL) {
+    *node = next;
+    next = (*node)->rchild;
+  }
+
+  return RET_OK;
+}
+
+int avl_tree_get_min_node(AVLNode* root, AVLNode** node)
+{
+  AVLNode* next;
+
+  if (root == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  *node = next = root;
+
+  while (next != NULL) {
+    *node = next;
+    next = (*node)->lchild;
+  }
+
+  return RET_OK;
+}
+
+/* Rebalance the AVL Tree after a removal. Retraces the path from the parent
+ * of the unlinked node up to the root, updating heights and rotating each
+ * unbalanced node found on the way (possibly several times).
+ */
+static int avl_tree_rebalance_remove(AVLNode** root, AVLNode* node)
+{
+  AVLNode* y = NULL;
+  int balance_factor = 0;
+  int y_balance_factor = 0;
+  int height = 0;
+  bool is_right = false;
+
+  AVL_TREE_STATS_ADD(AVL_STATS_REBALANCES, 1);
+
+  while (node != NULL) {
+    AVL_TREE_STATS_ADD(AVL_STATS_REBALANCE_NODES, 1);
+    avl_tree_get_balance_factor(node, &balance_factor);
+
+    // Right heavy: RR, or RL when the right child leans left
+    if (balance_factor >= 2) {
+      y = node->rchild;
+      avl_tree_get_balance_factor(y, &y_balance_factor);
+      if (y_balance_factor >= 0) {
+        node = avl_tree_rotate_rr(root, node, y);
+        AVL_TREE_STATS_ADD(AVL_STATS_ROTATIONS_RR, 1);
+      } else {
+        node = avl_tree_rotate_rl(root, node, y, y->lchild);
+        AVL_TREE_STATS_ADD(AVL_STATS_ROTATIONS_RL, 1);
+      }
+    }
+    // Left heavy: LL, or LR when the left child leans right
+    else if (balance_factor <= -2) {
+      y = node->lchild;
+      avl_tree_get_balance_factor(y, &y_balance_factor);
+      if (y_balance_factor <= 0) {
+        node = avl_tree_rotate_ll(root, node, y);
+        AVL_TREE_STATS_ADD(AVL_STATS_ROTATIONS_LL, 1);
+      } else {
+        node = avl_tree_rotate_lr(root, node, y, y->rchild);
+        AVL_TREE_STATS_ADD(AVL_STATS_ROTATIONS_LR, 1);
+      }
+    }
+
+    if (node->parent == NULL) break;
+
+    // Propagate the subtree height, stop once it no longer changes
+    avl_tree_get_max_height(node, &height);
+    is_right = (node == node->parent->rchild);
+    node = node->parent;
+
+    if (is_right) {
+      if (node->rheight == height) break;
+      node->rheight = height;
+    } else {
+      if (node->lheight == height) break;
+      node->lheight = height;
+    }
+  }
+
+  return RET_OK;
+}
+
+//! Removes a node from the AVL Tree
+int avl_tree_remove(AVLNode** root, uint32_t id, AVLNodePool* pool,
+                    AVLIdBitmap* bitmap)
+{
+  AVLNode* current = NULL;
+  AVLNode* replace = NULL;
+  AVLNode* del_node = NULL;
+  AVLNode* parent = NULL;
+  bool is_right = false;
+  bool found = false;
+
+  if (root == NULL || *root == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  avl_tree_search(*root, id, &current, &found, bitmap);
+  if (!found) {
+    std::cerr << "Invalid deletion: Key not found" << std::endl;
+    return KEY_NOT_FOUND;
+  }
+
+  if (bitmap) avl_id_bitmap_set(bitmap, id, false);
+
+  if (!current->rchild && !current->lchild) {
     if (current->parent) {
       is_right = (current == current->parent->rchild);
       if (is_right) {
@@ -467,36 +1515,282 @@ int avl_tree_remove(AVLNode** root, uint32_t id)
     }
 
     current->id = replace->id;
-    current->name = replace->name;
+    current->name = std::move(replace->name);
 
     del_node = replace;
   }
 
-  if (del_node == *root) *root = NULL;
-  delete del_node;
+  // The only child (if any) of a removed root becomes the new root
+  if (del_node == *root) {
+    *root = del_node->lchild ? del_node->lchild : del_node->rchild;
+  }
+
+  parent = del_node->parent;
+  avl_node_free(pool, del_node);
+
+  // Discount the removed node on every subtree up to the root
+  for (current = parent; current != NULL; current = current->parent) current->size--;
+
+  // Rebalance the tree after removal
+  if (parent) avl_tree_rebalance_remove(root, parent);
 
   return RET_OK;
 }
 
 int avl_tree_get_size(AVLNode* root, int* size)
 {
-  AVLNode* lchild = NULL;
-  AVLNode* rchild = NULL;
+  if (root == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  *size = root->size;
+  return RET_OK;
+}
+
+// Number of keys lower than (or equal to, if inclusive) the given key
+static int avl_tree_count_lower(AVLNode* root, uint32_t id, bool inclusive)
+{
+  int count = 0;
+
+  while (root != NULL) {
+    if (id > root->id || (inclusive && id == root->id)) {
+      count += 1 + avl_node_size(root->lchild);
+      root = root->rchild;
+    } else {
+      root = root->lchild;
+    }
+  }
+
+  return count;
+}
+
+// In-order successor of the node, following parent pointers
+static AVLNode* avl_node_next(AVLNode* node)
+{
+  if (node->rchild) {
+    node = node->rchild;
+    while (node->lchild) node = node->lchild;
+    return node;
+  }
+
+  while (node->parent && node == node->parent->rchild) node = node->parent;
+  return node->parent;
+}
+
+// In-order predecessor of the node, following parent pointers
+static AVLNode* avl_node_prev(AVLNode* node)
+{
+  if (node->lchild) {
+    node = node->lchild;
+    while (node->rchild) node = node->rchild;
+    return node;
+  }
+
+  while (node->parent && node == node->parent->lchild) node = node->parent;
+  return node->parent;
+}
+
+// First node with a key greater than (or equal to, if inclusive) the given key
+static AVLNode* avl_tree_bound(AVLNode* root, uint32_t id, bool inclusive)
+{
+  AVLNode* bound = NULL;
+
+  while (root != NULL) {
+    if (root->id > id || (inclusive && root->id == id)) {
+      bound = root;
+      root = root->lchild;
+    } else {
+      root = root->rchild;
+    }
+  }
+
+  return bound;
+}
+
+int avl_tree_cursor_seek(AVLNode* root, uint32_t id, AVLCursor* cursor)
+{
+  bool found = false;
+  int ret = RET_OK;
+
+  // A failed seek leaves the cursor past the end, not on a stale node
+  cursor->node = NULL;
+  ret = avl_tree_search(root, id, &cursor->node, &found);
+  if (ret) return ret;
+
+  if (!found) {
+    cursor->node = NULL;
+    return KEY_NOT_FOUND;
+  }
+
+  return RET_OK;
+}
+
+int avl_tree_cursor_lower_bound(AVLNode* root, uint32_t id, AVLCursor* cursor)
+{
+  cursor->node = NULL;
+  if (root == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  cursor->node = avl_tree_bound(root, id, true);
+  return cursor->node ? RET_OK : KEY_NOT_FOUND;
+}
+
+int avl_tree_cursor_upper_bound(AVLNode* root, uint32_t id, AVLCursor* cursor)
+{
+  cursor->node = NULL;
+  if (root == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  cursor->node = avl_tree_bound(root, id, false);
+  return cursor->node ? RET_OK : KEY_NOT_FOUND;
+}
+
+int avl_tree_cursor_next(AVLCursor* cursor)
+{
+  if (cursor->node == NULL) {
+    std::cerr << "Invalid cursor: Given cursor is past the end of the tree" << std::endl;
+    return INVALID_TREE;
+  }
+
+  cursor->node = avl_node_next(cursor->node);
+  return cursor->node ? RET_OK : KEY_NOT_FOUND;
+}
+
+int avl_tree_cursor_prev(AVLCursor* cursor)
+{
+  if (cursor->node == NULL) {
+    std::cerr << "Invalid cursor: Given cursor is past the end of the tree" << std::endl;
+    return INVALID_TREE;
+  }
+
+  cursor->node = avl_node_prev(cursor->node);
+  return cursor->node ? RET_OK : KEY_NOT_FOUND;
+}
+
+int avl_tree_range_scan(AVLNode* root, uint32_t lo, uint32_t hi,
+                        avl_tree_scan_fn callback, void* arg)
+{
+  AVLNode* node = NULL;
+  AVLNode* next = NULL;
+  AVLNode* next2 = NULL;
+
+  if (root == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  if (lo > hi) return RET_OK;
+
+  /* Step through successors two nodes ahead: the successor of the next
+   * node is found (touching only the next node, fetched one step earlier)
+   * and fetched while the callback runs on the current one.
+   */
+  node = avl_tree_bound(root, lo, true);
+  next = node ? avl_node_next(node) : NULL;
+  while (node != NULL && node->id <= hi) {
+    next2 = (next && next->id <= hi) ? avl_node_next(next) : NULL;
+    if (next2) __builtin_prefetch(next2);
+
+    if (!callback(node, arg)) break;
+    node = next;
+    next = next2;
+  }
+
+  return RET_OK;
+}
+
+int avl_tree_get_rank(AVLNode* root, uint32_t id, int* rank)
+{
+  AVLNode* node = NULL;
+  bool found = false;
+
+  if (root == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  *rank = avl_tree_count_lower(root, id, false);
+
+  avl_tree_search(root, id, &node, &found);
+  return found ? RET_OK : KEY_NOT_FOUND;
+}
+
+int avl_tree_select(AVLNode* root, int k, AVLNode** node)
+{
   int lsize = 0;
-  int rsize = 0;
 
   if (root == NULL) {
     std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
     return INVALID_TREE;
   }
 
-  lchild = root->lchild;
-  rchild = root->rchild;
+  if ((k < 0) || (k >= root->size)) {
+    std::cerr << "Invalid index (" << k << "): Position out of range" << std::endl;
+    return INVALID_INDEX;
+  }
+
+  // Descend using subtree sizes to locate the k-th node
+  *node = root;
+  while (true) {
+    lsize = avl_node_size((*node)->lchild);
+    if (k == lsize) break;
 
-  if (lchild != NULL) avl_tree_get_size(lchild, &lsize);
-  if (rchild != NULL) avl_tree_get_size(rchild, &rsize);
+    if (k < lsize) {
+      *node = (*node)->lchild;
+    } else {
+      k -= lsize + 1;
+      *node = (*node)->rchild;
+    }
+  }
+
+  return RET_OK;
+}
+
+int avl_tree_count_range(AVLNode* root, uint32_t lo, uint32_t hi, int* count)
+{
+  if (root == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  *count = 0;
+  if (lo > hi) return RET_OK;
+
+  *count = avl_tree_count_lower(root, hi, true) - avl_tree_count_lower(root, lo, false);
+  return RET_OK;
+}
+
+int avl_tree_get_page(AVLNode* root, int offset, int limit,
+                      std::vector<AVLNode*>* page)
+{
+  AVLNode* node = NULL;
+  int ret = RET_OK;
+
+  page->clear();
+
+  if (root == NULL) {
+    std::cerr << "Invalid tree: Given AVL tree root pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  // An offset past the last node yields an empty page
+  if ((offset == root->size) || (limit <= 0)) return RET_OK;
+
+  ret = avl_tree_select(root, offset, &node);
+  if (ret) return ret;
+
+  // Step through in-order successors from the first node of the page
+  page->reserve(std::min(limit, root->size - offset));
+  while (node != NULL && (int) page->size() < limit) {
+    page->push_back(node);
+    node = avl_node_next(node);
+  }
 
-  *size = 1 + lsize + rsize;
   return RET_OK;
 }
 
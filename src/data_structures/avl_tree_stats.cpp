@@ -0,0 +1,98 @@
+#include "include/data_structures/avl_tree.hpp"
+#include "include/data_structures/avl_tree_stats.hpp"
+#include <vector>
+#include <mutex>
+#include <algorithm>
+
+#ifdef AVL_TREE_STATS
+
+//! Counters of the running threads and totals of the exited ones
+struct AVLTreeStatsRegistry {
+  std::mutex lock;
+  std::vector<AVLTreeStatsThread*> threads;
+  uint64_t exited[AVL_STATS_COUNTERS] = {};
+};
+
+// Constructed on first use, so before (and destroyed after) any thread counters
+static AVLTreeStatsRegistry& avl_tree_stats_registry()
+{
+  static AVLTreeStatsRegistry registry;
+  return registry;
+}
+
+thread_local AVLTreeStatsThread avl_tree_stats_thread;
+
+AVLTreeStatsThread::AVLTreeStatsThread()
+{
+  AVLTreeStatsRegistry& registry = avl_tree_stats_registry();
+
+  for (std::atomic<uint64_t>& counter : counters) counter.store(0, std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> guard(registry.lock);
+  registry.threads.push_back(this);
+}
+
+AVLTreeStatsThread::~AVLTreeStatsThread()
+{
+  AVLTreeStatsRegistry& registry = avl_tree_stats_registry();
+  std::lock_guard<std::mutex> guard(registry.lock);
+
+  for (int i = 0; i < AVL_STATS_COUNTERS; i++) {
+    registry.exited[i] += counters[i].load(std::memory_order_relaxed);
+  }
+  registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), this));
+}
+
+#endif // AVL_TREE_STATS
+
+int avl_tree_get_stats(AVLTreeStats* stats)
+{
+  uint64_t totals[AVL_STATS_COUNTERS] = {};
+
+  if (stats == NULL) {
+    std::cerr << "Invalid stats: Given AVL tree stats pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+#ifdef AVL_TREE_STATS
+  AVLTreeStatsRegistry& registry = avl_tree_stats_registry();
+  std::lock_guard<std::mutex> guard(registry.lock);
+
+  for (int i = 0; i < AVL_STATS_COUNTERS; i++) {
+    totals[i] = registry.exited[i];
+    for (AVLTreeStatsThread* thread : registry.threads) {
+      totals[i] += thread->counters[i].load(std::memory_order_relaxed);
+    }
+  }
+#endif
+
+  stats->searches = totals[AVL_STATS_SEARCHES];
+  stats->comparisons = totals[AVL_STATS_COMPARISONS];
+  stats->rebalances = totals[AVL_STATS_REBALANCES];
+  stats->rebalance_nodes = totals[AVL_STATS_REBALANCE_NODES];
+  stats->rotations_rr = totals[AVL_STATS_ROTATIONS_RR];
+  stats->rotations_ll = totals[AVL_STATS_ROTATIONS_LL];
+  stats->rotations_rl = totals[AVL_STATS_ROTATIONS_RL];
+  stats->rotations_lr = totals[AVL_STATS_ROTATIONS_LR];
+  stats->allocs = totals[AVL_STATS_ALLOCS];
+  stats->frees = totals[AVL_STATS_FREES];
+
+  return RET_OK;
+}
+
+int avl_tree_reset_stats()
+{
+#ifdef AVL_TREE_STATS
+  AVLTreeStatsRegistry& registry = avl_tree_stats_registry();
+  std::lock_guard<std::mutex> guard(registry.lock);
+
+  for (int i = 0; i < AVL_STATS_COUNTERS; i++) {
+    registry.exited[i] = 0;
+    for (AVLTreeStatsThread* thread : registry.threads) {
+      thread->counters[i].store(0, std::memory_order_relaxed);
+    }
+  }
+#endif
+
+  return RET_OK;
+}
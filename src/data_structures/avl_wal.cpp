@@ -0,0 +1,335 @@
+#include "include/data_structures/avl_wal.hpp"
+#include "include/data_structures/avl_db_parser.hpp"
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+//! Bytes of the log file header (the magic)
+#define AVL_WAL_HEADER_SIZE 8
+//! Bytes of a record before its name: crc, op, id, name length
+#define AVL_WAL_RECORD_HEADER_SIZE 13
+
+//! Record of the log, with its name pointing into the mapped file
+struct AVLWalRecord {
+  uint8_t op;
+  uint32_t id;
+  const char* name;
+  uint32_t length;
+};
+
+// CRC-32C (Castagnoli) lookup table, built at startup
+static std::vector<uint32_t> avl_wal_crc_table()
+{
+  std::vector<uint32_t> table(256);
+
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78 : 0);
+    table[i] = crc;
+  }
+
+  return table;
+}
+
+static const std::vector<uint32_t> avl_wal_crc_lookup = avl_wal_crc_table();
+
+static uint32_t avl_wal_crc(const char* data, size_t size)
+{
+  uint32_t crc = 0xFFFFFFFF;
+
+  for (size_t i = 0; i < size; i++) {
+    crc = (crc >> 8) ^ avl_wal_crc_lookup[(crc ^ (uint8_t) data[i]) & 0xFF];
+  }
+
+  return ~crc;
+}
+
+/* Decodes the records of a mapped log, stopping at the first torn or
+ * corrupt one. Returns the offset where the valid records end.
+ */
+static size_t avl_wal_scan(const char* data, size_t size,
+                           std::vector<AVLWalRecord>* records)
+{
+  size_t offset = AVL_WAL_HEADER_SIZE;
+  AVLWalRecord record;
+  uint32_t crc = 0;
+
+  while (size - offset >= AVL_WAL_RECORD_HEADER_SIZE) {
+    memcpy(&crc, data + offset, 4);
+    record.op = data[offset + 4];
+    memcpy(&record.id, data + offset + 5, 4);
+    memcpy(&record.length, data + offset + 9, 4);
+
+    if (record.length > size - offset - AVL_WAL_RECORD_HEADER_SIZE) break;
+    if (crc != avl_wal_crc(data + offset + 4,
+                           AVL_WAL_RECORD_HEADER_SIZE - 4 + record.length)) {
+      break;
+    }
+    if (record.op != AVL_WAL_INSERT && record.op != AVL_WAL_REMOVE) break;
+
+    record.name = data + offset + AVL_WAL_RECORD_HEADER_SIZE;
+    if (records) records->push_back(record);
+    offset += AVL_WAL_RECORD_HEADER_SIZE + record.length;
+  }
+
+  return offset;
+}
+
+// Writes the whole buffer, retrying partial and interrupted writes
+static bool avl_wal_write_all(int fd, const char* data, size_t size)
+{
+  ssize_t n = 0;
+
+  while (size > 0) {
+    n = write(fd, data, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    data += n;
+    size -= n;
+  }
+
+  return true;
+}
+
+// Group write of the buffered records, fsyncing every sync_interval writes
+static int avl_wal_flush(AVLWal* wal, bool sync)
+{
+  if (wal->buffered > 0) {
+    if (!avl_wal_write_all(wal->fd, wal->buffer.data(), wal->buffer.size())) {
+      std::cerr << "Invalid file: Write-ahead log write failed" << std::endl;
+      return INVALID_FILE;
+    }
+    wal->buffer.clear();
+    wal->buffered = 0;
+    wal->unsynced++;
+  }
+
+  if (wal->unsynced > 0 &&
+      (sync || (wal->sync_interval > 0 && wal->unsynced >= wal->sync_interval))) {
+    if (fdatasync(wal->fd)) {
+      std::cerr << "Invalid file: Write-ahead log sync failed" << std::endl;
+      return INVALID_FILE;
+    }
+    wal->unsynced = 0;
+  }
+
+  return RET_OK;
+}
+
+// Appends a record to the group buffer, writing the group once full
+static int avl_wal_append(AVLWal* wal, uint8_t op, uint32_t id, const std::string& name)
+{
+  size_t offset = 0;
+  uint32_t length = name.size();
+  uint32_t crc = 0;
+
+  if (wal == NULL) {
+    std::cerr << "Invalid log: Given write-ahead log pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  offset = wal->buffer.size();
+  wal->buffer.resize(offset + AVL_WAL_RECORD_HEADER_SIZE + length);
+  char* record = wal->buffer.data() + offset;
+
+  record[4] = op;
+  memcpy(record + 5, &id, 4);
+  memcpy(record + 9, &length, 4);
+  memcpy(record + AVL_WAL_RECORD_HEADER_SIZE, name.data(), length);
+  crc = avl_wal_crc(record + 4, AVL_WAL_RECORD_HEADER_SIZE - 4 + length);
+  memcpy(record, &crc, 4);
+
+  if (++wal->buffered >= wal->group_size) return avl_wal_flush(wal, false);
+
+  return RET_OK;
+}
+
+int avl_wal_open(std::string path, AVLWal** wal, size_t group_size,
+                 size_t sync_interval)
+{
+  AVLDbFile file;
+  size_t end = 0;
+  int fd = -1;
+
+  if (*wal != NULL) {
+    std::cerr << "Invalid log: Given write-ahead log pointer is not NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (fd < 0 || avl_db_file_map(path, &file)) {
+    std::cerr << "Invalid file: Can't open write-ahead log \"" << path << "\"" << std::endl;
+    if (fd >= 0) close(fd);
+    return INVALID_FILE;
+  }
+
+  if (file.size == 0) {
+    // New log, write its header
+    if (!avl_wal_write_all(fd, AVL_WAL_MAGIC, AVL_WAL_HEADER_SIZE) || fdatasync(fd)) {
+      std::cerr << "Invalid file: Can't write write-ahead log \"" << path << "\"" << std::endl;
+      close(fd);
+      return INVALID_FILE;
+    }
+  } else {
+    if (file.size < AVL_WAL_HEADER_SIZE || memcmp(file.data, AVL_WAL_MAGIC, AVL_WAL_HEADER_SIZE)) {
+      std::cerr << "Invalid file: \"" << path << "\" is not a write-ahead log" << std::endl;
+      avl_db_file_unmap(&file);
+      close(fd);
+      return INVALID_FILE;
+    }
+
+    // Drop a torn record left by a crash, so new records stay reachable
+    end = avl_wal_scan(file.data, file.size, NULL);
+    if (end < file.size && ftruncate(fd, end)) {
+      std::cerr << "Invalid file: Can't repair write-ahead log \"" << path << "\"" << std::endl;
+      avl_db_file_unmap(&file);
+      close(fd);
+      return INVALID_FILE;
+    }
+  }
+  avl_db_file_unmap(&file);
+
+  *wal = new AVLWal;
+  (*wal)->fd = fd;
+  (*wal)->group_size = std::max<size_t>(group_size, 1);
+  (*wal)->sync_interval = sync_interval;
+
+  return RET_OK;
+}
+
+int avl_wal_close(AVLWal** wal)
+{
+  int ret = RET_OK;
+
+  if (*wal == NULL) {
+    std::cerr << "Invalid log: Given write-ahead log pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  ret = avl_wal_flush(*wal, true);
+  close((*wal)->fd);
+  delete *wal;
+  *wal = NULL;
+
+  return ret;
+}
+
+int avl_wal_sync(AVLWal* wal)
+{
+  if (wal == NULL) {
+    std::cerr << "Invalid log: Given write-ahead log pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  return avl_wal_flush(wal, true);
+}
+
+int avl_wal_truncate(AVLWal* wal)
+{
+  if (wal == NULL) {
+    std::cerr << "Invalid log: Given write-ahead log pointer is NULL" << std::endl;
+    return INVALID_TREE;
+  }
+
+  wal->buffer.clear();
+  wal->buffered = 0;
+  wal->unsynced = 0;
+
+  if (ftruncate(wal->fd, AVL_WAL_HEADER_SIZE) || fdatasync(wal->fd)) {
+    std::cerr << "Invalid file: Write-ahead log truncation failed" << std::endl;
+    return INVALID_FILE;
+  }
+
+  return RET_OK;
+}
+
+int avl_wal_insert(AVLWal* wal, AVLNode** root, uint32_t id, std::string name,
+                   AVLNodePool* pool, AVLIdBitmap* bitmap)
+{
+  int ret = avl_wal_append(wal, AVL_WAL_INSERT, id, name);
+  if (ret) return ret;
+
+  return avl_tree_insert(root, id, name, pool, bitmap);
+}
+
+int avl_wal_remove(AVLWal* wal, AVLNode** root, uint32_t id,
+                   AVLNodePool* pool, AVLIdBitmap* bitmap)
+{
+  int ret = avl_wal_append(wal, AVL_WAL_REMOVE, id, "");
+  if (ret) return ret;
+
+  return avl_tree_remove(root, id, pool, bitmap);
+}
+
+int avl_wal_replay(std::string path, AVLNode** root, AVLNodePool* pool,
+                   size_t* records)
+{
+  AVLDbFile file;
+  std::vector<AVLWalRecord> log;
+  std::vector<uint64_t> keys;
+  std::vector<uint32_t> removals;
+  std::vector<db_entry> insertions;
+  std::vector<int> results;
+  AVLNode* node = NULL;
+  const AVLWalRecord* inserted = NULL;
+  bool present = false;
+  bool found = false;
+  bool replaced = false;
+  size_t i = 0;
+  size_t j = 0;
+
+  if (avl_db_file_map(path, &file) || file.size < AVL_WAL_HEADER_SIZE
+      || memcmp(file.data, AVL_WAL_MAGIC, AVL_WAL_HEADER_SIZE)) {
+    std::cerr << "Invalid file: Can't read write-ahead log \"" << path << "\"" << std::endl;
+    avl_db_file_unmap(&file);
+    return INVALID_FILE;
+  }
+
+  avl_wal_scan(file.data, file.size, &log);
+  if (records) *records = log.size();
+
+  // Group the records by ID, keeping their log order
+  keys.reserve(log.size());
+  for (i = 0; i < log.size(); i++) {
+    if ((log[i].id < MIN_ID) || (log[i].id > MAX_ID)) continue;
+    keys.push_back(((uint64_t) log[i].id << 32) | i);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  // Reduce each ID to its final state: inserts of present keys and
+  // removals of missing ones are no-ops, as they were when logged
+  for (i = 0; i < keys.size(); i = j) {
+    uint32_t id = keys[i] >> 32;
+
+    found = false;
+    if (*root) avl_tree_search(*root, id, &node, &found);
+    present = found;
+    replaced = false;
+    inserted = NULL;
+
+    for (j = i; j < keys.size() && (keys[j] >> 32) == id; j++) {
+      const AVLWalRecord& record = log[keys[j] & 0xffffffff];
+
+      if (record.op == AVL_WAL_INSERT && !present) {
+        present = true;
+        inserted = &record;
+      } else if (record.op == AVL_WAL_REMOVE && present) {
+        present = false;
+        replaced = true;
+      }
+    }
+
+    if (found && (!present || replaced)) removals.push_back(id);
+    if (present && inserted) {
+      insertions.emplace_back(id, std::string(inserted->name, inserted->length));
+    }
+  }
+  avl_db_file_unmap(&file);
+
+  for (uint32_t id : removals) avl_tree_remove(root, id, pool);
+
+  return avl_tree_insert_batch(root, &insertions, &results, pool);
+}
@@ -0,0 +1,409 @@
+#include "include/data_structures/avl_tree.hpp"
+#include "include/data_structures/avl_db_parser.hpp"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>
+
+//! Default largest number of keys (sizes go from 10^3 up to it)
+#define BENCH_MAX_KEYS 100000
+//! Default number of timed repetitions (after one warm-up run)
+#define BENCH_REPS 5
+//! Default seed of the key generators
+#define BENCH_SEED 42
+//! Operations timed together as one latency sample
+#define BENCH_BATCH 256
+//! Largest number of operations of the O(1) / O(log n) query benchmarks
+#define BENCH_MAX_QUERIES 1000000
+//! Skew of the Zipfian generator
+#define BENCH_ZIPF_THETA 0.99
+//! Number of dense key runs of the clustered generator
+#define BENCH_CLUSTERS 16
+//! Default number of lines of the synthetic parse benchmark file (~40 MB)
+#define BENCH_PARSE_LINES 1000000
+
+//! Key distributions of the workload generators
+enum BenchGenerator {
+  BENCH_SORTED,
+  BENCH_REVERSE,
+  BENCH_UNIFORM,
+  BENCH_ZIPFIAN,
+  BENCH_CLUSTERED,
+  BENCH_GENERATORS
+};
+
+static const char* bench_generator_names[BENCH_GENERATORS] = {
+  "sorted", "reverse", "uniform", "zipfian", "clustered"
+};
+
+//! Operations timed by the microbenchmarks
+enum BenchOp {
+  BENCH_INSERT,
+  BENCH_SEARCH_HIT,
+  BENCH_SEARCH_MISS,
+  BENCH_MIN_MAX,
+  BENCH_SIZE,
+  BENCH_REMOVE,
+  BENCH_DESTROY,
+  BENCH_OPS
+};
+
+static const char* bench_op_names[BENCH_OPS] = {
+  "insert", "search hit", "search miss", "min/max", "size", "remove", "destroy"
+};
+
+/**
+ *  Workload of one generator and size: distinct keys in insertion order,
+ *  keys to look up (drawn from the inserted ones) and missing keys.
+ **/
+struct BenchWorkload {
+  std::vector<uint32_t> keys;
+  std::vector<uint32_t> hits;
+  std::vector<uint32_t> misses;
+};
+
+/* Samples ranks in [0, n) with Zipfian probabilities (rank 0 the most
+ * popular), in O(1) per sample once zeta(n) is computed (Gray et al.,
+ * "Quickly generating billion-record synthetic databases").
+ */
+struct BenchZipf {
+  double n;
+  double alpha;
+  double zetan;
+  double eta;
+  double half_pow;
+
+  BenchZipf(uint64_t count, double theta) : n((double) count)
+  {
+    double zeta2 = 1.0 + std::pow(0.5, theta);
+
+    zetan = 0;
+    for (uint64_t i = 1; i <= count; i++) zetan += 1.0 / std::pow((double) i, theta);
+
+    alpha = 1.0 / (1.0 - theta);
+    eta = (1.0 - std::pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+    half_pow = std::pow(0.5, theta);
+  }
+
+  uint64_t operator()(std::mt19937_64& rng)
+  {
+    double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+    double uz = u * zetan;
+    uint64_t rank = 0;
+
+    if (uz < 1.0) return 0;
+    if (uz < 1.0 + half_pow) return 1;
+
+    rank = (uint64_t) (n * std::pow(eta * u - eta + 1.0, alpha));
+    return std::min(rank, (uint64_t) n - 1);
+  }
+};
+
+/* Generates n distinct keys spread over MIN_ID..MAX_ID:
+ *  - sorted / reverse: evenly spaced keys in increasing / decreasing order,
+ *  - uniform: one random key per slot of the range, in random order,
+ *  - zipfian: uniform keys, looked up with Zipfian popularity,
+ *  - clustered: BENCH_CLUSTERS runs of consecutive keys, in random order.
+ * Lookups of the other generators are uniform over the inserted keys.
+ */
+static void bench_generate(BenchGenerator generator, size_t n, uint64_t seed,
+                           BenchWorkload* workload)
+{
+  std::mt19937_64 rng(seed);
+  uint64_t range = (uint64_t) MAX_ID - MIN_ID + 1;
+  uint64_t stride = range / n;
+  size_t queries = std::min(n, (size_t) BENCH_MAX_QUERIES);
+  std::vector<uint32_t> sorted;
+
+  workload->keys.resize(n);
+
+  switch (generator) {
+    case BENCH_SORTED:
+    case BENCH_REVERSE:
+      for (size_t i = 0; i < n; i++) workload->keys[i] = MIN_ID + i * stride;
+      if (generator == BENCH_REVERSE) std::reverse(workload->keys.begin(), workload->keys.end());
+      break;
+
+    case BENCH_UNIFORM:
+    case BENCH_ZIPFIAN:
+      for (size_t i = 0; i < n; i++) workload->keys[i] = MIN_ID + i * stride + rng() % stride;
+      std::shuffle(workload->keys.begin(), workload->keys.end(), rng);
+      break;
+
+    case BENCH_CLUSTERED: {
+      // Each run starts at a random offset of its own region of the range
+      uint64_t region = range / BENCH_CLUSTERS;
+      size_t run = (n + BENCH_CLUSTERS - 1) / BENCH_CLUSTERS;
+      uint64_t base = MIN_ID;
+      for (size_t i = 0; i < n; i++) {
+        if (i % run == 0) base = MIN_ID + (i / run) * region + rng() % (region - run);
+        workload->keys[i] = base + i % run;
+      }
+      std::shuffle(workload->keys.begin(), workload->keys.end(), rng);
+      break;
+    }
+
+    default:
+      break;
+  }
+
+  workload->hits.resize(queries);
+  if (generator == BENCH_ZIPFIAN) {
+    // Keys are in random order, so the popular ranks are random keys
+    BenchZipf zipf(n, BENCH_ZIPF_THETA);
+    for (size_t i = 0; i < queries; i++) workload->hits[i] = workload->keys[zipf(rng)];
+  } else {
+    for (size_t i = 0; i < queries; i++) workload->hits[i] = workload->keys[rng() % n];
+  }
+
+  sorted = workload->keys;
+  std::sort(sorted.begin(), sorted.end());
+  workload->misses.resize(queries);
+  for (size_t i = 0; i < queries; i++) {
+    uint32_t id = 0;
+    do {
+      id = MIN_ID + rng() % range;
+    } while (std::binary_search(sorted.begin(), sorted.end(), id));
+    workload->misses[i] = id;
+  }
+}
+
+//! Latency samples (ns per operation) of each operation
+typedef std::vector<double> BenchSamples[BENCH_OPS];
+
+/* Runs fn(i) for i in [0, count) in batches of BENCH_BATCH operations,
+ * recording the mean time per operation of each batch as one sample, so
+ * the clock overhead stays negligible next to the operations.
+ */
+template <typename Op>
+static void bench_time(size_t count, std::vector<double>* samples, Op fn)
+{
+  std::chrono::steady_clock::time_point start, finish;
+  size_t end = 0;
+
+  for (size_t i = 0; i < count; i = end) {
+    end = std::min(count, i + BENCH_BATCH);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t j = i; j < end; j++) fn(j);
+    finish = std::chrono::steady_clock::now();
+
+    samples->push_back(std::chrono::duration<double, std::nano>(finish - start).count()
+                       / (end - i));
+  }
+}
+
+// One run of every microbenchmark over a workload
+static void bench_run(const BenchWorkload& workload, BenchSamples* samples)
+{
+  std::chrono::steady_clock::time_point start, finish;
+  std::vector<db_entry> entries;
+  AVLNode* root = NULL;
+  AVLNode* node = NULL;
+  bool found = false;
+  int size = 0;
+  size_t n = workload.keys.size();
+
+  bench_time(n, &(*samples)[BENCH_INSERT], [&](size_t i) {
+    avl_tree_insert(&root, workload.keys[i], "");
+  });
+
+  bench_time(workload.hits.size(), &(*samples)[BENCH_SEARCH_HIT], [&](size_t i) {
+    avl_tree_search(root, workload.hits[i], &node, &found);
+  });
+
+  bench_time(workload.misses.size(), &(*samples)[BENCH_SEARCH_MISS], [&](size_t i) {
+    avl_tree_search(root, workload.misses[i], &node, &found);
+  });
+
+  bench_time(workload.hits.size(), &(*samples)[BENCH_MIN_MAX], [&](size_t i) {
+    if (i & 1) avl_tree_get_max_node(root, &node);
+    else avl_tree_get_min_node(root, &node);
+  });
+
+  bench_time(workload.hits.size(), &(*samples)[BENCH_SIZE], [&](size_t) {
+    avl_tree_get_size(root, &size);
+  });
+
+  bench_time(n, &(*samples)[BENCH_REMOVE], [&](size_t i) {
+    avl_tree_remove(&root, workload.keys[i]);
+  });
+
+  // Destroy is timed whole on a bulk loaded tree, one sample per run
+  for (uint32_t id : workload.keys) entries.emplace_back(id, "");
+  avl_tree_bulk_load(&entries, &root);
+
+  start = std::chrono::steady_clock::now();
+  avl_tree_destroy(&root);
+  finish = std::chrono::steady_clock::now();
+  (*samples)[BENCH_DESTROY].push_back(
+      std::chrono::duration<double, std::nano>(finish - start).count() / n);
+}
+
+// Value at the given quantile (0..1) of sorted samples, nearest rank
+static double bench_quantile(const std::vector<double>& sorted, double q)
+{
+  size_t rank = (size_t) std::ceil(q * sorted.size());
+
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void bench_report(BenchGenerator generator, size_t n, BenchSamples* samples)
+{
+  for (int op = 0; op < BENCH_OPS; op++) {
+    std::vector<double>& sorted = (*samples)[op];
+    std::sort(sorted.begin(), sorted.end());
+
+    std::cout << std::left << std::setw(10) << bench_generator_names[generator]
+              << std::right << std::setw(10) << n << "  "
+              << std::left << std::setw(12) << bench_op_names[op] << std::right
+              << std::fixed << std::setprecision(1)
+              << std::setw(12) << sorted.front()
+              << std::setw(12) << bench_quantile(sorted, 0.5)
+              << std::setw(12) << bench_quantile(sorted, 0.99) << std::endl;
+  }
+}
+
+// Line by line getline/stringstream/strtod parser, baseline of the parse benchmark
+static int parse_db_list_getline(std::string infile, std::vector<db_entry>* db_list)
+{
+  std::string line, col;
+  std::ifstream file(infile);
+  char* endp = NULL;
+
+  while (std::getline(file, line)) {
+    std::stringstream linestream(line);
+    std::vector<std::string> cols;
+
+    while (std::getline(linestream, col, ',')) cols.push_back(col);
+    if (cols.size() != 2) return INVALID_FILE;
+
+    db_list->push_back(std::make_pair(strtod(cols[1].c_str(), &endp), cols[0]));
+    if (endp != cols[1].c_str() + cols[1].size()) return INVALID_KEY;
+  }
+
+  return RET_OK;
+}
+
+// Counts the parsed entries, to time the parse kernel alone
+static void count_db_entry(uint32_t, const char*, size_t, void* arg)
+{
+  (*static_cast<size_t*>(arg))++;
+}
+
+// Times the parsers on a file and prints their throughput (MB/s)
+static void bench_parse(const std::string& file)
+{
+  std::vector<db_entry> db_list;
+  std::chrono::steady_clock::time_point start, finish;
+  std::chrono::microseconds time;
+  std::string error;
+  AVLDbFile mapped;
+  size_t count = 0;
+
+  if (avl_db_file_map(file, &mapped)) return;
+
+  start = std::chrono::steady_clock::now();
+  parse_db_list_getline(file, &db_list);
+  finish = std::chrono::steady_clock::now();
+  time = std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
+  std::cout << "  getline parse: " << mapped.size / (time.count() + 1.0) << " MB/s ("
+            << db_list.size() << " entries)" << std::endl;
+
+  db_list.clear();
+  start = std::chrono::steady_clock::now();
+  avl_db_parse_file(file, &db_list);
+  finish = std::chrono::steady_clock::now();
+  time = std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
+  std::cout << "  " << avl_db_parse_kernel() << " parse: " << mapped.size / (time.count() + 1.0)
+            << " MB/s (" << db_list.size() << " entries)" << std::endl;
+
+  start = std::chrono::steady_clock::now();
+  avl_db_parse(mapped.data, mapped.data + mapped.size, file, 0, &error, count_db_entry, &count);
+  finish = std::chrono::steady_clock::now();
+  time = std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
+  std::cout << "  " << avl_db_parse_kernel() << " scan only: " << mapped.size / (time.count() + 1.0)
+            << " MB/s (" << count << " entries)" << std::endl;
+
+  avl_db_file_unmap(&mapped);
+}
+
+/* Writes a synthetic input file of the given number of lines to a fresh
+ * temporary file (under $TMPDIR, or /tmp), times the parsers on it and
+ * removes it.
+ */
+static void bench_parse_synthetic(size_t lines, uint64_t seed)
+{
+  std::mt19937_64 rng(seed);
+  const char* tmpdir = getenv("TMPDIR");
+  std::string path = std::string(tmpdir ? tmpdir : "/tmp") + "/avl_tree_parse_bench.XXXXXX";
+  int fd = mkstemp(&path[0]);
+
+  if (fd < 0) {
+    std::cerr << "Invalid file: Can't create a temporary file for the parse benchmark"
+              << std::endl;
+    return;
+  }
+  close(fd);
+
+  std::ofstream synthetic_file(path);
+  for (size_t i = 0; i < lines; i++) {
+    synthetic_file << "Person " << i << " Surname Surname, "
+                   << MIN_ID + rng() % (MAX_ID - MIN_ID) << "\n";
+  }
+  synthetic_file.close();
+
+  std::cout << "Parsing " << lines << " synthetic lines" << std::endl;
+  bench_parse(path);
+  std::remove(path.c_str());
+}
+
+/**
+ *  Usage: bench [max_keys] [reps] [seed] [parse_lines]
+ *  Runs every generator at sizes 10^3, 10^4... up to max_keys (at most
+ *  10^8), one untimed warm-up run then reps timed runs each, and prints
+ *  the min / median / p99 latency of each operation in ns. Then times the
+ *  input parsers on a synthetic file of parse_lines lines (0 skips it).
+ **/
+int main(int argc, char* argv[])
+{
+  size_t max_keys = (argc > 1) ? strtoull(argv[1], NULL, 10) : BENCH_MAX_KEYS;
+  int reps = (argc > 2) ? atoi(argv[2]) : BENCH_REPS;
+  uint64_t seed = (argc > 3) ? strtoull(argv[3], NULL, 10) : BENCH_SEED;
+  size_t parse_lines = (argc > 4) ? strtoull(argv[4], NULL, 10) : BENCH_PARSE_LINES;
+  BenchWorkload workload;
+
+  max_keys = std::min(max_keys, (size_t) 100000000);
+  reps = std::max(reps, 1);
+
+  std::cout << "generator        keys  operation       min (ns)  median (ns)    p99 (ns)"
+            << std::endl;
+
+  for (size_t n = 1000; n <= max_keys; n *= 10) {
+    for (int g = 0; g < BENCH_GENERATORS; g++) {
+      BenchGenerator generator = static_cast<BenchGenerator>(g);
+      BenchSamples warmup;
+      BenchSamples samples;
+
+      bench_generate(generator, n, seed, &workload);
+
+      bench_run(workload, &warmup);
+      for (int r = 0; r < reps; r++) bench_run(workload, &samples);
+
+      bench_report(generator, n, &samples);
+    }
+  }
+
+  if (parse_lines > 0) bench_parse_synthetic(parse_lines, seed);
+
+  return 0;
+}
@@ -1,14 +1,120 @@
 #include "include/data_structures/avl_tree.hpp"
+#include "include/data_structures/avl_frozen_tree.hpp"
+#include "include/data_structures/avl_kary_index.hpp"
+#include "include/data_structures/avl_snapshot.hpp"
+#include "include/data_structures/avl_concurrent_tree.hpp"
+#include "include/data_structures/avl_optimistic_tree.hpp"
+#include "include/data_structures/avl_sharded_tree.hpp"
+#include "include/data_structures/avl_persistent_tree.hpp"
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+//! Containers of the multi-writer benchmark
+enum BenchWriters {
+  BENCH_OPTIMISTIC,
+  BENCH_SHARDED,
+  BENCH_GLOBAL_LOCK
+};
+
+/* Write-heavy throughput with num_threads threads, each one toggling its
+ * own interleaved keys (insert if absent, remove if present), spread over
+ * the whole ID range, and searching them back. Runs on the optimistic
+ * tree, on the sharded tree, or on an AVL Tree behind one global mutex as
+ * the baseline. Returns millions of operations per second.
+ */
+static double bench_writers(int num_threads, BenchWriters container)
+{
+  const int num_ops = 1 << 18;
+  const uint32_t num_keys = 1 << 16;
+  // Slots t + k * num_threads stay below num_keys + num_threads
+  const uint32_t stride = (MAX_ID - MIN_ID) / (num_keys + num_threads);
+  const uint32_t max_slot = num_threads - 1 + (num_keys / num_threads) * num_threads;
+  AVLOptimisticTree* tree = NULL;
+  AVLShardedTree* sharded = NULL;
+  AVLNode* locked_tree = NULL;
+  std::mutex tree_lock;
+  std::vector<std::thread> threads;
+  std::chrono::steady_clock::time_point start, finish;
+
+  // Only valid operations are timed, the largest generated id is in range
+  if (MIN_ID + (uint64_t) max_slot * stride > MAX_ID) {
+    std::cerr << "Invalid key (" << MIN_ID + (uint64_t) max_slot * stride
+              << "): Value out of range" << std::endl;
+    return 0;
+  }
+
+  avl_optimistic_tree_create(&tree);
+  avl_sharded_tree_create(&sharded);
+
+  start = std::chrono::steady_clock::now();
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t]() {
+      std::vector<bool> present(num_keys / num_threads + 1, false);
+      AVLNode* node = NULL;
+      bool found = false;
+      unsigned int seed = t;
+
+      for (int i = 0; i < num_ops / num_threads; i++) {
+        uint32_t k = rand_r(&seed) % present.size();
+        uint32_t id = MIN_ID + (t + k * num_threads) * stride;
+
+        if (container == BENCH_OPTIMISTIC) {
+          if (present[k]) avl_optimistic_tree_remove(tree, id);
+          else avl_optimistic_tree_insert(tree, id, "Name");
+          avl_optimistic_tree_search(tree, id, NULL, &found);
+        } else if (container == BENCH_SHARDED) {
+          if (present[k]) avl_sharded_tree_remove(sharded, id);
+          else avl_sharded_tree_insert(sharded, id, "Name");
+          avl_sharded_tree_search(sharded, id, NULL, &found);
+        } else {
+          std::lock_guard<std::mutex> lock(tree_lock);
+          if (present[k]) avl_tree_remove(&locked_tree, id);
+          else avl_tree_insert(&locked_tree, id, "Name");
+          avl_tree_search(locked_tree, id, &node, &found);
+        }
+        present[k] = found;
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  finish = std::chrono::steady_clock::now();
+
+  avl_optimistic_tree_destroy(&tree);
+  avl_sharded_tree_destroy(&sharded);
+  avl_tree_destroy(&locked_tree);
+
+  return 2.0 * num_ops /
+         std::chrono::duration_cast<std::chrono::microseconds>(finish - start).count();
+}
 
 int main(void) {
   int ret = 0;
   int size = 0;
   int max_height = 0;
   AVLNode* avl_tree = NULL;
+  AVLNode* avl_node = NULL;
+  AVLNode* parallel_tree = NULL;
+  AVLFrozenTree* frozen = NULL;
+  AVLKaryIndex* kary_index = NULL;
+  AVLSnapshot* snapshot = NULL;
+  const char* tmpdir = getenv("TMPDIR");
+  std::string snapshot_path;
+  int snapshot_fd = -1;
+  AVLConcurrentTree* concurrent = NULL;
+  AVLPersistentTree* persistent = NULL;
+  AVLPersistentNode* version = NULL;
+  uint32_t slot = 0;
+  bool found = false;
+  int hits = 0;
+  std::vector<uint32_t> ids;
+  std::vector<AVLNode*> results;
 
   // Vector of input files
   std::vector<std::string> files = {
@@ -46,8 +152,132 @@ int main(void) {
       // Print AVL Tree information to standard output
       std::cout << "AVL Tree creation time (us): " << time.count() << std::endl;
       std::cout << "AVL Tree size: " << size << std::endl;
-      std::cout << "AVL Tree max height: " << max_height
-                << std::endl << std::endl;
+      std::cout << "AVL Tree max height: " << max_height << std::endl;
+
+      // Same file through the multi-threaded loader
+      start = std::chrono::steady_clock::now();
+      avl_tree_create_parallel(file, &parallel_tree);
+      finish = std::chrono::steady_clock::now();
+      time = std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
+      std::cout << "AVL Tree parallel creation time (us): " << time.count() << std::endl;
+      avl_tree_destroy(&parallel_tree);
+
+      // Time lookups over the loaded ID range (hits and misses), on the
+      // tree and on its frozen snapshot
+      hits = 0;
+      start = std::chrono::steady_clock::now();
+      for (uint32_t id = MIN_ID; id < MIN_ID + 2 * (uint32_t) size; id++) {
+        avl_tree_search(avl_tree, id, &avl_node, &found);
+        hits += found;
+      }
+      finish = std::chrono::steady_clock::now();
+      time = std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
+      std::cout << "AVL Tree search time (us): " << time.count()
+                << " (" << hits << " hits)" << std::endl;
+
+      // Same lookups, resolved as one interleaved batch
+      ids.clear();
+      for (uint32_t id = MIN_ID; id < MIN_ID + 2 * (uint32_t) size; id++) ids.push_back(id);
+      results.resize(ids.size());
+
+      hits = 0;
+      start = std::chrono::steady_clock::now();
+      avl_tree_search_batch(avl_tree, ids.data(), ids.size(), results.data());
+      for (AVLNode* result : results) hits += (result != NULL);
+      finish = std::chrono::steady_clock::now();
+      time = std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
+      std::cout << "AVL Tree batch search time (us): " << time.count()
+                << " (" << hits << " hits)" << std::endl;
+
+      avl_tree_freeze(avl_tree, &frozen);
+
+      hits = 0;
+      start = std::chrono::steady_clock::now();
+      for (uint32_t id = MIN_ID; id < MIN_ID + 2 * (uint32_t) size; id++) {
+        avl_frozen_tree_search(frozen, id, &slot, &found);
+        hits += found;
+      }
+      finish = std::chrono::steady_clock::now();
+      time = std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
+      std::cout << "Frozen tree search time (us): " << time.count()
+                << " (" << hits << " hits)" << std::endl;
+
+      avl_frozen_tree_destroy(&frozen);
+      avl_kary_index_create(avl_tree, &kary_index);
+
+      hits = 0;
+      start = std::chrono::steady_clock::now();
+      for (uint32_t id = MIN_ID; id < MIN_ID + 2 * (uint32_t) size; id++) {
+        avl_kary_index_search(kary_index, id, &slot, &found);
+        hits += found;
+      }
+      finish = std::chrono::steady_clock::now();
+      time = std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
+      std::cout << "K-ary index (" << avl_kary_index_kernel() << ") search time (us): "
+                << time.count() << " (" << hits << " hits)" << std::endl;
+
+      avl_kary_index_destroy(&kary_index);
+
+      // Same lookups through the epoch-protected reader path
+      avl_concurrent_tree_create(&concurrent);
+      avl_tree_get_page(avl_tree, 0, size, &results);
+      for (AVLNode* result : results) {
+        avl_concurrent_tree_insert(concurrent, result->id, result->name);
+      }
+
+      hits = 0;
+      start = std::chrono::steady_clock::now();
+      for (uint32_t id = MIN_ID; id < MIN_ID + 2 * (uint32_t) size; id++) {
+        avl_concurrent_tree_search(concurrent, id, NULL, &found);
+        hits += found;
+      }
+      finish = std::chrono::steady_clock::now();
+      time = std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
+      std::cout << "Concurrent tree search time (us): " << time.count()
+                << " (" << hits << " hits)" << std::endl;
+
+      avl_concurrent_tree_destroy(&concurrent);
+
+      // Point-in-time snapshots of a persistent tree, each one followed by
+      // an update that only copies its path
+      avl_persistent_tree_create(&persistent);
+      for (AVLNode* result : results) {
+        avl_persistent_tree_insert(persistent, result->id, result->name);
+      }
+
+      start = std::chrono::steady_clock::now();
+      for (AVLNode* result : results) {
+        avl_persistent_tree_snapshot(persistent, &version);
+        avl_persistent_tree_remove(persistent, result->id);
+        avl_persistent_version_release(&version);
+      }
+      finish = std::chrono::steady_clock::now();
+      time = std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
+      std::cout << "Persistent tree snapshot and remove time (us): " << time.count() << std::endl;
+
+      avl_persistent_tree_destroy(&persistent);
+
+      // Restart path: open a snapshot saved to a fresh temporary file and
+      // search it in place
+      snapshot_path = std::string(tmpdir ? tmpdir : "/tmp") + "/avl_tree_main.snapshot.XXXXXX";
+      snapshot_fd = mkstemp(&snapshot_path[0]);
+      if (snapshot_fd >= 0) close(snapshot_fd);
+      avl_tree_save(avl_tree, snapshot_path);
+
+      hits = 0;
+      start = std::chrono::steady_clock::now();
+      avl_tree_open_snapshot(snapshot_path, &snapshot);
+      for (uint32_t id = MIN_ID; id < MIN_ID + 2 * (uint32_t) size; id++) {
+        avl_snapshot_search(snapshot, id, &slot, &found);
+        hits += found;
+      }
+      finish = std::chrono::steady_clock::now();
+      time = std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
+      std::cout << "Snapshot open and search time (us): " << time.count()
+                << " (" << hits << " hits)" << std::endl << std::endl;
+
+      avl_snapshot_close(&snapshot);
+      std::remove(snapshot_path.c_str());
     } else {
       std::cout << "AVL Tree creation failed with return code " << ret
                 << std::endl << std::endl;
@@ -58,5 +288,15 @@ int main(void) {
 
   if (running_times_file.is_open()) running_times_file.close();
 
+  // Multi-writer scaling, optimistic and sharded trees against a single global lock
+  std::cout << "--------------------------------------------------" << std::endl;
+  for (int num_threads = 1; num_threads <= 64; num_threads *= 2) {
+    std::cout << "Writers: " << num_threads
+              << " optimistic tree (Mops/s): " << bench_writers(num_threads, BENCH_OPTIMISTIC)
+              << " sharded tree (Mops/s): " << bench_writers(num_threads, BENCH_SHARDED)
+              << " global lock (Mops/s): " << bench_writers(num_threads, BENCH_GLOBAL_LOCK)
+              << std::endl;
+  }
+
   return 0;
 }
@@ -1,12 +1,30 @@
 #include <gtest/gtest.h>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <iterator>
 #include <cstdlib>
+#include <cmath>
+#include <cstdio>
 #include <fstream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
 #include <chrono>
 #include <sys/time.h>
 
 #include "include/data_structures/avl_tree.hpp"
+#include "include/data_structures/avl_db_parser.hpp"
+#include "include/data_structures/avl_compact_tree.hpp"
+#include "include/data_structures/avl_concurrent_tree.hpp"
+#include "include/data_structures/avl_optimistic_tree.hpp"
+#include "include/data_structures/avl_sharded_tree.hpp"
+#include "include/data_structures/avl_persistent_tree.hpp"
+#include "include/data_structures/avl_frozen_tree.hpp"
+#include "include/data_structures/avl_kary_index.hpp"
+#include "include/data_structures/avl_snapshot.hpp"
+#include "include/data_structures/avl_wal.hpp"
 
 /**
  * Utilitary function to recursively calculate tree max height
@@ -45,6 +63,8 @@ static void validate_avl_tree(AVLNode* root) {
   }
 
   ASSERT_LT(std::abs(rheight-lheight), 2);
+  ASSERT_EQ(root->size, 1 + (root->lchild ? root->lchild->size : 0)
+                           + (root->rchild ? root->rchild->size : 0));
 }
 
 // Test AVL tree create from file and destroy operations
@@ -68,6 +88,472 @@ TEST(AVLTreeTest, CreateDestroy) {
   ASSERT_EQ(ret, INVALID_TREE);
 }
 
+/**
+ * Checks that both trees hold the same (id, name) entries.
+ **/
+static void compare_avl_trees(AVLNode* expected, AVLNode* actual) {
+  AVLNode* node = NULL;
+  bool found = false;
+  int exp_size = 0;
+  int size = 0;
+
+  avl_tree_get_size(expected, &exp_size);
+  avl_tree_get_size(actual, &size);
+  ASSERT_EQ(size, exp_size);
+
+  std::vector<AVLNode*> pending = {expected};
+  while (!pending.empty()) {
+    AVLNode* it = pending.back();
+    pending.pop_back();
+
+    avl_tree_search(actual, it->id, &node, &found);
+    ASSERT_TRUE(found);
+    ASSERT_EQ(node->name, it->name);
+
+    if (it->lchild) pending.push_back(it->lchild);
+    if (it->rchild) pending.push_back(it->rchild);
+  }
+}
+
+// Test bulk-loaded AVL Trees against trees created by repeated insertions
+TEST(AVLTreeTest, CreateBulk) {
+  int ret = 0;
+  int size = 0;
+  AVLNode* avl_tree = NULL;
+  AVLNode* bulk_tree = NULL;
+
+  for (std::string file : {"misc/input/lista_100.txt", "misc/input/lista_10000.txt"}) {
+    ret = avl_tree_create(file, &avl_tree);
+    ASSERT_EQ(ret, RET_OK);
+
+    ret = avl_tree_create_bulk(file, &bulk_tree);
+    ASSERT_EQ(ret, RET_OK);
+
+    validate_avl_tree(bulk_tree);
+    compare_avl_trees(avl_tree, bulk_tree);
+
+    avl_tree_destroy(&avl_tree);
+    avl_tree_destroy(&bulk_tree);
+  }
+
+  // Out of range and duplicated keys are dropped, the first entry wins
+  std::vector<db_entry> db_entries = {
+    {897651234, "Gary Oak"},
+    {500, "Babidi"},
+    {121212121, "Ash Ketchum"},
+    {897651234, "Gohan"},
+    {1100000000, "Majin Boo"},
+    {100789765, "Richard Stallman"}
+  };
+
+  ret = avl_tree_bulk_load(&db_entries, &bulk_tree);
+  ASSERT_EQ(ret, RET_OK);
+  validate_avl_tree(bulk_tree);
+
+  avl_tree_get_size(bulk_tree, &size);
+  ASSERT_EQ(size, 3);
+  ASSERT_EQ(bulk_tree->id, (uint32_t) 121212121);
+  ASSERT_EQ(bulk_tree->rchild->name, "Gary Oak");
+  ASSERT_EQ(bulk_tree->lheight, 1);
+  ASSERT_EQ(bulk_tree->rheight, 1);
+
+  ret = avl_tree_bulk_load(&db_entries, &bulk_tree);
+  ASSERT_EQ(ret, INVALID_TREE);
+
+  avl_tree_destroy(&bulk_tree);
+}
+
+/**
+ * Temporary file of the running test, created with mkstemp under the
+ * Google Test temporary directory and removed when it goes out of scope.
+ **/
+struct TempFile {
+  std::string path;
+
+  TempFile() {
+    int fd = -1;
+
+    path = ::testing::TempDir() + "avl_tree_"
+         + ::testing::UnitTest::GetInstance()->current_test_info()->name()
+         + ".XXXXXX";
+    fd = mkstemp(&path[0]);
+    if (fd >= 0) close(fd);
+  }
+
+  ~TempFile() { std::remove(path.c_str()); }
+};
+
+// Test parallel-loaded AVL Trees against the serial loader
+TEST(AVLTreeTest, CreateParallel) {
+  int ret = 0;
+  AVLNode* avl_tree = NULL;
+  AVLNode* parallel_tree = NULL;
+  AVLNodePool* pool = NULL;
+  TempFile temp;
+  std::string file = temp.path;
+  std::ofstream out;
+
+  // Random entries with duplicates, out of range IDs and no final newline
+  out.open(file);
+  for (int i = 0; i < 19999; i++) {
+    out << "Person " << i << ", "
+        << ((i % 97 == 0) ? MAX_ID + i : MIN_ID + rand() % 30000) << "\n";
+  }
+  out << "Person 19999, " << MIN_ID + 30000;
+  out.close();
+
+  ret = avl_tree_create(file, &avl_tree);
+  ASSERT_EQ(ret, RET_OK);
+
+  avl_node_pool_create(&pool);
+  for (unsigned int num_threads : {1, 2, 3, 8}) {
+    ret = avl_tree_create_parallel(file, &parallel_tree, num_threads);
+    ASSERT_EQ(ret, RET_OK);
+    validate_avl_tree(parallel_tree);
+    compare_avl_trees(avl_tree, parallel_tree);
+    avl_tree_destroy(&parallel_tree);
+
+    ret = avl_tree_create_parallel(file, &parallel_tree, num_threads, pool);
+    ASSERT_EQ(ret, RET_OK);
+    compare_avl_trees(avl_tree, parallel_tree);
+    avl_tree_destroy(&parallel_tree, pool);
+  }
+  avl_node_pool_destroy(&pool);
+  avl_tree_destroy(&avl_tree);
+
+  // Parse errors are reported the same way as the serial loader
+  out.open(file);
+  for (int i = 0; i < 1000; i++) out << "Person " << i << ", " << MIN_ID + i << "\n";
+  out << "Person, 12x45\n";
+  out.close();
+
+  ret = avl_tree_create_parallel(file, &parallel_tree, 4);
+  ASSERT_EQ(ret, INVALID_KEY);
+  ASSERT_TRUE(parallel_tree == NULL);
+}
+
+// Test input file parsing, valid lines and reported errors
+TEST(AVLTreeTest, ParseInputFile) {
+  int ret = 0;
+  int size = 0;
+  AVLNode* avl_tree = NULL;
+  AVLNode* avl_node = NULL;
+  bool found = false;
+  TempFile temp;
+  std::string file = temp.path;
+  std::ofstream out;
+
+  std::vector<std::pair<std::string, int>> cases = {
+    {"", RET_OK},
+    {"Ash Ketchum, 121212121\nGary Oak,897651234\nJack Jack, \t112345678", RET_OK},
+    {"Ash Ketchum, 121212121\nGary Oak, 8976x1234\n", INVALID_KEY},
+    {"Ash Ketchum, 121212121\nGary Oak, \n", INVALID_KEY},
+    {"Ash Ketchum, 121212121, 1\n", INVALID_FILE},
+    {"Ash Ketchum 121212121\n", INVALID_FILE},
+    {"Ash Ketchum, 121212121\n\n", INVALID_FILE}
+  };
+
+  for (auto& test_case : cases) {
+    out.open(file);
+    out << test_case.first;
+    out.close();
+
+    ret = avl_tree_create(file, &avl_tree);
+    ASSERT_EQ(ret, test_case.second);
+    if (avl_tree) avl_tree_destroy(&avl_tree);
+  }
+
+  // Names are kept up to the comma, blanks before the id are skipped
+  out.open(file);
+  out << cases[1].first;
+  out.close();
+
+  ret = avl_tree_create(file, &avl_tree);
+  ASSERT_EQ(ret, RET_OK);
+  avl_tree_get_size(avl_tree, &size);
+  ASSERT_EQ(size, 3);
+
+  avl_tree_search(avl_tree, 112345678, &avl_node, &found);
+  ASSERT_TRUE(found);
+  ASSERT_EQ(avl_node->name, "Jack Jack");
+  avl_tree_search(avl_tree, 897651234, &avl_node, &found);
+  ASSERT_TRUE(found);
+  ASSERT_EQ(avl_node->name, "Gary Oak");
+
+  avl_tree_destroy(&avl_tree);
+
+  // Lines of random lengths, crossing the parser scan blocks anywhere
+  std::vector<db_entry> expected;
+  std::vector<db_entry> parsed;
+
+  out.open(file);
+  for (int i = 0; i < 2000; i++) {
+    uint32_t id = (i % 13 == 0) ? MAX_ID + rand() % 1000 : MIN_ID + rand() % (MAX_ID - MIN_ID);
+    std::string name(1 + rand() % 150, 'a' + i % 26);
+
+    expected.emplace_back(id, name);
+    out << name << "," << std::string(rand() % 3, ' ') << id << "\n";
+  }
+  out.close();
+
+  ret = avl_db_parse_file(file, &parsed);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(parsed, expected);
+
+  // Inputs that can't be mapped (a pipe) are read by every file loader
+  AVLNode* expected_tree = NULL;
+  std::string source = "misc/input/lista_1000.txt";
+  std::ifstream in(source);
+  std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+  ret = avl_tree_create(source, &expected_tree);
+  ASSERT_EQ(ret, RET_OK);
+
+  for (int loader = 0; loader < 3; loader++) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    std::thread writer([&]() {
+      ASSERT_EQ(write(fds[1], contents.data(), contents.size()), (ssize_t) contents.size());
+      close(fds[1]);
+    });
+
+    std::string pipe_path = "/dev/fd/" + std::to_string(fds[0]);
+    if (loader == 0) ret = avl_tree_create(pipe_path, &avl_tree);
+    if (loader == 1) ret = avl_tree_create_bulk(pipe_path, &avl_tree);
+    if (loader == 2) ret = avl_tree_create_parallel(pipe_path, &avl_tree, 2);
+    writer.join();
+    close(fds[0]);
+
+    ASSERT_EQ(ret, RET_OK);
+    ASSERT_NE(avl_tree, nullptr);
+    validate_avl_tree(avl_tree);
+    compare_avl_trees(expected_tree, avl_tree);
+    avl_tree_destroy(&avl_tree);
+  }
+
+  avl_tree_destroy(&expected_tree);
+}
+
+// Test streaming loads from streams and file descriptors against avl_tree_create
+TEST(AVLTreeTest, CreateStream) {
+  int ret = 0;
+  int fds[2];
+  AVLNode* avl_tree = NULL;
+  AVLNode* stream_tree = NULL;
+  std::string file = "misc/input/lista_10000.txt";
+  std::ifstream in;
+  std::stringstream lines;
+
+  ret = avl_tree_create(file, &avl_tree);
+  ASSERT_EQ(ret, RET_OK);
+
+  // A small budget forces many partial lines and batch insertions
+  for (size_t budget : {(size_t) 1024, (size_t) 64 << 10, (size_t) AVL_STREAM_MEMORY_BUDGET}) {
+    in.open(file);
+    ret = avl_tree_create_stream(&in, &stream_tree, budget);
+    in.close();
+    ASSERT_EQ(ret, RET_OK);
+    validate_avl_tree(stream_tree);
+    compare_avl_trees(avl_tree, stream_tree);
+    avl_tree_destroy(&stream_tree);
+  }
+
+  // Same load through a pipe, written by another thread
+  ASSERT_EQ(pipe(fds), 0);
+  std::thread writer([&]() {
+    std::ifstream source(file);
+    std::string contents((std::istreambuf_iterator<char>(source)),
+                         std::istreambuf_iterator<char>());
+    ASSERT_EQ(write(fds[1], contents.data(), contents.size()), (ssize_t) contents.size());
+    close(fds[1]);
+  });
+  ret = avl_tree_create_fd(fds[0], &stream_tree, 1 << 14);
+  writer.join();
+  close(fds[0]);
+  ASSERT_EQ(ret, RET_OK);
+  compare_avl_trees(avl_tree, stream_tree);
+  avl_tree_destroy(&stream_tree);
+  avl_tree_destroy(&avl_tree);
+
+  // Lines longer than the read buffer, and no final newline
+  lines << std::string(10000, 'a') << ", " << MIN_ID << "\n"
+        << std::string(20000, 'b') << ", " << MAX_ID;
+  ret = avl_tree_create_stream(&lines, &stream_tree, 1024);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(stream_tree->size, 2);
+  avl_tree_destroy(&stream_tree);
+
+  // Parse errors after some batches were inserted leave no tree
+  lines.str("");
+  lines.clear();
+  for (int i = 0; i < 1000; i++) lines << "Person " << i << ", " << MIN_ID + i << "\n";
+  lines << "Person, 12x45\n";
+  ret = avl_tree_create_stream(&lines, &stream_tree, 1024);
+  ASSERT_EQ(ret, INVALID_KEY);
+  ASSERT_TRUE(stream_tree == NULL);
+}
+
+// Test saving AVL Trees as snapshots, querying them and loading them back
+TEST(AVLTreeTest, Snapshot) {
+  int ret = 0;
+  AVLNode* avl_tree = NULL;
+  AVLNode* loaded_tree = NULL;
+  AVLNode* avl_node = NULL;
+  AVLSnapshot* snapshot = NULL;
+  TempFile temp;
+  std::string path = temp.path;
+  std::string name;
+  uint32_t rank = 0;
+  int exp_rank = 0;
+  bool found = false;
+  bool exp_found = false;
+
+  ret = avl_tree_create("misc/input/lista_10000.txt", &avl_tree);
+  ASSERT_EQ(ret, RET_OK);
+
+  ret = avl_tree_save(NULL, path);
+  ASSERT_EQ(ret, INVALID_TREE);
+
+  for (bool layout : {true, false}) {
+    ret = avl_tree_save(avl_tree, path, layout);
+    ASSERT_EQ(ret, RET_OK);
+
+    ret = avl_tree_open_snapshot(path, &snapshot);
+    ASSERT_EQ(ret, RET_OK);
+    ASSERT_EQ(snapshot->size, (uint64_t) avl_tree->size);
+    ASSERT_EQ(snapshot->layout_keys != NULL, layout);
+
+    // Hits return the stored names, ranks match the tree order statistics
+    for (uint32_t id = MIN_ID; id < MIN_ID + 20000; id++) {
+      avl_tree_search(avl_tree, id, &avl_node, &exp_found);
+      ASSERT_EQ(avl_snapshot_search(snapshot, id, &rank, &found), RET_OK);
+      ASSERT_EQ(found, exp_found);
+
+      if (found) {
+        avl_snapshot_get_name(snapshot, rank, &name);
+        ASSERT_EQ(name, avl_node->name);
+        avl_tree_get_rank(avl_tree, id, &exp_rank);
+        ASSERT_EQ((int) rank, exp_rank);
+      }
+    }
+    avl_snapshot_search(snapshot, MAX_ID + 1, &rank, &found);
+    ASSERT_FALSE(found);
+    ASSERT_EQ(rank, (uint32_t) snapshot->size);
+    ASSERT_EQ(avl_snapshot_get_name(snapshot, rank, &name), INVALID_INDEX);
+
+    ret = avl_snapshot_to_tree(snapshot, &loaded_tree);
+    ASSERT_EQ(ret, RET_OK);
+    validate_avl_tree(loaded_tree);
+    compare_avl_trees(avl_tree, loaded_tree);
+    avl_tree_destroy(&loaded_tree);
+
+    ret = avl_snapshot_close(&snapshot);
+    ASSERT_EQ(ret, RET_OK);
+    ASSERT_TRUE(snapshot == NULL);
+  }
+
+  // Corrupt and truncated files are rejected
+  std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+  file.seekp(sizeof(AVLSnapshotHeader) + 100);
+  file.put('x');
+  file.close();
+  ASSERT_EQ(avl_tree_open_snapshot(path, &snapshot), INVALID_FILE);
+  ASSERT_EQ(avl_tree_open_snapshot(path, &snapshot, false), RET_OK);
+  avl_snapshot_close(&snapshot);
+
+  // Name offsets past the names blob are rejected even without the checksum
+  uint64_t bad_offset = UINT64_MAX;
+  file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+  file.seekp(sizeof(AVLSnapshotHeader) + ((avl_tree->size * sizeof(uint32_t) + 7) & ~7)
+             + sizeof(uint64_t));
+  file.write(reinterpret_cast<const char*>(&bad_offset), sizeof(bad_offset));
+  file.close();
+  ASSERT_EQ(avl_tree_open_snapshot(path, &snapshot, false), INVALID_FILE);
+  ASSERT_TRUE(snapshot == NULL);
+
+  ASSERT_EQ(truncate(path.c_str(), 1000), 0);
+  ASSERT_EQ(avl_tree_open_snapshot(path, &snapshot), INVALID_FILE);
+  ASSERT_EQ(avl_tree_open_snapshot(path + ".missing", &snapshot), INVALID_FILE);
+  ASSERT_TRUE(snapshot == NULL);
+
+  avl_tree_destroy(&avl_tree);
+}
+
+// Test logging mutations and recovering them onto a base tree
+TEST(AVLTreeTest, WriteAheadLog) {
+  int ret = 0;
+  AVLNode* live_tree = NULL;
+  AVLNode* recovered_tree = NULL;
+  AVLWal* wal = NULL;
+  std::string file = "misc/input/lista_1000.txt";
+  TempFile temp;
+  std::string path = temp.path;
+  size_t records = 0;
+  std::ofstream out;
+
+  avl_tree_create(file, &live_tree);
+
+  // Random mutations on live and base ids, including no-op ones and
+  // removals followed by re-insertions with another name
+  ret = avl_wal_open(path, &wal, 16, 4);
+  ASSERT_EQ(ret, RET_OK);
+  for (int i = 0; i < 5000; i++) {
+    uint32_t id = MIN_ID + rand() % 3000;
+    if (rand() % 3) {
+      avl_wal_insert(wal, &live_tree, id, "Person " + std::to_string(i));
+    } else {
+      avl_wal_remove(wal, &live_tree, id);
+    }
+  }
+  avl_wal_insert(wal, &live_tree, MAX_ID + 1, "Out of range");
+  ret = avl_wal_close(&wal);
+  ASSERT_EQ(ret, RET_OK);
+
+  avl_tree_create(file, &recovered_tree);
+  ret = avl_wal_replay(path, &recovered_tree, NULL, &records);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(records, (size_t) 5001);
+  validate_avl_tree(recovered_tree);
+  compare_avl_trees(live_tree, recovered_tree);
+  avl_tree_destroy(&recovered_tree);
+
+  // A torn record at the end is ignored, then truncated when reopening
+  out.open(path, std::ios::app | std::ios::binary);
+  out << "torn";
+  out.close();
+
+  ret = avl_wal_open(path, &wal, 1, 0);
+  ASSERT_EQ(ret, RET_OK);
+  avl_wal_insert(wal, &live_tree, MIN_ID + 5000, "After the crash");
+  avl_wal_remove(wal, &live_tree, live_tree->id);
+  avl_wal_close(&wal);
+
+  avl_tree_create(file, &recovered_tree);
+  ret = avl_wal_replay(path, &recovered_tree, NULL, &records);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(records, (size_t) 5003);
+  compare_avl_trees(live_tree, recovered_tree);
+  avl_tree_destroy(&recovered_tree);
+
+  // Once truncated, the log only holds the mutations logged afterwards
+  ret = avl_wal_open(path, &wal);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(avl_wal_truncate(wal), RET_OK);
+  avl_wal_insert(wal, &recovered_tree, MIN_ID, "Only entry");
+  avl_wal_close(&wal);
+  avl_tree_destroy(&recovered_tree);
+
+  ret = avl_wal_replay(path, &recovered_tree, NULL, &records);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(records, (size_t) 1);
+  ASSERT_EQ(recovered_tree->size, 1);
+
+  ASSERT_EQ(avl_wal_replay(file, &recovered_tree), INVALID_FILE);
+
+  avl_tree_destroy(&recovered_tree);
+  avl_tree_destroy(&live_tree);
+}
+
 // Test valid and invalid AVL Tree predefined insertions
 TEST(AVLTreeTest, InsertNodesBasic) {
   int ret = 0;
@@ -148,6 +634,1251 @@ TEST(AVLTreeTest, InsertNodesValidate) {
   ASSERT_EQ(size, exp_size);
 }
 
+// Test random node removals, validating the AVL Tree after each removal
+TEST(AVLTreeTest, RemoveNodesValidate) {
+  int ret = 0;
+  int size = 0;
+  bool found = false;
+
+  AVLNode* avl_tree = NULL;
+  AVLNode* avl_node = NULL;
+  std::vector<uint32_t> ids;
+  const int num_inserts = 1000;
+
+  for (int i = 0; i < num_inserts; i++) {
+    uint32_t id = MIN_ID + rand() % (MAX_ID-MIN_ID);
+    if (avl_tree_insert(&avl_tree, id, "") == RET_OK) ids.push_back(id);
+  }
+
+  ret = avl_tree_remove(&avl_tree, MIN_ID - 1);
+  ASSERT_EQ(ret, KEY_NOT_FOUND);
+
+  // Remove half the keys in random order, then the rest from the root
+  std::random_shuffle(ids.begin(), ids.end());
+  for (size_t i = 0; i < ids.size(); i++) {
+    uint32_t id = (i < ids.size() / 2) ? ids[i] : avl_tree->id;
+
+    ret = avl_tree_remove(&avl_tree, id);
+    ASSERT_EQ(ret, RET_OK);
+
+    if (avl_tree) {
+      avl_tree_search(avl_tree, id, &avl_node, &found);
+      ASSERT_FALSE(found);
+
+      validate_avl_tree(avl_tree);
+      avl_tree_get_size(avl_tree, &size);
+      ASSERT_EQ((size_t) size, ids.size() - i - 1);
+    }
+  }
+
+  ASSERT_EQ(avl_tree, nullptr);
+}
+
+// Test batched searches against single searches, for several batch widths
+TEST(AVLTreeTest, SearchBatch) {
+  int ret = 0;
+  bool found = false;
+
+  AVLNode* avl_tree = NULL;
+  AVLNode* avl_node = NULL;
+  std::vector<uint32_t> ids;
+  std::vector<AVLNode*> results;
+
+  ret = avl_tree_create("misc/input/lista_1000.txt", &avl_tree);
+  ASSERT_EQ(ret, RET_OK);
+
+  for (int i = 0; i < 5000; i++) ids.push_back(MIN_ID + rand() % 2000);
+  results.resize(ids.size());
+
+  for (size_t inflight : {1, 4, 16, 1000}) {
+    ret = avl_tree_search_batch(avl_tree, ids.data(), ids.size(),
+                                results.data(), inflight);
+    ASSERT_EQ(ret, RET_OK);
+
+    for (size_t i = 0; i < ids.size(); i++) {
+      avl_tree_search(avl_tree, ids[i], &avl_node, &found);
+      ASSERT_EQ(results[i], found ? avl_node : nullptr);
+    }
+  }
+
+  ret = avl_tree_search_batch(NULL, ids.data(), ids.size(), results.data());
+  ASSERT_EQ(ret, INVALID_TREE);
+
+  avl_tree_destroy(&avl_tree);
+}
+
+// Test batched insertions against repeated single insertions
+TEST(AVLTreeTest, InsertBatch) {
+  int ret = 0;
+  AVLNode* avl_tree = NULL;
+  AVLNode* batch_tree = NULL;
+  std::vector<db_entry> db_entries;
+  std::vector<int> results;
+
+  for (int i = 0; i < 2000; i++) {
+    uint32_t id = MIN_ID + rand() % 100000;
+    avl_tree_insert(&avl_tree, id, std::to_string(id));
+    avl_tree_insert(&batch_tree, id, std::to_string(id));
+  }
+
+  // Batch mixing new keys, existing keys, repeated keys and invalid keys
+  for (int i = 0; i < 5000; i++) {
+    uint32_t id = MIN_ID + rand() % 200000;
+    db_entries.push_back(std::make_pair(id, "batch " + std::to_string(i)));
+  }
+  db_entries.push_back(std::make_pair(500, "Babidi"));
+  db_entries.push_back(std::make_pair(1100000000, "Majin Boo"));
+
+  std::vector<db_entry> batch = db_entries;
+  ret = avl_tree_insert_batch(&batch_tree, &batch, &results);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(results.size(), db_entries.size());
+
+  for (size_t i = 0; i < db_entries.size(); i++) {
+    ret = avl_tree_insert(&avl_tree, db_entries[i].first, db_entries[i].second);
+    ASSERT_EQ(results[i], ret);
+  }
+
+  validate_avl_tree(batch_tree);
+  compare_avl_trees(avl_tree, batch_tree);
+
+  // Batches into an empty tree take the bulk path
+  avl_tree_destroy(&batch_tree);
+  batch = db_entries;
+  avl_tree_insert_batch(&batch_tree, &batch, &results);
+  validate_avl_tree(batch_tree);
+  ASSERT_EQ(batch_tree->parent, nullptr);
+
+  avl_tree_destroy(&avl_tree);
+  avl_tree_destroy(&batch_tree);
+}
+
+/**
+ * Builds a tree (from the pool if given) with the given keys, named after
+ * the tree tag, and returns its keys in order.
+ **/
+static AVLNode* build_set_tree(const std::vector<uint32_t>& ids, const std::string& tag,
+                               AVLNodePool* pool) {
+  AVLNode* root = NULL;
+  for (uint32_t id : ids) avl_tree_insert(&root, id, tag + std::to_string(id), pool);
+  return root;
+}
+
+// Checks a set operation result against the expected keys and names
+static void check_set_tree(AVLNode* root, const std::vector<uint32_t>& expected,
+                           const std::vector<uint32_t>& first) {
+  std::vector<AVLNode*> page;
+
+  if (expected.empty()) {
+    ASSERT_EQ(root, nullptr);
+    return;
+  }
+
+  ASSERT_NE(root, nullptr);
+  ASSERT_EQ(root->parent, nullptr);
+  validate_avl_tree(root);
+
+  avl_tree_get_page(root, 0, root->size, &page);
+  ASSERT_EQ(page.size(), expected.size());
+  for (size_t i = 0; i < page.size(); i++) {
+    ASSERT_EQ(page[i]->id, expected[i]);
+    // Entries of the first tree win
+    bool in_first = std::binary_search(first.begin(), first.end(), expected[i]);
+    ASSERT_EQ(page[i]->name, (in_first ? "a" : "b") + std::to_string(expected[i]));
+  }
+}
+
+// Test join, split, join2 and the parallel union, intersection and difference
+TEST(AVLTreeTest, SetOperations) {
+  int ret = 0;
+  AVLNode* avl_tree = NULL;
+  AVLNode* left = NULL;
+  AVLNode* right = NULL;
+  AVLNode* node = NULL;
+  AVLNode* first = NULL;
+  AVLNode* second = NULL;
+  AVLNode* result = NULL;
+  AVLNodePool* pool = NULL;
+  std::vector<uint32_t> ids_a;
+  std::vector<uint32_t> ids_b;
+  std::vector<uint32_t> expected;
+
+  // Overlapping key sets, large enough to fork and of uneven sizes
+  for (uint32_t i = 0; i < 30000; i++) ids_a.push_back(MIN_ID + 3 * i);
+  for (uint32_t i = 0; i < 12000; i++) ids_b.push_back(MIN_ID + 5 * i + 20000);
+
+  // Split around a present key and join it back
+  avl_tree = build_set_tree(ids_a, "a", NULL);
+  ret = avl_tree_split(&avl_tree, MIN_ID + 3000, &left, &node, &right);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(avl_tree, nullptr);
+  ASSERT_NE(node, nullptr);
+  ASSERT_EQ(node->id, MIN_ID + 3000);
+  validate_avl_tree(left);
+  validate_avl_tree(right);
+  ASSERT_EQ(left->size, 1000);
+  ASSERT_EQ(right->size, 28999);
+
+  ret = avl_tree_join(&right, node, &left, &avl_tree);
+  ASSERT_EQ(ret, INVALID_KEY);
+  ret = avl_tree_join(&left, node, &right, &avl_tree);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(left, nullptr);
+  ASSERT_EQ(right, nullptr);
+  check_set_tree(avl_tree, ids_a, ids_a);
+
+  // Split around a missing key and join both sides back without a node
+  avl_tree_split(&avl_tree, MIN_ID + 3001, &left, &node, &right);
+  ASSERT_EQ(node, nullptr);
+  ret = avl_tree_join2(&left, &right, &avl_tree);
+  ASSERT_EQ(ret, RET_OK);
+  check_set_tree(avl_tree, ids_a, ids_a);
+  avl_tree_destroy(&avl_tree);
+
+  // Union, intersection and difference against std::set_* results
+  for (int op = 0; op < 3; op++) {
+    first = build_set_tree(ids_a, "a", NULL);
+    second = build_set_tree(ids_b, "b", NULL);
+    expected.clear();
+
+    if (op == 0) {
+      ret = avl_tree_union(&first, &second, &result, NULL, 4);
+      std::set_union(ids_a.begin(), ids_a.end(), ids_b.begin(), ids_b.end(),
+                     std::back_inserter(expected));
+    } else if (op == 1) {
+      ret = avl_tree_intersection(&first, &second, &result, NULL, 4);
+      std::set_intersection(ids_a.begin(), ids_a.end(), ids_b.begin(), ids_b.end(),
+                            std::back_inserter(expected));
+    } else {
+      ret = avl_tree_difference(&first, &second, &result, NULL, 4);
+      std::set_difference(ids_a.begin(), ids_a.end(), ids_b.begin(), ids_b.end(),
+                          std::back_inserter(expected));
+    }
+
+    ASSERT_EQ(ret, RET_OK);
+    ASSERT_EQ(first, nullptr);
+    ASSERT_EQ(second, nullptr);
+    check_set_tree(result, expected, ids_a);
+    avl_tree_destroy(&result);
+  }
+
+  // Pooled trees release the dropped nodes to their pool
+  avl_node_pool_create(&pool);
+  first = build_set_tree(ids_a, "a", pool);
+  second = build_set_tree(ids_b, "b", pool);
+  expected.clear();
+  std::set_difference(ids_b.begin(), ids_b.end(), ids_a.begin(), ids_a.end(),
+                      std::back_inserter(expected));
+  ret = avl_tree_difference(&second, &first, &result, pool);
+  ASSERT_EQ(ret, RET_OK);
+  for (uint32_t& id : ids_a) id = 0;
+  check_set_tree(result, expected, ids_a);
+  ASSERT_NE(pool->freelist, nullptr);
+
+  // Empty sets
+  ret = avl_tree_intersection(&result, &first, &second, pool);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(second, nullptr);
+  ASSERT_EQ(result, nullptr);
+  avl_node_pool_destroy(&pool);
+}
+
+// Test the operation counters (all zero when built without AVL_TREE_STATS)
+TEST(AVLTreeTest, OperationStats) {
+  int ret = 0;
+  AVLNode* avl_tree = NULL;
+  AVLNode* avl_node = NULL;
+  AVLTreeStats stats;
+  bool found = false;
+
+  ret = avl_tree_reset_stats();
+  ASSERT_EQ(ret, RET_OK);
+  ret = avl_tree_get_stats(NULL);
+  ASSERT_EQ(ret, INVALID_TREE);
+
+  // Ascending keys rotate once (RR), descending ones once (LL)
+  avl_tree_insert(&avl_tree, MIN_ID + 1, "");
+  avl_tree_insert(&avl_tree, MIN_ID + 2, "");
+  avl_tree_insert(&avl_tree, MIN_ID + 3, "");
+  avl_tree_search(avl_tree, MIN_ID + 3, &avl_node, &found);
+  ASSERT_TRUE(found);
+
+  // Counters of an exited thread are kept
+  std::thread worker([]() {
+    AVLNode* worker_tree = NULL;
+    avl_tree_insert(&worker_tree, MIN_ID + 3, "");
+    avl_tree_insert(&worker_tree, MIN_ID + 2, "");
+    avl_tree_insert(&worker_tree, MIN_ID + 1, "");
+    avl_tree_destroy(&worker_tree);
+  });
+  worker.join();
+
+  avl_tree_remove(&avl_tree, MIN_ID + 2);
+
+  ret = avl_tree_get_stats(&stats);
+  ASSERT_EQ(ret, RET_OK);
+
+#ifdef AVL_TREE_STATS
+  // Insertions into non empty trees search once: 2 per tree, plus 2 here
+  ASSERT_EQ(stats.searches, 6u);
+  // 1 + 2 nodes on each tree, 2 on the final search, 1 for the removal
+  ASSERT_EQ(stats.comparisons, 6u + 2u + 1u);
+  ASSERT_EQ(stats.rotations_rr, 1u);
+  ASSERT_EQ(stats.rotations_ll, 1u);
+  ASSERT_EQ(stats.rotations_rl, 0u);
+  ASSERT_EQ(stats.rotations_lr, 0u);
+  ASSERT_EQ(stats.rebalances, 7u);
+  ASSERT_GE(stats.rebalance_nodes, stats.rebalances);
+  ASSERT_EQ(stats.allocs, 6u);
+  ASSERT_EQ(stats.frees, 4u);
+#else
+  ASSERT_EQ(stats.searches, 0u);
+  ASSERT_EQ(stats.comparisons, 0u);
+  ASSERT_EQ(stats.rotations_rr, 0u);
+  ASSERT_EQ(stats.allocs, 0u);
+  ASSERT_EQ(stats.frees, 0u);
+#endif
+
+  avl_tree_destroy(&avl_tree);
+}
+
+// Test rank, select, range count and pagination against a sorted key list
+TEST(AVLTreeTest, OrderStatistics) {
+  int ret = 0;
+  int rank = 0;
+  int count = 0;
+
+  AVLNode* avl_tree = NULL;
+  AVLNode* avl_node = NULL;
+  std::vector<AVLNode*> page;
+  std::vector<uint32_t> ids;
+  const int num_inserts = 1000;
+
+  for (int i = 0; i < num_inserts; i++) {
+    uint32_t id = MIN_ID + rand() % (MAX_ID-MIN_ID);
+    if (avl_tree_insert(&avl_tree, id, "") == RET_OK) ids.push_back(id);
+  }
+
+  // Keep sizes coherent through removals too
+  for (int i = 0; i < num_inserts / 4; i++) {
+    avl_tree_remove(&avl_tree, ids.back());
+    ids.pop_back();
+  }
+
+  validate_avl_tree(avl_tree);
+  std::sort(ids.begin(), ids.end());
+
+  for (size_t i = 0; i < ids.size(); i++) {
+    ret = avl_tree_get_rank(avl_tree, ids[i], &rank);
+    ASSERT_EQ(ret, RET_OK);
+    ASSERT_EQ(rank, (int) i);
+
+    ret = avl_tree_select(avl_tree, i, &avl_node);
+    ASSERT_EQ(ret, RET_OK);
+    ASSERT_EQ(avl_node->id, ids[i]);
+  }
+
+  ret = avl_tree_get_rank(avl_tree, ids[10] + 1, &rank);
+  ASSERT_EQ(ret, KEY_NOT_FOUND);
+  ASSERT_EQ(rank, 11);
+
+  ret = avl_tree_select(avl_tree, ids.size(), &avl_node);
+  ASSERT_EQ(ret, INVALID_INDEX);
+
+  ret = avl_tree_count_range(avl_tree, ids[100], ids[199], &count);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(count, 100);
+
+  ret = avl_tree_count_range(avl_tree, MIN_ID, MAX_ID, &count);
+  ASSERT_EQ(count, (int) ids.size());
+
+  ret = avl_tree_count_range(avl_tree, ids[1], ids[0], &count);
+  ASSERT_EQ(count, 0);
+
+  ret = avl_tree_get_page(avl_tree, ids.size() - 5, 10, &page);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(page.size(), (size_t) 5);
+
+  ret = avl_tree_get_page(avl_tree, 50, 20, &page);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(page.size(), (size_t) 20);
+  for (size_t i = 0; i < page.size(); i++) ASSERT_EQ(page[i]->id, ids[50 + i]);
+
+  avl_tree_destroy(&avl_tree);
+}
+
+// Test searches, insertions and removals filtered by an existence bitmap
+TEST(AVLTreeTest, IdBitmap) {
+  int ret = 0;
+  bool found = false;
+  bool bitmap_found = false;
+
+  AVLNode* avl_tree = NULL;
+  AVLNode* avl_node = NULL;
+  AVLIdBitmap* bitmap = NULL;
+
+  ret = avl_id_bitmap_create(&bitmap);
+  ASSERT_EQ(ret, RET_OK);
+
+  ret = avl_tree_create("misc/input/lista_1000.txt", &avl_tree, NULL, bitmap);
+  ASSERT_EQ(ret, RET_OK);
+
+  for (uint32_t id = MIN_ID - 10; id < MIN_ID + 2000; id++) {
+    avl_tree_search(avl_tree, id, &avl_node, &found);
+    avl_tree_search(avl_tree, id, &avl_node, &bitmap_found, bitmap);
+    ASSERT_EQ(bitmap_found, found);
+    if (found) {
+      ASSERT_EQ(avl_node->id, id);
+    } else {
+      ASSERT_EQ(avl_node, nullptr);
+    }
+  }
+
+  ret = avl_tree_insert(&avl_tree, avl_tree->id, "", NULL, bitmap);
+  ASSERT_EQ(ret, KEY_EXISTS);
+
+  ret = avl_tree_insert(&avl_tree, MAX_ID, "", NULL, bitmap);
+  ASSERT_EQ(ret, RET_OK);
+  avl_id_bitmap_test(bitmap, MAX_ID, &found);
+  ASSERT_TRUE(found);
+
+  ret = avl_tree_remove(&avl_tree, MAX_ID, NULL, bitmap);
+  ASSERT_EQ(ret, RET_OK);
+  avl_id_bitmap_test(bitmap, MAX_ID, &found);
+  ASSERT_FALSE(found);
+
+  ret = avl_tree_remove(&avl_tree, MAX_ID, NULL, bitmap);
+  ASSERT_EQ(ret, KEY_NOT_FOUND);
+
+  validate_avl_tree(avl_tree);
+
+  // Destroying the tree clears its bitmap, so the same keys can come back
+  uint32_t root_id = avl_tree->id;
+  ret = avl_tree_destroy(&avl_tree, NULL, bitmap);
+  ASSERT_EQ(ret, RET_OK);
+  avl_id_bitmap_test(bitmap, root_id, &found);
+  ASSERT_FALSE(found);
+  ret = avl_tree_insert(&avl_tree, root_id, "", NULL, bitmap);
+  ASSERT_EQ(ret, RET_OK);
+
+  ret = avl_id_bitmap_clear(bitmap);
+  ASSERT_EQ(ret, RET_OK);
+  avl_id_bitmap_test(bitmap, root_id, &found);
+  ASSERT_FALSE(found);
+
+  avl_tree_destroy(&avl_tree);
+  avl_id_bitmap_destroy(&bitmap);
+
+  // Bitmaps can be filled from an already built tree
+  avl_id_bitmap_create(&bitmap);
+  avl_tree_create_bulk("misc/input/lista_100.txt", &avl_tree);
+
+  ret = avl_id_bitmap_build(bitmap, avl_tree);
+  ASSERT_EQ(ret, RET_OK);
+  avl_id_bitmap_test(bitmap, avl_tree->id, &found);
+  ASSERT_TRUE(found);
+
+  avl_tree_destroy(&avl_tree);
+  ret = avl_id_bitmap_destroy(&bitmap);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(bitmap, nullptr);
+}
+
+// Range scan callback collecting the scanned keys (stops after 50 keys)
+static bool collect_ids(AVLNode* node, void* arg) {
+  std::vector<uint32_t>* ids = static_cast<std::vector<uint32_t>*>(arg);
+  ids->push_back(node->id);
+  return ids->size() < 50;
+}
+
+// Test cursor stepping and range scans against a sorted key list
+TEST(AVLTreeTest, CursorRangeScan) {
+  int ret = 0;
+  AVLNode* avl_tree = NULL;
+  AVLCursor cursor;
+  std::vector<uint32_t> ids;
+  std::vector<uint32_t> scanned;
+
+  for (int i = 0; i < 1000; i++) {
+    uint32_t id = MIN_ID + 2 * (rand() % 100000);
+    if (avl_tree_insert(&avl_tree, id, "") == RET_OK) ids.push_back(id);
+  }
+  std::sort(ids.begin(), ids.end());
+
+  // Forward iteration from the first key, then backwards from the last one
+  ret = avl_tree_cursor_lower_bound(avl_tree, 0, &cursor);
+  ASSERT_EQ(ret, RET_OK);
+  for (size_t i = 0; i < ids.size(); i++) {
+    ASSERT_EQ(cursor.node->id, ids[i]);
+    ret = avl_tree_cursor_next(&cursor);
+  }
+  ASSERT_EQ(ret, KEY_NOT_FOUND);
+  ASSERT_EQ(cursor.node, nullptr);
+
+  ret = avl_tree_cursor_seek(avl_tree, ids.back(), &cursor);
+  ASSERT_EQ(ret, RET_OK);
+  for (size_t i = ids.size(); i > 0; i--) {
+    ASSERT_EQ(cursor.node->id, ids[i - 1]);
+    avl_tree_cursor_prev(&cursor);
+  }
+  ASSERT_EQ(cursor.node, nullptr);
+
+  ret = avl_tree_cursor_seek(avl_tree, ids[10] + 1, &cursor);
+  ASSERT_EQ(ret, KEY_NOT_FOUND);
+
+  // Failed seeks on an empty tree don't leave the cursor on a stale node
+  avl_tree_cursor_seek(avl_tree, ids[10], &cursor);
+  ASSERT_EQ(avl_tree_cursor_seek(NULL, ids[10], &cursor), INVALID_TREE);
+  ASSERT_EQ(cursor.node, nullptr);
+  avl_tree_cursor_seek(avl_tree, ids[10], &cursor);
+  ASSERT_EQ(avl_tree_cursor_lower_bound(NULL, ids[10], &cursor), INVALID_TREE);
+  ASSERT_EQ(cursor.node, nullptr);
+
+  avl_tree_cursor_lower_bound(avl_tree, ids[10] + 1, &cursor);
+  ASSERT_EQ(cursor.node->id, ids[11]);
+  avl_tree_cursor_lower_bound(avl_tree, ids[10], &cursor);
+  ASSERT_EQ(cursor.node->id, ids[10]);
+  avl_tree_cursor_upper_bound(avl_tree, ids[10], &cursor);
+  ASSERT_EQ(cursor.node->id, ids[11]);
+
+  ret = avl_tree_cursor_upper_bound(avl_tree, ids.back(), &cursor);
+  ASSERT_EQ(ret, KEY_NOT_FOUND);
+
+  // Range scans, including one stopped early by the callback
+  ret = avl_tree_range_scan(avl_tree, ids[100], ids[119], collect_ids, &scanned);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(scanned, std::vector<uint32_t>(ids.begin() + 100, ids.begin() + 120));
+
+  scanned.clear();
+  avl_tree_range_scan(avl_tree, MIN_ID, MAX_ID, collect_ids, &scanned);
+  ASSERT_EQ(scanned, std::vector<uint32_t>(ids.begin(), ids.begin() + 50));
+
+  avl_tree_destroy(&avl_tree);
+}
+
+// Test AVL Tree operations backed by a node pool, including node reuse
+TEST(AVLTreeTest, NodePool) {
+  int ret = 0;
+  int size = 0;
+  bool found = false;
+
+  AVLNode* avl_tree = NULL;
+  AVLNode* avl_node = NULL;
+  AVLNodePool* pool = NULL;
+  const int num_inserts = 1000;
+
+  ret = avl_node_pool_create(&pool, 64);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_NE(pool, nullptr);
+
+  for (int i = 0; i < num_inserts; i++) {
+    ret = avl_tree_insert(&avl_tree, MIN_ID + 7 * i, "Pool Node", pool);
+    ASSERT_EQ(ret, RET_OK);
+  }
+
+  validate_avl_tree(avl_tree);
+  ASSERT_EQ(pool->chunks.size(), (size_t) (num_inserts + 63) / 64);
+
+  // Released nodes are reused before carving new chunks
+  ret = avl_tree_remove(&avl_tree, MIN_ID + 7 * (num_inserts - 1), pool);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_NE(pool->freelist, nullptr);
+
+  ret = avl_tree_insert(&avl_tree, MAX_ID, "Reused Node", pool);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(pool->freelist, nullptr);
+
+  avl_tree_search(avl_tree, MAX_ID, &avl_node, &found);
+  ASSERT_TRUE(found);
+  ASSERT_EQ(avl_node->name, "Reused Node");
+
+  avl_tree_get_size(avl_tree, &size);
+  ASSERT_EQ(size, num_inserts);
+
+  ret = avl_tree_destroy(&avl_tree, pool);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(avl_tree, nullptr);
+  ASSERT_TRUE(pool->chunks.empty());
+
+  ret = avl_node_pool_destroy(&pool);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(pool, nullptr);
+
+  // Pools not made by avl_node_pool_create work too, whatever their chunk size
+  AVLNodePool member_pool;
+  member_pool.chunk_size = 3;
+  for (int i = 0; i < 10; i++) {
+    ret = avl_tree_insert(&avl_tree, MIN_ID + i, "", &member_pool);
+    ASSERT_EQ(ret, RET_OK);
+  }
+  validate_avl_tree(avl_tree);
+  ASSERT_EQ(member_pool.chunks.size(), (size_t) 4);
+  avl_tree_destroy(&avl_tree, &member_pool);
+}
+
+/**
+ * Validates compact AVL Tree properties (BST, links and packed balance
+ * factor) on each node of the subtree, returning its height.
+ **/
+static int validate_avl_compact_tree(AVLCompactTree* tree, uint32_t node) {
+  int lheight = 0;
+  int rheight = 0;
+
+  if (node == AVL_COMPACT_NIL) return 0;
+
+  const AVLCompactNode& n = tree->nodes[node];
+  uint32_t id = n.key & AVL_COMPACT_ID_MASK;
+
+  if (n.lchild != AVL_COMPACT_NIL) {
+    EXPECT_LT(tree->nodes[n.lchild].key & AVL_COMPACT_ID_MASK, id);
+    EXPECT_EQ(tree->nodes[n.lchild].parent, node);
+    lheight = validate_avl_compact_tree(tree, n.lchild);
+  }
+
+  if (n.rchild != AVL_COMPACT_NIL) {
+    EXPECT_GT(tree->nodes[n.rchild].key & AVL_COMPACT_ID_MASK, id);
+    EXPECT_EQ(tree->nodes[n.rchild].parent, node);
+    rheight = validate_avl_compact_tree(tree, n.rchild);
+  }
+
+  EXPECT_EQ((int) (n.key >> AVL_COMPACT_ID_BITS) - 1, rheight - lheight);
+  return 1 + std::max(lheight, rheight);
+}
+
+// Test random insertions and removals on the compact AVL Tree layout
+TEST(AVLTreeTest, CompactTree) {
+  int ret = 0;
+  int size = 0;
+  uint32_t node = 0;
+  bool found = false;
+  std::string name;
+  const char* name_ref = NULL;
+  uint32_t name_length = 0;
+
+  AVLCompactTree* tree = NULL;
+  std::vector<uint32_t> ids;
+  const int num_inserts = 2000;
+
+  ret = avl_compact_tree_create(&tree);
+  ASSERT_EQ(ret, RET_OK);
+
+  for (int i = 0; i < num_inserts; i++) {
+    uint32_t id = MIN_ID + rand() % (MAX_ID-MIN_ID);
+    if (avl_compact_tree_insert(tree, id, std::to_string(id)) == RET_OK) {
+      ids.push_back(id);
+    }
+  }
+
+  ASSERT_EQ(avl_compact_tree_insert(tree, ids[0], ""), KEY_EXISTS);
+  ASSERT_EQ(avl_compact_tree_insert(tree, 500, ""), INVALID_KEY);
+  ASSERT_EQ(avl_compact_tree_insert(NULL, ids[0], ""), INVALID_TREE);
+  ASSERT_EQ(avl_compact_tree_remove(NULL, ids[0]), INVALID_TREE);
+  validate_avl_compact_tree(tree, tree->root);
+
+  std::random_shuffle(ids.begin(), ids.end());
+  for (size_t i = 0; i < ids.size() / 2; i++) {
+    ret = avl_compact_tree_remove(tree, ids[i]);
+    ASSERT_EQ(ret, RET_OK);
+  }
+  validate_avl_compact_tree(tree, tree->root);
+
+  ASSERT_EQ(avl_compact_tree_remove(tree, ids[0]), KEY_NOT_FOUND);
+
+  // Removed nodes are reused by later insertions
+  ret = avl_compact_tree_insert(tree, MAX_ID, "Reused Node");
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(tree->nodes.size(), ids.size());
+
+  for (size_t i = 0; i < ids.size(); i++) {
+    avl_compact_tree_search(tree, ids[i], &node, &found);
+    ASSERT_EQ(found, i >= ids.size() / 2);
+    if (found) {
+      avl_compact_tree_get_name(tree, node, &name);
+      ASSERT_EQ(name, std::to_string(ids[i]));
+
+      avl_compact_tree_get_name_ref(tree, node, &name_ref, &name_length);
+      ASSERT_EQ(std::string(name_ref, name_length), name);
+    }
+  }
+
+  avl_compact_tree_get_size(tree, &size);
+  ASSERT_EQ((size_t) size, ids.size() - ids.size() / 2 + 1);
+
+  ret = avl_compact_tree_destroy(&tree);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(tree, nullptr);
+}
+
+// Test frozen (Eytzinger) tree searches against the source AVL Tree
+TEST(AVLTreeTest, FrozenTree) {
+  int ret = 0;
+  uint32_t slot = 0;
+  bool found = false;
+  bool frozen_found = false;
+  std::string name;
+
+  AVLNode* avl_tree = NULL;
+  AVLNode* avl_node = NULL;
+  AVLFrozenTree* frozen = NULL;
+
+  ret = avl_tree_freeze(avl_tree, &frozen);
+  ASSERT_EQ(ret, INVALID_TREE);
+
+  ret = avl_tree_create("misc/input/lista_10000.txt", &avl_tree);
+  ASSERT_EQ(ret, RET_OK);
+
+  ret = avl_tree_freeze(avl_tree, &frozen);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(frozen->size, (uint32_t) avl_tree->size);
+  ASSERT_EQ((uintptr_t) frozen->keys % 64, (uintptr_t) 0);
+
+  // Hits and misses around the loaded key range
+  for (uint32_t id = MIN_ID - 10; id < MIN_ID + 20000; id++) {
+    avl_tree_search(avl_tree, id, &avl_node, &found);
+
+    ret = avl_frozen_tree_search(frozen, id, &slot, &frozen_found);
+    ASSERT_EQ(ret, RET_OK);
+    ASSERT_EQ(frozen_found, found);
+
+    if (found) {
+      avl_frozen_tree_get_name(frozen, slot, &name);
+      ASSERT_EQ(name, avl_node->name);
+    } else if (slot != 0) {
+      ASSERT_GT(frozen->keys[slot], id);
+    }
+  }
+
+  avl_frozen_tree_search(frozen, MAX_ID, &slot, &found);
+  ASSERT_FALSE(found);
+  ASSERT_EQ(slot, (uint32_t) 0);
+
+  ret = avl_frozen_tree_destroy(&frozen);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(frozen, nullptr);
+
+  avl_tree_destroy(&avl_tree);
+}
+
+// Test k-ary (SIMD) index searches against the source AVL Tree
+TEST(AVLTreeTest, KaryIndex) {
+  int ret = 0;
+  int rank = 0;
+  uint32_t kary_rank = 0;
+  bool found = false;
+  bool kary_found = false;
+  std::string name;
+
+  AVLNode* avl_tree = NULL;
+  AVLNode* avl_node = NULL;
+  AVLKaryIndex* index = NULL;
+
+  ret = avl_tree_create("misc/input/lista_5000.txt", &avl_tree);
+  ASSERT_EQ(ret, RET_OK);
+
+  ret = avl_kary_index_create(avl_tree, &index);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(index->size, (uint32_t) avl_tree->size);
+  ASSERT_EQ((uintptr_t) index->keys % 64, (uintptr_t) 0);
+
+  // Hits and misses around the loaded key range, ranks match the tree ranks
+  for (uint32_t id = MIN_ID - 10; id < MIN_ID + 10000; id++) {
+    avl_tree_search(avl_tree, id, &avl_node, &found);
+    avl_tree_get_rank(avl_tree, id, &rank);
+
+    ret = avl_kary_index_search(index, id, &kary_rank, &kary_found);
+    ASSERT_EQ(ret, RET_OK);
+    ASSERT_EQ(kary_found, found);
+    ASSERT_EQ(kary_rank, (uint32_t) rank);
+
+    if (found) {
+      avl_kary_index_get_name(index, kary_rank, &name);
+      ASSERT_EQ(name, avl_node->name);
+    }
+  }
+
+  avl_kary_index_search(index, UINT32_MAX, &kary_rank, &kary_found);
+  ASSERT_FALSE(kary_found);
+  ASSERT_EQ(kary_rank, index->size);
+
+  ret = avl_kary_index_destroy(&index);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(index, nullptr);
+
+  avl_tree_destroy(&avl_tree);
+}
+
+/**
+ * Validates concurrent AVL Tree properties (BST and stored heights) on each
+ * node of the subtree, returning its height.
+ **/
+static int validate_avl_concurrent_tree(const AVLConcurrentNode* node) {
+  int lheight = 0;
+  int rheight = 0;
+
+  if (node == NULL) return 0;
+
+  if (node->lchild) {
+    EXPECT_LT(node->lchild->id, node->id);
+    lheight = validate_avl_concurrent_tree(node->lchild);
+  }
+
+  if (node->rchild) {
+    EXPECT_GT(node->rchild->id, node->id);
+    rheight = validate_avl_concurrent_tree(node->rchild);
+  }
+
+  EXPECT_LT(std::abs(rheight - lheight), 2);
+  EXPECT_EQ(node->height, 1 + std::max(lheight, rheight));
+  return 1 + std::max(lheight, rheight);
+}
+
+// Range scan callback checking the keys come in order
+static bool concurrent_scan_ordered(const AVLConcurrentNode* node, void* arg) {
+  uint32_t* last = static_cast<uint32_t*>(arg);
+
+  EXPECT_GT(node->id, *last);
+  *last = node->id;
+  return true;
+}
+
+// Test lock-free readers running alongside a writer on the concurrent tree
+TEST(AVLTreeTest, ConcurrentTree) {
+  int ret = 0;
+  int size = 0;
+  bool found = false;
+  std::string name;
+  std::vector<std::thread> readers;
+  std::atomic<bool> done{false};
+  std::atomic<int> misses{0};
+
+  AVLConcurrentTree* tree = NULL;
+  const uint32_t num_stable = 2000;
+  const uint32_t num_updates = 20000;
+
+  ret = avl_concurrent_tree_create(&tree);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(avl_concurrent_tree_create(&tree), INVALID_TREE);
+
+  // Even keys stay in the tree while odd keys come and go
+  for (uint32_t i = 0; i < num_stable; i++) {
+    ret = avl_concurrent_tree_insert(tree, MIN_ID + 2 * i, std::to_string(i));
+    ASSERT_EQ(ret, RET_OK);
+  }
+
+  ASSERT_EQ(avl_concurrent_tree_insert(tree, MIN_ID, ""), KEY_EXISTS);
+  ASSERT_EQ(avl_concurrent_tree_insert(tree, 500, ""), INVALID_KEY);
+  ASSERT_EQ(avl_concurrent_tree_remove(tree, MIN_ID + 1), KEY_NOT_FOUND);
+
+  for (int r = 0; r < 3; r++) {
+    readers.emplace_back([&, r]() {
+      std::string reader_name;
+      bool reader_found = false;
+      uint32_t last = 0;
+
+      for (uint32_t i = r; !done.load(); i = (i + 7) % num_stable) {
+        avl_concurrent_tree_search(tree, MIN_ID + 2 * i, &reader_name, &reader_found);
+        if (!reader_found || reader_name != std::to_string(i)) misses++;
+
+        if (i % 64 == 0) {
+          last = 0;
+          avl_concurrent_tree_range_scan(tree, MIN_ID + 2 * i, MIN_ID + 2 * i + 200,
+                                         concurrent_scan_ordered, &last);
+          if (last < MIN_ID + 2 * i) misses++;
+        }
+      }
+    });
+  }
+
+  for (uint32_t i = 0; i < num_updates; i++) {
+    uint32_t id = MIN_ID + 2 * (rand() % num_stable) + 1;
+    avl_concurrent_tree_search(tree, id, NULL, &found);
+    if (found) {
+      ASSERT_EQ(avl_concurrent_tree_remove(tree, id), RET_OK);
+    } else {
+      ASSERT_EQ(avl_concurrent_tree_insert(tree, id, "Odd"), RET_OK);
+    }
+  }
+
+  done = true;
+  for (std::thread& reader : readers) reader.join();
+  ASSERT_EQ(misses.load(), 0);
+
+  validate_avl_concurrent_tree(tree->root.load());
+
+  avl_concurrent_tree_get_size(tree, &size);
+  for (uint32_t i = 0; i < num_stable; i++) {
+    avl_concurrent_tree_search(tree, MIN_ID + 2 * i + 1, NULL, &found);
+    if (found) {
+      ASSERT_EQ(avl_concurrent_tree_remove(tree, MIN_ID + 2 * i + 1), RET_OK);
+    }
+  }
+  ASSERT_EQ(tree->size.load(), (int) num_stable);
+  ASSERT_GE(size, (int) num_stable);
+
+  avl_concurrent_tree_search(tree, MIN_ID + 2, &name, &found);
+  ASSERT_TRUE(found);
+  ASSERT_EQ(name, "1");
+  validate_avl_concurrent_tree(tree->root.load());
+
+  // Only the batches a reader could still see are left unreclaimed
+  ASSERT_LE(tree->retired.size(), (size_t) 1);
+
+  ret = avl_concurrent_tree_destroy(&tree);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(tree, nullptr);
+}
+
+/**
+ * Validates optimistic AVL Tree properties (BST and parent links) on each
+ * node of the subtree, collecting the keys present in order. Returns the
+ * subtree height, balance being relaxed while writers race.
+ **/
+static int validate_avl_optimistic_tree(AVLOptimisticNode* node, std::vector<uint32_t>* ids) {
+  AVLOptimisticNode* lchild = NULL;
+  AVLOptimisticNode* rchild = NULL;
+  int lheight = 0;
+  int rheight = 0;
+
+  if (node == NULL) return 0;
+
+  lchild = node->lchild.load();
+  rchild = node->rchild.load();
+
+  if (lchild) {
+    EXPECT_LT(lchild->id, node->id);
+    EXPECT_EQ(lchild->parent.load(), node);
+    lheight = validate_avl_optimistic_tree(lchild, ids);
+  }
+
+  if (node->name.load()) ids->push_back(node->id);
+
+  if (rchild) {
+    EXPECT_GT(rchild->id, node->id);
+    EXPECT_EQ(rchild->parent.load(), node);
+    rheight = validate_avl_optimistic_tree(rchild, ids);
+  }
+
+  return 1 + std::max(lheight, rheight);
+}
+
+// Test many writers updating interleaved keys of the optimistic tree
+TEST(AVLTreeTest, OptimisticTree) {
+  int ret = 0;
+  int size = 0;
+  int height = 0;
+  bool found = false;
+  std::string name;
+  std::vector<std::thread> writers;
+  std::vector<std::vector<bool>> present;
+  std::vector<uint32_t> expected;
+  std::vector<uint32_t> ids;
+  std::atomic<int> mismatches{0};
+
+  AVLOptimisticTree* tree = NULL;
+  const int num_threads = 8;
+  const uint32_t num_keys = 512;
+  const int num_updates = 20000;
+
+  ret = avl_optimistic_tree_create(&tree);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(avl_optimistic_tree_create(&tree), INVALID_TREE);
+
+  ASSERT_EQ(avl_optimistic_tree_insert(tree, MIN_ID, "First"), RET_OK);
+  ASSERT_EQ(avl_optimistic_tree_insert(tree, MIN_ID, ""), KEY_EXISTS);
+  ASSERT_EQ(avl_optimistic_tree_insert(tree, 500, ""), INVALID_KEY);
+  ASSERT_EQ(avl_optimistic_tree_remove(tree, MIN_ID + 1), KEY_NOT_FOUND);
+  ASSERT_EQ(avl_optimistic_tree_remove(tree, MIN_ID), RET_OK);
+  ASSERT_EQ(tree->root_holder.rchild.load(), nullptr);
+
+  // Thread t owns the keys MIN_ID + t + k * num_threads, so the threads
+  // share every subtree but each one knows the state of its own keys
+  present.resize(num_threads, std::vector<bool>(num_keys, false));
+  for (int t = 0; t < num_threads; t++) {
+    writers.emplace_back([&, t]() {
+      std::string writer_name;
+      bool writer_found = false;
+      unsigned int seed = t;
+
+      for (int i = 0; i < num_updates; i++) {
+        uint32_t k = rand_r(&seed) % num_keys;
+        uint32_t id = MIN_ID + t + k * num_threads;
+
+        if (present[t][k]) {
+          if (avl_optimistic_tree_remove(tree, id) != RET_OK) mismatches++;
+        } else {
+          if (avl_optimistic_tree_insert(tree, id, std::to_string(id)) != RET_OK) mismatches++;
+        }
+        present[t][k] = !present[t][k];
+
+        avl_optimistic_tree_search(tree, id, &writer_name, &writer_found);
+        if (writer_found != present[t][k]) mismatches++;
+        if (writer_found && writer_name != std::to_string(id)) mismatches++;
+      }
+    });
+  }
+
+  for (std::thread& writer : writers) writer.join();
+  ASSERT_EQ(mismatches.load(), 0);
+
+  for (uint32_t k = 0; k < num_keys; k++) {
+    for (int t = 0; t < num_threads; t++) {
+      if (present[t][k]) expected.push_back(MIN_ID + t + k * num_threads);
+    }
+  }
+
+  // The tree holds the expected keys, within the AVL Tree height bound
+  height = validate_avl_optimistic_tree(tree->root_holder.rchild.load(), &ids);
+  ASSERT_EQ(ids, expected);
+  ASSERT_LE(height, (int) (1.44 * std::log2(expected.size() + 2)) + 1);
+
+  // A single writer repairs the balance exactly
+  for (uint32_t id : expected) {
+    ASSERT_EQ(avl_optimistic_tree_remove(tree, id), RET_OK);
+  }
+  for (uint32_t id : expected) {
+    ASSERT_EQ(avl_optimistic_tree_insert(tree, id, std::to_string(id)), RET_OK);
+  }
+  ids.clear();
+  height = validate_avl_optimistic_tree(tree->root_holder.rchild.load(), &ids);
+  ASSERT_EQ(ids, expected);
+  ASSERT_EQ(height, tree->root_holder.rchild.load()->height.load());
+
+  avl_optimistic_tree_get_size(tree, &size);
+  ASSERT_EQ((size_t) size, expected.size());
+
+  avl_optimistic_tree_search(tree, expected[0], &name, &found);
+  ASSERT_TRUE(found);
+  ASSERT_EQ(name, std::to_string(expected[0]));
+
+  ret = avl_optimistic_tree_destroy(&tree);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(tree, nullptr);
+}
+
+// Range scan callback collecting the keys
+static bool collect_scan_ids(AVLNode* node, void* arg) {
+  static_cast<std::vector<uint32_t>*>(arg)->push_back(node->id);
+  return true;
+}
+
+// Test concurrent inserts into a sharded tree, skewed keys and rebalancing
+TEST(AVLTreeTest, ShardedTree) {
+  int ret = 0;
+  int size = 0;
+  bool found = false;
+  std::string name;
+  std::vector<std::thread> writers;
+  std::vector<uint32_t> expected;
+  std::vector<uint32_t> ids;
+
+  AVLShardedTree* tree = NULL;
+  const int num_threads = 4;
+  const size_t num_shards = 8;
+  const uint32_t num_keys = 4000;
+
+  ASSERT_EQ(avl_sharded_tree_create(&tree, 0), INVALID_INDEX);
+  ret = avl_sharded_tree_create(&tree, num_shards);
+  ASSERT_EQ(ret, RET_OK);
+
+  ASSERT_EQ(avl_sharded_tree_insert(tree, 500, ""), INVALID_KEY);
+  ASSERT_EQ(avl_sharded_tree_remove(tree, MAX_ID), KEY_NOT_FOUND);
+
+  // Skewed IDs, all of them in the first even split of the key space
+  for (int t = 0; t < num_threads; t++) {
+    writers.emplace_back([&, t]() {
+      for (uint32_t k = t; k < num_keys; k += num_threads) {
+        EXPECT_EQ(avl_sharded_tree_insert(tree, MIN_ID + 7 * k, std::to_string(k)), RET_OK);
+      }
+    });
+  }
+  for (std::thread& writer : writers) writer.join();
+  for (uint32_t k = 0; k < num_keys; k++) expected.push_back(MIN_ID + 7 * k);
+
+  ASSERT_EQ(tree->shards[0].root->size, (int) num_keys);
+  ASSERT_EQ(avl_sharded_tree_insert(tree, MIN_ID, ""), KEY_EXISTS);
+
+  ret = avl_sharded_tree_rebalance(tree);
+  ASSERT_EQ(ret, RET_OK);
+
+  // Every shard holds the same share of the keys, within its bounds
+  for (size_t i = 0; i < num_shards; i++) {
+    AVLShard& shard = tree->shards[i];
+    AVLNode* node = NULL;
+
+    ASSERT_EQ(shard.root->size, (int) (num_keys / num_shards));
+    validate_avl_tree(shard.root);
+
+    avl_tree_get_min_node(shard.root, &node);
+    ASSERT_GE(node->id, shard.lo.load());
+    if (i + 1 < num_shards) {
+      avl_tree_get_max_node(shard.root, &node);
+      ASSERT_LT(node->id, tree->shards[i + 1].lo.load());
+    }
+  }
+
+  // Scans and lookups across the shard boundaries
+  avl_sharded_tree_range_scan(tree, 0, UINT32_MAX, collect_scan_ids, &ids);
+  ASSERT_EQ(ids, expected);
+
+  ids.clear();
+  avl_sharded_tree_range_scan(tree, expected[100] - 1, expected[3000] + 1,
+                              collect_scan_ids, &ids);
+  ASSERT_EQ(ids, std::vector<uint32_t>(expected.begin() + 100, expected.begin() + 3001));
+
+  for (uint32_t k = 0; k < num_keys; k += 3) {
+    avl_sharded_tree_search(tree, MIN_ID + 7 * k, &name, &found);
+    ASSERT_TRUE(found);
+    ASSERT_EQ(name, std::to_string(k));
+    avl_sharded_tree_search(tree, MIN_ID + 7 * k + 1, NULL, &found);
+    ASSERT_FALSE(found);
+  }
+
+  // Removals and insertions keep working with the moved boundaries
+  for (uint32_t k = 0; k < num_keys; k += 2) {
+    ASSERT_EQ(avl_sharded_tree_remove(tree, MIN_ID + 7 * k), RET_OK);
+  }
+  ASSERT_EQ(avl_sharded_tree_insert(tree, MAX_ID, "Last"), RET_OK);
+
+  avl_sharded_tree_get_size(tree, &size);
+  ASSERT_EQ(size, (int) (num_keys / 2 + 1));
+
+  ret = avl_sharded_tree_destroy(&tree);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(tree, nullptr);
+}
+
+/**
+ * Validates persistent AVL Tree properties (BST, balance, heights and sizes)
+ * on each node of a version, collecting its keys in order and its nodes.
+ * Returns the subtree height.
+ **/
+static int validate_avl_persistent_tree(AVLPersistentNode* node, std::vector<uint32_t>* ids,
+                                        std::vector<AVLPersistentNode*>* nodes) {
+  int lheight = 0;
+  int rheight = 0;
+
+  if (node == NULL) return 0;
+
+  EXPECT_GE(node->refs.load(), 1);
+  if (node->lchild) {
+    EXPECT_LT(node->lchild->id, node->id);
+    lheight = validate_avl_persistent_tree(node->lchild, ids, nodes);
+  }
+
+  ids->push_back(node->id);
+  nodes->push_back(node);
+
+  if (node->rchild) {
+    EXPECT_GT(node->rchild->id, node->id);
+    rheight = validate_avl_persistent_tree(node->rchild, ids, nodes);
+  }
+
+  EXPECT_LT(std::abs(rheight - lheight), 2);
+  EXPECT_EQ(node->height, 1 + std::max(lheight, rheight));
+  EXPECT_EQ(node->size, 1 + (node->lchild ? node->lchild->size : 0)
+                          + (node->rchild ? node->rchild->size : 0));
+  return 1 + std::max(lheight, rheight);
+}
+
+// Test persistent versions: O(1) snapshots, path copying and sharing
+TEST(AVLTreeTest, PersistentTree) {
+  int ret = 0;
+  int size = 0;
+  int height = 0;
+  bool found = false;
+  std::vector<uint32_t> ids;
+  std::vector<uint32_t> expected;
+  std::vector<uint32_t> snapshot_ids;
+  std::vector<AVLPersistentNode*> nodes;
+  std::vector<AVLPersistentNode*> snapshot_nodes;
+  std::thread reader;
+
+  AVLPersistentTree* tree = NULL;
+  AVLPersistentNode* snapshot = NULL;
+  AVLPersistentNode* next = NULL;
+  AVLPersistentNode* node = NULL;
+  const int num_inserts = 2000;
+
+  ret = avl_persistent_tree_create(&tree);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(avl_persistent_tree_insert(tree, 500, ""), INVALID_KEY);
+  ASSERT_EQ(avl_persistent_tree_remove(tree, MIN_ID), KEY_NOT_FOUND);
+
+  for (int i = 0; i < num_inserts; i++) {
+    uint32_t id = MIN_ID + rand() % (MAX_ID-MIN_ID);
+    if (std::find(expected.begin(), expected.end(), id) != expected.end()) continue;
+    ASSERT_EQ(avl_persistent_tree_insert(tree, id, std::to_string(id)), RET_OK);
+    expected.push_back(id);
+  }
+  ASSERT_EQ(avl_persistent_tree_insert(tree, expected[0], ""), KEY_EXISTS);
+  std::sort(expected.begin(), expected.end());
+
+  // The snapshot keeps its content while the live tree changes
+  avl_persistent_tree_snapshot(tree, &snapshot);
+  ASSERT_EQ(snapshot, tree->root);
+
+  reader = std::thread([&]() {
+    for (int i = 0; i < 20; i++) {
+      snapshot_ids.clear();
+      snapshot_nodes.clear();
+      validate_avl_persistent_tree(snapshot, &snapshot_ids, &snapshot_nodes);
+      EXPECT_EQ(snapshot_ids, expected);
+    }
+  });
+
+  for (size_t i = 0; i < expected.size(); i += 2) {
+    ASSERT_EQ(avl_persistent_tree_remove(tree, expected[i]), RET_OK);
+  }
+  for (int i = 0; i < num_inserts / 2; i++) {
+    avl_persistent_tree_insert(tree, MIN_ID + rand() % (MAX_ID-MIN_ID), "New");
+  }
+  reader.join();
+
+  validate_avl_persistent_tree(tree->root, &ids, &nodes);
+  avl_persistent_version_get_size(tree->root, &size);
+  ASSERT_EQ((size_t) size, ids.size());
+  avl_persistent_version_search(tree->root, expected[1], &node, &found);
+  ASSERT_TRUE(found);
+  ASSERT_EQ(node->name, std::to_string(expected[1]));
+  avl_persistent_version_search(snapshot, expected[0], &node, &found);
+  ASSERT_TRUE(found);
+  avl_persistent_version_release(&snapshot);
+  ASSERT_EQ(snapshot, nullptr);
+
+  // One update only copies the nodes of its path, plus rotated ones
+  avl_persistent_tree_snapshot(tree, &snapshot);
+  snapshot_ids.clear();
+  snapshot_nodes.clear();
+  height = validate_avl_persistent_tree(snapshot, &snapshot_ids, &snapshot_nodes);
+
+  ret = avl_persistent_version_insert(snapshot, MAX_ID, "Last", &next);
+  ASSERT_EQ(ret, RET_OK);
+  ids.clear();
+  nodes.clear();
+  validate_avl_persistent_tree(next, &ids, &nodes);
+  ASSERT_EQ(ids.size(), snapshot_ids.size() + 1);
+
+  std::sort(snapshot_nodes.begin(), snapshot_nodes.end());
+  size = 0;
+  for (AVLPersistentNode* copy : nodes) {
+    size += !std::binary_search(snapshot_nodes.begin(), snapshot_nodes.end(), copy);
+  }
+  ASSERT_LE(size, height + 2);
+
+  avl_persistent_version_release(&next);
+  ret = avl_persistent_version_remove(snapshot, snapshot_ids[0], &next);
+  ASSERT_EQ(ret, RET_OK);
+  avl_persistent_version_get_size(next, &size);
+  ASSERT_EQ((size_t) size, snapshot_ids.size() - 1);
+
+  avl_persistent_version_release(&next);
+  avl_persistent_version_release(&snapshot);
+
+  ret = avl_persistent_tree_destroy(&tree);
+  ASSERT_EQ(ret, RET_OK);
+  ASSERT_EQ(tree, nullptr);
+}
+
 /**
 * Test the creation of multiple AVL Trees, by inserting an incrementally
 * large number of nodes along multiple iterations, validating the tree after